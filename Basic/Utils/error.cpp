@@ -11,6 +11,6 @@ std::string ErrorException::getMessage() const {
 
 //----------------------------------------------------------------------------------------
 
-void error(std::string message) {
+[[noreturn]] void error(std::string message) {
     throw ErrorException(message);
 }
\ No newline at end of file
@@ -35,6 +35,6 @@ private:
 
 //------------------------------------------------------------------------------------------------
 
-void error(std::string message);
+[[noreturn]] void error(std::string message);
 
 #endif //CODE_ERROR_HPP
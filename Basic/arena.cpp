@@ -0,0 +1,83 @@
+/*
+ * File: arena.cpp
+ * ---------------
+ * This file implements the Arena class.
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include "arena.hpp"
+
+Arena::Arena(size_t initialSize) : nextSize(initialSize) {
+    /* Empty */
+}
+
+Arena::~Arena() {
+    clear();
+}
+
+Arena::Arena(Arena &&other) noexcept
+        : chunks(other.chunks), next(other.next), limit(other.limit), nextSize(other.nextSize) {
+    other.chunks = nullptr;
+    other.next = other.limit = nullptr;
+}
+
+Arena &Arena::operator=(Arena &&other) noexcept {
+    if (this != &other) {
+        clear();
+        chunks = other.chunks;
+        next = other.next;
+        limit = other.limit;
+        nextSize = other.nextSize;
+        other.chunks = nullptr;
+        other.next = other.limit = nullptr;
+    }
+    return *this;
+}
+
+void *Arena::allocate(size_t size, size_t align) {
+    uintptr_t p = ((uintptr_t) next + align - 1) & ~(uintptr_t) (align - 1);
+    if (next == nullptr || p + size > (uintptr_t) limit) {
+        grow(size + align);
+        p = ((uintptr_t) next + align - 1) & ~(uintptr_t) (align - 1);
+    }
+    next = (char *) (p + size);
+    return (void *) p;
+}
+
+std::string_view Arena::copyString(std::string_view str) {
+    char *copy = (char *) allocate(str.size() + 1, 1);
+    std::memcpy(copy, str.data(), str.size());
+    copy[str.size()] = '\0';
+    return std::string_view(copy, str.size());
+}
+
+void Arena::clear() {
+    while (chunks != nullptr) {
+        Chunk *chunk = chunks;
+        chunks = chunk->next;
+        std::free(chunk);
+    }
+    next = limit = nullptr;
+}
+
+/*
+ * Implementation notes: grow
+ * --------------------------
+ * A new chunk begins with its header, which links it into the list
+ * of chunks to free.  The rest of any previous chunk is abandoned.
+ */
+
+void Arena::grow(size_t minSize) {
+    size_t size = nextSize;
+    while (size < minSize + sizeof(Chunk)) size *= 2;
+    nextSize = size * 2;
+    auto *chunk = (Chunk *) std::malloc(size);
+    if (chunk == nullptr) throw std::bad_alloc();
+    chunk->next = chunks;
+    chunk->size = size;
+    chunks = chunk;
+    next = (char *) (chunk + 1);
+    limit = (char *) chunk + size;
+}
@@ -0,0 +1,117 @@
+/*
+ * File: arena.h
+ * -------------
+ * This interface exports the Arena class, a bump allocator that holds
+ * the parsed representation of a program line.
+ */
+
+#ifndef _arena_h
+#define _arena_h
+
+#include <cstddef>
+#include <new>
+#include <string>
+#include <string_view>
+#include <utility>
+
+/*
+ * Class: Arena
+ * ------------
+ * An arena hands out memory from large chunks by advancing a pointer
+ * and releases everything it has handed out at once, when the arena
+ * is cleared or destroyed.  Objects placed in an arena are never
+ * destroyed individually and their destructors do not run, so they
+ * must not own any other storage; everything they point to must live
+ * in the same arena.
+ */
+
+class Arena {
+
+public:
+
+/*
+ * Constructor: Arena
+ * Usage: Arena arena;
+ *        Arena arena(initialSize);
+ * --------------------------------
+ * Creates an empty arena whose first chunk, allocated on first use,
+ * will hold initialSize bytes.  Later chunks double in size.
+ */
+
+    explicit Arena(size_t initialSize = 256);
+
+/*
+ * Destructor: ~Arena
+ * Usage: usually implicit
+ * -----------------------
+ * Frees every chunk owned by the arena.
+ */
+
+    ~Arena();
+
+    Arena(Arena &&other) noexcept;
+
+    Arena &operator=(Arena &&other) noexcept;
+
+    Arena(const Arena &) = delete;
+
+    Arena &operator=(const Arena &) = delete;
+
+/*
+ * Method: allocate
+ * Usage: void *p = arena.allocate(size, align);
+ * ---------------------------------------------
+ * Returns size bytes of uninitialized memory aligned to align.
+ */
+
+    void *allocate(size_t size, size_t align = alignof(std::max_align_t));
+
+/*
+ * Method: make
+ * Usage: T *obj = arena.make<T>(args...);
+ * ---------------------------------------
+ * Constructs an object of type T in the arena and returns a pointer
+ * to it.
+ */
+
+    template <typename T, typename... Args>
+    T *make(Args &&... args) {
+        return new(allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+/*
+ * Method: copyString
+ * Usage: std::string_view copy = arena.copyString(str);
+ * -----------------------------------------------------
+ * Copies the characters of str into the arena and returns a view
+ * of the copy.
+ */
+
+    std::string_view copyString(std::string_view str);
+
+/*
+ * Method: clear
+ * Usage: arena.clear();
+ * ---------------------
+ * Releases everything allocated from the arena.
+ */
+
+    void clear();
+
+private:
+
+    struct Chunk {
+        Chunk *next;
+        size_t size;
+    };
+
+    Chunk *chunks = nullptr;    /* Most recent chunk first        */
+    char *next = nullptr;       /* First free byte in that chunk  */
+    char *limit = nullptr;      /* End of that chunk              */
+    size_t nextSize;            /* Size of the next chunk         */
+
+    void grow(size_t minSize);
+
+};
+
+#endif
@@ -0,0 +1,679 @@
+/*
+ * File: cache.cpp
+ * ---------------
+ * This file implements the cache of parsed statements and compiled
+ * programs.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "cache.hpp"
+#include "io.hpp"
+#include "optimizer.hpp"
+#include "parser.hpp"
+
+/* Constants */
+
+static const size_t MAX_LINE_ENTRIES = 1 << 17;
+static const size_t SEEN_SLOTS = 1 << 18;
+static const size_t MAX_PROGRAM_INSTRUCTIONS = 1 << 22;
+static const char DISK_MAGIC[8] = {'B', 'A', 'S', 'I', 'C', 'B', 'C', '2'};
+
+/*
+ * Type: DiskHeader
+ * ----------------
+ * The start of a compiled program kept on disk.  It is followed by
+ * the instructions, as pairs of 32-bit integers, the line starts, one
+ * name record for every variable of the program, the characters of
+ * the names and the normalized source of the program, which a reader
+ * compares.  The operands that name variables are the program's own
+ * numbers, which index the name records, so only the table of slots
+ * is rebuilt from the names, since slots are assigned anew by every
+ * process.  The checksum covers everything after the header.
+ */
+
+struct DiskHeader {
+    char magic[8];
+    int32_t version;
+    int32_t maxStack;
+    int32_t tempCount;
+    uint32_t codeCount;
+    uint32_t lineStartCount;
+    uint32_t symbolCount;
+    uint32_t nameSize;
+    uint32_t sourceSize;
+    uint64_t checksum;
+};
+
+struct NameRecord {
+    uint32_t offset, length;
+};
+
+/* Private function prototypes */
+
+static void mixWord(uint64_t state[2], uint64_t word);
+static void mixBytes(uint64_t state[2], std::string_view data);
+static uint64_t finishHash(uint64_t value);
+static uint64_t hashText(std::string_view text);
+static bool hasSlotOperand(int op);
+static bool checkCode(Bytecode &bytecode);
+static Statement *cloneStatement(Statement *stmt, Arena &arena);
+static Expression *cloneExp(Expression *exp, Arena &arena,
+                            std::unordered_map<Expression *, Expression *> &copies);
+
+CompileCache &CompileCache::instance() {
+    static CompileCache cache;
+    return cache;
+}
+
+CompileCache::CompileCache() {
+    lines.reserve(MAX_LINE_ENTRIES + 1);
+    seen.assign(SEEN_SLOTS, 0);
+}
+
+void CompileCache::setEnabled(bool enabled) {
+    instance().enabled = enabled;
+}
+
+/*
+ * Implementation notes: setDirectory
+ * ----------------------------------
+ * An existing file of the same name counts as a failure, so that the
+ * cache is never quietly left writing into something that cannot hold
+ * it.
+ */
+
+bool CompileCache::setDirectory(const std::string &path) {
+    instance().directory.clear();
+    if (mkdir(path.c_str(), 0755) != 0) {
+        if (errno != EEXIST) return false;
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0) return false;
+        if (!S_ISDIR(info.st_mode)) {
+            errno = ENOTDIR;
+            return false;
+        }
+    }
+    instance().directory = path;
+    return true;
+}
+
+/*
+ * Implementation notes: parseLine
+ * -------------------------------
+ * Lines are addressed by the text of their statement, which is all the
+ * parser reads once the line number has been consumed.  A hit is only
+ * taken if the stored text is the same, so a collision of the 64-bit
+ * hashes costs a parse and nothing else.  Most lines of a new program
+ * are seen exactly once, so a statement is only kept from its second
+ * sighting on: the first merely leaves its hash in the seen table,
+ * which has two ways per set and costs no allocation.  A kept statement
+ * lives in the entry's own arena and every caller gets a copy in its
+ * arena, so that programs never share nodes with the cache or with
+ * each other.  The copy keeps the subexpressions that the optimizer
+ * shares shared, since the compiler saves those in temporaries.  The
+ * token of a remembered failure is kept as a view of the entry's text
+ * and handed out as the same stretch of the caller's line.
+ */
+
+static std::string_view rebase(std::string_view token, std::string_view from,
+                               std::string_view to) {
+    if (token.empty()) return {};
+    return to.substr(token.data() - from.data(), token.size());
+}
+
+Statement *CompileCache::parseLine(Lexer &lexer, Arena &arena, Failure &failure) {
+    CompileCache &cache = instance();
+    std::string_view text;
+    uint64_t key = 0;
+    bool keep = false;
+    if (cache.enabled) {
+        text = lexer.getInput().substr(lexer.peek().offset);
+        key = hashText(text);
+        std::lock_guard<std::mutex> guard(cache.lineLock);
+        auto it = cache.lines.find(key);
+        if (it != cache.lines.end() && it->second->text == text) {
+            LineEntry &entry = *it->second;
+            cache.lineCounts.hits++;
+            cache.lineUses.splice(cache.lineUses.begin(), cache.lineUses, entry.use);
+            if (entry.stmt == nullptr) {
+                failure.status = entry.failure.status;
+                failure.token = rebase(entry.failure.token, entry.text, text);
+                return nullptr;
+            }
+            return cloneStatement(entry.stmt, arena);
+        }
+        cache.lineCounts.misses++;
+        uint64_t *seen = &cache.seen[key & (SEEN_SLOTS - 2)];
+        keep = seen[0] == key || seen[1] == key;
+        if (seen[0] != key) {
+            seen[1] = seen[0];
+            seen[0] = key;
+        }
+    }
+    if (!keep) {
+        Statement *stmt = parseStatement(lexer, arena, failure);
+        if (stmt != nullptr) optimizeStatement(stmt, arena);
+        return stmt;
+    }
+    auto entry = std::make_unique<LineEntry>();
+    entry->text = text;
+    Statement *result = nullptr;
+    Statement *stmt = parseStatement(lexer, entry->arena, failure);
+    if (stmt != nullptr) {
+        optimizeStatement(stmt, entry->arena);
+        entry->stmt = stmt;
+        result = cloneStatement(stmt, arena);
+    } else {
+        entry->failure.status = failure.status;
+        entry->failure.token = rebase(failure.token, text, entry->text);
+    }
+    std::lock_guard<std::mutex> guard(cache.lineLock);
+    cache.addLine(key, std::move(entry));
+    return result;
+}
+
+/*
+ * Implementation notes: addLine
+ * -----------------------------
+ * Replaces any entry with the same key, which can only be one whose
+ * text collided with this one or was kept by another thread at the
+ * same time.  The caller holds lineLock.
+ */
+
+void CompileCache::addLine(uint64_t key, std::unique_ptr<LineEntry> entry) {
+    auto inserted = lines.try_emplace(key);
+    if (!inserted.second) lineUses.erase(inserted.first->second->use);
+    lineUses.push_front(key);
+    entry->use = lineUses.begin();
+    inserted.first->second = std::move(entry);
+    while (lines.size() > MAX_LINE_ENTRIES) {
+        lines.erase(lineUses.back());
+        lineUses.pop_back();
+    }
+}
+
+/*
+ * Implementation notes: compile
+ * -----------------------------
+ * Memory is searched first, then the directory.  A hit counts only if
+ * the stored source matches, so a collision of the hashes, or a file
+ * that was renamed or overwritten, costs a compilation and nothing
+ * else.  Compiling happens outside the lock, so two sessions that run
+ * the same new program at once may both compile it; the second result
+ * simply replaces the first.
+ */
+
+std::shared_ptr<const Bytecode> CompileCache::compile(Program &program, bool markLines) {
+    CompileCache &cache = instance();
+    if (!cache.enabled) {
+        auto bytecode = std::make_shared<Bytecode>();
+        compileProgram(program, *bytecode, markLines);
+        return bytecode;
+    }
+    std::string source = normalizeProgram(program);
+    Hash key = hashProgram(source, markLines);
+    {
+        std::lock_guard<std::mutex> guard(cache.programLock);
+        auto it = cache.programs.find(key);
+        if (it != cache.programs.end() && it->second.source == source) {
+            cache.programCounts.hits++;
+            cache.programUses.splice(cache.programUses.begin(), cache.programUses, it->second.use);
+            return it->second.bytecode;
+        }
+        cache.programCounts.misses++;
+    }
+    std::shared_ptr<const Bytecode> bytecode;
+    if (!cache.directory.empty()) {
+        bytecode = cache.readDisk(key, source);
+        std::lock_guard<std::mutex> guard(cache.programLock);
+        if (bytecode) {
+            cache.diskCounts.hits++;
+        } else {
+            cache.diskCounts.misses++;
+        }
+    }
+    if (!bytecode) {
+        auto compiled = std::make_shared<Bytecode>();
+        compileProgram(program, *compiled, markLines);
+        if (!cache.directory.empty()) cache.writeDisk(key, source, *compiled);
+        bytecode = compiled;
+    }
+    cache.addProgram(key, std::move(source), bytecode);
+    return bytecode;
+}
+
+void CompileCache::report() {
+    CompileCache &cache = instance();
+    std::string lineReport, programReport, diskReport;
+    {
+        std::lock_guard<std::mutex> guard(cache.lineLock);
+        lineReport = "LINE CACHE: " + std::to_string(cache.lineCounts.hits) + " HITS, "
+                     + std::to_string(cache.lineCounts.misses) + " MISSES, "
+                     + std::to_string(cache.lines.size()) + " ENTRIES";
+    }
+    {
+        std::lock_guard<std::mutex> guard(cache.programLock);
+        programReport = "PROGRAM CACHE: " + std::to_string(cache.programCounts.hits) + " HITS, "
+                        + std::to_string(cache.programCounts.misses) + " MISSES, "
+                        + std::to_string(cache.programs.size()) + " ENTRIES";
+        diskReport = "DISK CACHE: " + std::to_string(cache.diskCounts.hits) + " HITS, "
+                     + std::to_string(cache.diskCounts.misses) + " MISSES";
+    }
+    writeLine(lineReport);
+    writeLine(programReport);
+    if (!cache.directory.empty()) writeLine(diskReport);
+}
+
+/*
+ * Implementation notes: normalizeProgram
+ * --------------------------------------
+ * The normalized source has a line for every program line: its number
+ * in decimal, followed by its tokens, each after a single space.  No
+ * token contains a space, and whitespace in a line only ever separates
+ * tokens, so programs with the same normalized source consist of the
+ * same statements and compile to the same bytecode, however they were
+ * spaced and however their line numbers were written.
+ */
+
+std::string CompileCache::normalizeProgram(Program &program) {
+    std::string source;
+    int nLines = program.getLineCount();
+    for (int i = 0; i < nLines; i++) {
+        source += std::to_string(program.getLineNumberAt(i));
+        Lexer lexer(program.getSourceLineAt(i));
+        if (lexer.peek().kind == TOKEN_NUMBER) lexer.next();
+        for (Token token = lexer.next(); token.kind != TOKEN_END; token = lexer.next()) {
+            source += ' ';
+            source += lexer.text(token);
+        }
+        source += '\n';
+    }
+    return source;
+}
+
+/*
+ * Implementation notes: hashProgram
+ * ---------------------------------
+ * The key covers the normalized source, the markLines flag and the
+ * bytecode version.
+ */
+
+CompileCache::Hash CompileCache::hashProgram(const std::string &source, bool markLines) {
+    uint64_t state[2] = {0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL};
+    mixWord(state, (uint64_t) BYTECODE_VERSION << 1 | (markLines ? 1 : 0));
+    mixBytes(state, source);
+    Hash hash;
+    hash.high = finishHash(state[0] + state[1]);
+    hash.low = finishHash(state[1] + hash.high);
+    return hash;
+}
+
+/*
+ * Implementation notes: addProgram
+ * --------------------------------
+ * The bound counts instructions rather than programs, so one very
+ * large program cannot keep the cache from holding many small ones.
+ * A program larger than the whole bound is not kept at all.
+ */
+
+void CompileCache::addProgram(const Hash &key, std::string source,
+                              std::shared_ptr<const Bytecode> bytecode) {
+    size_t size = bytecode->code.size();
+    if (size > MAX_PROGRAM_INSTRUCTIONS) return;
+    std::lock_guard<std::mutex> guard(programLock);
+    auto it = programs.find(key);
+    if (it != programs.end()) {
+        programSize -= it->second.bytecode->code.size();
+        programUses.erase(it->second.use);
+        programs.erase(it);
+    }
+    programUses.push_front(key);
+    programs.emplace(key, ProgramEntry{std::move(source), std::move(bytecode), programUses.begin()});
+    programSize += size;
+    while (programSize > MAX_PROGRAM_INSTRUCTIONS) {
+        auto last = programs.find(programUses.back());
+        programSize -= last->second.bytecode->code.size();
+        programs.erase(last);
+        programUses.pop_back();
+    }
+}
+
+std::string CompileCache::diskPath(const Hash &key) {
+    char name[40];
+    snprintf(name, sizeof name, "%016llx%016llx.bc", (unsigned long long) key.high,
+             (unsigned long long) key.low);
+    return directory + "/" + name;
+}
+
+/*
+ * Implementation notes: readDisk
+ * ------------------------------
+ * A file that is missing, truncated, damaged, written for another
+ * version of the bytecode or for a different source counts as a miss.
+ * The checksum only catches accidental damage.  Every count, every
+ * operand that names a variable, a temporary, a line, a jump target
+ * or a status, and the depth of the operand stack are checked as
+ * well, and maxStack is recomputed rather than read, so that a file
+ * whose checksum matches still cannot make the machine index outside
+ * its own tables or its stack.  What the compiler proved about the
+ * values themselves is trusted: a load marked OP_LOAD_SAFE still
+ * assumes a defined variable and OP_INDEX2_SAFE a subscript in range,
+ * exactly as in code compiled in this process.
+ */
+
+std::shared_ptr<const Bytecode> CompileCache::readDisk(const Hash &key, const std::string &source) {
+    FILE *file = fopen(diskPath(key).c_str(), "rb");
+    if (file == nullptr) return nullptr;
+    std::string data;
+    char buffer[1 << 16];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof buffer, file)) > 0) {
+        data.append(buffer, count);
+    }
+    fclose(file);
+    DiskHeader header;
+    if (data.size() < sizeof header) return nullptr;
+    memcpy(&header, data.data(), sizeof header);
+    std::string_view body(data.data() + sizeof header, data.size() - sizeof header);
+    uint64_t expected = (uint64_t) header.codeCount * 8 + (uint64_t) header.lineStartCount * 4
+                        + (uint64_t) header.symbolCount * sizeof(NameRecord) + header.nameSize
+                        + header.sourceSize;
+    if (memcmp(header.magic, DISK_MAGIC, sizeof DISK_MAGIC) != 0 || header.version != BYTECODE_VERSION
+        || body.size() != expected || hashText(body) != header.checksum
+        || header.tempCount < 0 || body.substr(body.size() - header.sourceSize) != source) {
+        return nullptr;
+    }
+    const char *p = body.data();
+    std::vector<int32_t> words(header.codeCount * 2);
+    if (!words.empty()) memcpy(words.data(), p, words.size() * 4);
+    p += words.size() * 4;
+    auto bytecode = std::make_shared<Bytecode>();
+    bytecode->lineStarts.resize(header.lineStartCount);
+    if (header.lineStartCount > 0) memcpy(bytecode->lineStarts.data(), p, header.lineStartCount * 4);
+    p += header.lineStartCount * 4;
+    const char *names = p + header.symbolCount * sizeof(NameRecord);
+    std::unordered_set<int> seen;
+    for (uint32_t i = 0; i < header.symbolCount; i++) {
+        NameRecord record;
+        memcpy(&record, p + i * sizeof record, sizeof record);
+        if (record.offset > header.nameSize || record.length > header.nameSize - record.offset) return nullptr;
+        int slot = SymbolTable::intern(std::string(names + record.offset, record.length));
+        if (!seen.insert(slot).second) return nullptr;
+        bytecode->slots.push_back(slot);
+    }
+    for (int start : bytecode->lineStarts) {
+        if (start < 0 || (uint32_t) start > header.codeCount) return nullptr;
+    }
+    bytecode->code.resize(header.codeCount);
+    for (uint32_t i = 0; i < header.codeCount; i++) {
+        int op = words[2 * i];
+        int operand = words[2 * i + 1];
+        if (op < OP_PUSH || op > OP_LINE) return nullptr;
+        if (hasSlotOperand(op)) {
+            if (operand < 0 || (uint32_t) operand >= header.symbolCount) return nullptr;
+        } else if (op >= OP_JUMP && op <= OP_JUMP_GE) {
+            if (operand < 0 || (uint32_t) operand > header.codeCount) return nullptr;
+        }
+        bytecode->code[i] = Instruction{(Opcode) op, operand};
+    }
+    bytecode->tempCount = header.tempCount;
+    if (!checkCode(*bytecode)) return nullptr;
+    return bytecode;
+}
+
+/*
+ * Implementation notes: writeDisk
+ * -------------------------------
+ * The file is written under a name of its own and renamed into place,
+ * so that a process reading the cache at the same time, or after this
+ * one was interrupted, sees either the whole file or none.  Failures
+ * are ignored: the cache only ever saves work.
+ */
+
+void CompileCache::writeDisk(const Hash &key, const std::string &source, const Bytecode &bytecode) {
+    static std::atomic<unsigned> serial(0);
+    std::string body;
+    auto append = [&body](const void *data, size_t size) { body.append((const char *) data, size); };
+    for (const Instruction &instruction : bytecode.code) {
+        int32_t words[2] = {instruction.op, instruction.operand};
+        append(words, sizeof words);
+    }
+    append(bytecode.lineStarts.data(), bytecode.lineStarts.size() * 4);
+    std::string names;
+    for (int slot : bytecode.slots) {
+        const std::string &name = SymbolTable::getName(slot);
+        NameRecord record = {(uint32_t) names.size(), (uint32_t) name.size()};
+        append(&record, sizeof record);
+        names += name;
+    }
+    body += names;
+    body += source;
+
+    DiskHeader header = {};
+    memcpy(header.magic, DISK_MAGIC, sizeof DISK_MAGIC);
+    header.version = BYTECODE_VERSION;
+    header.maxStack = bytecode.maxStack;
+    header.tempCount = bytecode.tempCount;
+    header.codeCount = (uint32_t) bytecode.code.size();
+    header.lineStartCount = (uint32_t) bytecode.lineStarts.size();
+    header.symbolCount = (uint32_t) bytecode.slots.size();
+    header.nameSize = (uint32_t) names.size();
+    header.sourceSize = (uint32_t) source.size();
+    header.checksum = hashText(body);
+
+    std::string path = diskPath(key);
+    std::string temp = path + "." + std::to_string(getpid()) + "." + std::to_string(serial++) + ".tmp";
+    FILE *file = fopen(temp.c_str(), "wb");
+    if (file == nullptr) return;
+    bool written = fwrite(&header, sizeof header, 1, file) == 1
+                   && fwrite(body.data(), 1, body.size(), file) == body.size();
+    if (fclose(file) != 0) written = false;
+    if (!written || rename(temp.c_str(), path.c_str()) != 0) unlink(temp.c_str());
+}
+
+/*
+ * Implementation notes: mixWord, mixBytes, finishHash
+ * ---------------------------------------------------
+ * A two-lane multiply-rotate hash in the style of MurmurHash3, whose
+ * finalizer spreads every input bit over the whole result.  The last
+ * word of every piece of text carries its length, which keeps the
+ * boundaries between pieces part of the hash.
+ */
+
+static void mixWord(uint64_t state[2], uint64_t word) {
+    uint64_t k1 = word * 0x87c37b91114253d5ULL;
+    k1 = (k1 << 31) | (k1 >> 33);
+    state[0] ^= k1 * 0x4cf5ad432745937fULL;
+    state[0] = ((state[0] << 27) | (state[0] >> 37)) + state[1];
+    state[0] = state[0] * 5 + 0x52dce729;
+    state[1] ^= word * 0x9e3779b97f4a7c15ULL;
+    state[1] = ((state[1] << 33) | (state[1] >> 31)) + state[0];
+    state[1] = state[1] * 5 + 0x38495ab5;
+}
+
+static void mixBytes(uint64_t state[2], std::string_view data) {
+    size_t i = 0;
+    for (; i + 8 <= data.size(); i += 8) {
+        uint64_t word;
+        memcpy(&word, data.data() + i, 8);
+        mixWord(state, word);
+    }
+    uint64_t word = 0;
+    memcpy(&word, data.data() + i, data.size() - i);
+    mixWord(state, word ^ (uint64_t) data.size() << 56);
+}
+
+static uint64_t finishHash(uint64_t value) {
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ULL;
+    value ^= value >> 33;
+    return value;
+}
+
+static uint64_t hashText(std::string_view text) {
+    uint64_t state[2] = {0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL};
+    mixBytes(state, text);
+    return finishHash(state[0] ^ finishHash(state[1]));
+}
+
+static bool hasSlotOperand(int op) {
+    switch (op) {
+        case OP_LOAD: case OP_LOAD_SAFE: case OP_STORE: case OP_SET: case OP_INPUT:
+        case OP_DIM: case OP_DIM2: case OP_INDEX: case OP_INDEX2: case OP_INDEX2_SAFE:
+        case OP_LOAD_ELEM: case OP_STORE_ELEM: case OP_SET_ELEM: case OP_INPUT_ELEM:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/*
+ * Implementation notes: checkCode
+ * -------------------------------
+ * Checks the operands that readDisk cannot check one instruction at a
+ * time and sets maxStack to the depth the code actually reaches.  The
+ * code must have the shape compileProgram gives it: lines that start
+ * in order at the first instruction, an OP_END at the last line start,
+ * and jumps only to line starts.  The stack is empty at every line
+ * start, so one pass in order finds the depth at every instruction;
+ * the code after OP_JUMP, OP_END or OP_FAIL up to the next line start
+ * can never run, and its depth is not checked.
+ */
+
+static bool checkCode(Bytecode &bytecode) {
+    const std::vector<Instruction> &code = bytecode.code;
+    const std::vector<int> &lineStarts = bytecode.lineStarts;
+    int n = (int) code.size();
+    int nLines = (int) lineStarts.size() - 1;
+    if (nLines < 0 || lineStarts[0] != 0 || lineStarts[nLines] != n - 1 || code[n - 1].op != OP_END) {
+        return false;
+    }
+    std::vector<char> isStart(n, 0);
+    for (int i = 0; i <= nLines; i++) {
+        if (i > 0 && lineStarts[i] < lineStarts[i - 1]) return false;
+        isStart[lineStarts[i]] = 1;
+    }
+    int depth = 0, maxDepth = 0;
+    bool reachable = true;
+    for (int i = 0; i < n; i++) {
+        const Instruction &in = code[i];
+        if (isStart[i]) {
+            if (reachable && depth != 0) return false;
+            depth = 0;
+            reachable = true;
+        }
+        switch (in.op) {
+            case OP_SAVE: case OP_RECALL:
+                if (in.operand < 0 || in.operand >= bytecode.tempCount) return false;
+                break;
+            case OP_FAIL:
+                if (in.operand <= STATUS_QUIT || in.operand > STATUS_NATIVE_MEMORY) return false;
+                break;
+            case OP_LINE:
+                if (in.operand < 0 || in.operand >= nLines) return false;
+                break;
+            default:
+                break;
+        }
+        StackEffect effect = stackEffect(in.op);
+        if (reachable) {
+            if (depth < effect.pops) return false;
+            depth += effect.pushes - effect.pops;
+            maxDepth = std::max(maxDepth, depth);
+        }
+        if (in.op >= OP_JUMP && in.op <= OP_JUMP_GE) {
+            if (in.operand >= n || !isStart[in.operand] || (reachable && depth != 0)) return false;
+        }
+        if (in.op == OP_JUMP || in.op == OP_END || in.op == OP_FAIL) reachable = false;
+    }
+    bytecode.maxStack = maxDepth;
+    return true;
+}
+
+static Statement *cloneStatement(Statement *stmt, Arena &arena) {
+    std::unordered_map<Expression *, Expression *> copies;
+    switch (stmt->getType()) {
+        case REM_STMT:
+            return arena.make<RemStatement>(arena.copyString(((RemStatement *) stmt)->getComment()));
+        case LET_STMT: {
+            auto *let = (LetStatement *) stmt;
+            if (let->getElement() != nullptr) {
+                auto *element = (ArrayExp *) cloneExp(let->getElement(), arena, copies);
+                return arena.make<LetStatement>(element, cloneExp(let->getExp(), arena, copies),
+                                                let->isReserved());
+            }
+            return arena.make<LetStatement>(let->getSlot(), cloneExp(let->getExp(), arena, copies),
+                                            let->isReserved());
+        }
+        case PRINT_STMT:
+            return arena.make<PrintStatement>(cloneExp(((PrintStatement *) stmt)->getExp(), arena, copies));
+        case INPUT_STMT: {
+            auto *input = (InputStatement *) stmt;
+            if (input->getElement() != nullptr) {
+                auto *element = (ArrayExp *) cloneExp(input->getElement(), arena, copies);
+                return arena.make<InputStatement>(element, input->isReserved());
+            }
+            return arena.make<InputStatement>(input->getSlot(), input->isReserved());
+        }
+        case DIM_STMT: {
+            auto *dim = (DimStatement *) stmt;
+            Expression *rowBound = cloneExp(dim->getBound(0), arena, copies);
+            Expression *columnBound = nullptr;
+            if (dim->getRank() == 2) columnBound = cloneExp(dim->getBound(1), arena, copies);
+            return arena.make<DimStatement>(dim->getSlot(), rowBound, columnBound);
+        }
+        case END_STMT:
+            return arena.make<EndStatement>();
+        case GOTO_STMT:
+            return arena.make<GotoStatement>(((GotoStatement *) stmt)->getTarget());
+        default: {
+            auto *ifStmt = (IfStatement *) stmt;
+            Expression *lhs = cloneExp(ifStmt->getLHS(), arena, copies);
+            Expression *rhs = cloneExp(ifStmt->getRHS(), arena, copies);
+            return arena.make<IfStatement>(lhs, ifStmt->getOperator(), rhs, ifStmt->getTarget());
+        }
+    }
+}
+
+static Expression *cloneExp(Expression *exp, Arena &arena,
+                            std::unordered_map<Expression *, Expression *> &copies) {
+    auto it = copies.find(exp);
+    if (it != copies.end()) return it->second;
+    Expression *copy;
+    switch (exp->getType()) {
+        case CONSTANT:
+            copy = arena.make<ConstantExp>(((ConstantExp *) exp)->getValue());
+            break;
+        case IDENTIFIER:
+            copy = arena.make<IdentifierExp>(((IdentifierExp *) exp)->getSlot());
+            break;
+        case ARRAY: {
+            auto *element = (ArrayExp *) exp;
+            Expression *row = cloneExp(element->getSubscript(0), arena, copies);
+            Expression *column = nullptr;
+            if (element->getRank() == 2) column = cloneExp(element->getSubscript(1), arena, copies);
+            copy = arena.make<ArrayExp>(element->getSlot(), row, column);
+            break;
+        }
+        default: {
+            auto *compound = (CompoundExp *) exp;
+            Expression *lhs = cloneExp(compound->getLHS(), arena, copies);
+            Expression *rhs = cloneExp(compound->getRHS(), arena, copies);
+            copy = arena.make<CompoundExp>(compound->getOperator(), lhs, rhs);
+            break;
+        }
+    }
+    copies.emplace(exp, copy);
+    return copy;
+}
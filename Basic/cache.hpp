@@ -0,0 +1,153 @@
+/*
+ * File: cache.h
+ * -------------
+ * This interface exports the CompileCache class, which lets the
+ * interpreter reuse the work it has already done on identical program
+ * text: the parsed form of a statement it has seen before, and the
+ * bytecode of a program it has run before.
+ */
+
+#ifndef _cache_h
+#define _cache_h
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "arena.hpp"
+#include "compiler.hpp"
+#include "lexer.hpp"
+#include "program.hpp"
+#include "statement.hpp"
+
+/*
+ * Class: CompileCache
+ * -------------------
+ * A process-wide cache shared by all sessions.  Entries are addressed
+ * by a hash of their text, so a statement is found again wherever it
+ * appears and whatever its line number, and a program whatever session
+ * entered it and however it was spaced.  Every entry also keeps its
+ * text, which a hit must match.  Compiled programs can also be kept
+ * in a directory, where they survive from one run of the interpreter
+ * to the next.
+ * Both parts of the cache hold a bounded amount of work and drop the
+ * least recently used entries first.  All methods may be called from
+ * several threads at once.
+ */
+
+class CompileCache {
+
+public:
+
+/*
+ * Method: setEnabled
+ * Usage: CompileCache::setEnabled(false);
+ * ---------------------------------------
+ * Turns the cache on or off.  It is on unless turned off.
+ */
+
+    static void setEnabled(bool enabled);
+
+/*
+ * Method: setDirectory
+ * Usage: if (!CompileCache::setDirectory(path)) ...
+ * -------------------------------------------------
+ * Keeps compiled programs in the named directory, which is created if
+ * it does not exist, in addition to memory.  Returns false, with errno
+ * set and compiled programs kept in memory only, if the directory
+ * cannot be created.
+ */
+
+    static bool setDirectory(const std::string &path);
+
+/*
+ * Method: parseLine
+ * Usage: Statement *stmt = CompileCache::parseLine(lexer, arena, failure);
+ * ------------------------------------------------------------------------
+ * Parses the statement that follows the line number of a program line
+ * and simplifies it with optimizeStatement, allocating it in arena.
+ * Syntax errors are reported exactly as parseStatement reports them,
+ * and are remembered as well.
+ */
+
+    static Statement *parseLine(Lexer &lexer, Arena &arena, Failure &failure);
+
+/*
+ * Method: compile
+ * Usage: std::shared_ptr<const Bytecode> code = CompileCache::compile(program, markLines);
+ * ----------------------------------------------------------------------------------------
+ * Returns the bytecode that compileProgram produces for the program.
+ */
+
+    static std::shared_ptr<const Bytecode> compile(Program &program, bool markLines);
+
+/*
+ * Method: report
+ * Usage: CompileCache::report();
+ * ------------------------------
+ * Prints the hit and miss counts and the sizes of the cache.
+ */
+
+    static void report();
+
+private:
+
+    struct Hash {
+        uint64_t high, low;
+        bool operator==(const Hash &other) const { return high == other.high && low == other.low; }
+    };
+
+    struct HashHasher {
+        size_t operator()(const Hash &hash) const { return (size_t) hash.low; }
+    };
+
+    struct LineEntry {
+        std::string text;               /* The statement text it holds  */
+        Statement *stmt = nullptr;      /* Optimized, or NULL if failed */
+        Failure failure;                /* The syntax error, if any     */
+        Arena arena;
+        std::list<uint64_t>::iterator use;
+    };
+
+    struct ProgramEntry {
+        std::string source;             /* The normalized program text  */
+        std::shared_ptr<const Bytecode> bytecode;
+        std::list<Hash>::iterator use;
+    };
+
+    struct Counts {
+        long long hits = 0, misses = 0;
+    };
+
+    bool enabled = true;
+    std::string directory;
+
+    std::mutex lineLock;
+    std::unordered_map<uint64_t, std::unique_ptr<LineEntry>> lines;
+    std::list<uint64_t> lineUses;       /* Most recently used first    */
+    std::vector<uint64_t> seen;         /* Hashes of recent statements */
+    Counts lineCounts;
+
+    std::mutex programLock;
+    std::unordered_map<Hash, ProgramEntry, HashHasher> programs;
+    std::list<Hash> programUses;        /* Most recently used first    */
+    size_t programSize = 0;             /* Instructions in all entries */
+    Counts programCounts;
+    Counts diskCounts;
+
+    CompileCache();
+    static CompileCache &instance();
+    void addLine(uint64_t key, std::unique_ptr<LineEntry> entry);
+    static std::string normalizeProgram(Program &program);
+    static Hash hashProgram(const std::string &source, bool markLines);
+    void addProgram(const Hash &key, std::string source, std::shared_ptr<const Bytecode> bytecode);
+    std::string diskPath(const Hash &key);
+    std::shared_ptr<const Bytecode> readDisk(const Hash &key, const std::string &source);
+    void writeDisk(const Hash &key, const std::string &source, const Bytecode &bytecode);
+
+};
+
+#endif
@@ -0,0 +1,345 @@
+/*
+ * File: compiler.cpp
+ * ------------------
+ * This file implements the compiler from parsed statements to the
+ * bytecode executed by the virtual machine.
+ */
+
+#include <algorithm>
+#include <unordered_map>
+#include "compiler.hpp"
+#include "dataflow.hpp"
+#include "statement.hpp"
+#include "verifier.hpp"
+
+/*
+ * Class: Compiler
+ * ---------------
+ * Holds the state of a single compilation: the bytecode under
+ * construction, the current operand stack depth and the jumps
+ * waiting for their target line to be resolved.
+ */
+
+class Compiler {
+
+public:
+
+    Compiler(Bytecode &bytecode, bool markLines) : out(bytecode), markLines(markLines) {}
+
+    void compile(Program &program);
+
+private:
+
+    struct Fixup {
+        int instruction;
+        int lineNumber;
+    };
+
+    Bytecode &out;
+    bool markLines;
+    std::vector<Fixup> fixups;
+    std::unordered_map<Expression *, int> uses;
+    std::unordered_map<Expression *, int> temps;
+    std::unordered_map<int, int> variables;
+    int depth = 0;
+
+    void emit(Opcode op, int operand = 0, int stackEffect = 0);
+    int variable(int slot);
+    void compileStatement(Statement *stmt);
+    void countUses(Expression *exp);
+    void compileExp(Expression *exp);
+    void compileElement(ArrayExp *element);
+    void compileJump(Opcode op, int lineNumber);
+
+};
+
+/*
+ * Implementation notes: compile
+ * -----------------------------
+ * Lines are compiled in the order of the program's line index, so
+ * falling through to the next line needs no instruction at all.
+ * Each jump target is resolved once, through the same index, when the
+ * offsets of all lines are known.
+ */
+
+void Compiler::compile(Program &program) {
+    int nLines = program.getLineCount();
+    std::vector<int> &lineStarts = out.lineStarts;
+    lineStarts.resize(nLines + 1);
+    for (int i = 0; i < nLines; i++) {
+        lineStarts[i] = (int) out.code.size();
+        if (markLines) emit(OP_LINE, i);
+        Statement *stmt = program.getStatementAt(i);
+        if (stmt != nullptr) compileStatement(stmt);
+    }
+    lineStarts[nLines] = (int) out.code.size();
+    emit(OP_END);
+    for (const Fixup &f : fixups) {
+        out.code[f.instruction].operand = lineStarts[program.getLineIndex(f.lineNumber)];
+    }
+}
+
+void Compiler::emit(Opcode op, int operand, int stackEffect) {
+    out.code.push_back({op, operand});
+    depth += stackEffect;
+    out.maxStack = std::max(out.maxStack, depth);
+}
+
+int Compiler::variable(int slot) {
+    auto result = variables.emplace(slot, (int) out.slots.size());
+    if (result.second) out.slots.push_back(slot);
+    return result.first->second;
+}
+
+/*
+ * Implementation notes: compileStatement
+ * --------------------------------------
+ * Each statement is lowered so that its observable behavior matches
+ * its execute method, including the order in which errors are raised.
+ * A statement that checkStatement rejects becomes an OP_FAIL
+ * instruction, placed where its execution would raise the error.
+ */
+
+void Compiler::compileStatement(Statement *stmt) {
+    uses.clear();
+    temps.clear();
+    Status fault = checkStatement(stmt);
+    switch (stmt->getType()) {
+        case LET_STMT: {
+            auto *let = (LetStatement *) stmt;
+            if (let->getElement() != nullptr) countUses(let->getElement());
+            countUses(let->getExp());
+            break;
+        }
+        case INPUT_STMT: {
+            ArrayExp *element = ((InputStatement *) stmt)->getElement();
+            if (element != nullptr) countUses(element);
+            break;
+        }
+        case DIM_STMT:
+            for (int k = 0; k < ((DimStatement *) stmt)->getRank(); k++) {
+                countUses(((DimStatement *) stmt)->getBound(k));
+            }
+            break;
+        case PRINT_STMT:
+            countUses(((PrintStatement *) stmt)->getExp());
+            break;
+        case IF_STMT:
+            countUses(((IfStatement *) stmt)->getLHS());
+            countUses(((IfStatement *) stmt)->getRHS());
+            break;
+        default:
+            break;
+    }
+    switch (stmt->getType()) {
+        case REM_STMT:
+            break;
+        case LET_STMT: {
+            auto *let = (LetStatement *) stmt;
+            if (fault != STATUS_OK) {
+                emit(OP_FAIL, fault);
+                break;
+            }
+            if (let->getElement() != nullptr) {
+                compileElement(let->getElement());
+                compileExp(let->getExp());
+                emit(OP_STORE_ELEM, variable(let->getSlot()), -2);
+                break;
+            }
+            compileExp(let->getExp());
+            emit(OP_STORE, variable(let->getSlot()), -1);
+            break;
+        }
+        case PRINT_STMT:
+            compileExp(((PrintStatement *) stmt)->getExp());
+            emit(OP_PRINT, 0, -1);
+            break;
+        case INPUT_STMT: {
+            auto *input = (InputStatement *) stmt;
+            if (fault != STATUS_OK) {
+                emit(OP_FAIL, fault);
+                break;
+            }
+            if (input->getElement() != nullptr) {
+                compileElement(input->getElement());
+                emit(OP_INPUT_ELEM, variable(input->getSlot()), -1);
+                break;
+            }
+            emit(OP_INPUT, variable(input->getSlot()));
+            break;
+        }
+        case DIM_STMT: {
+            auto *dim = (DimStatement *) stmt;
+            compileExp(dim->getBound(0));
+            if (dim->getRank() == 1) {
+                emit(OP_DIM, variable(dim->getSlot()), -1);
+            } else {
+                compileExp(dim->getBound(1));
+                emit(OP_DIM2, variable(dim->getSlot()), -2);
+            }
+            break;
+        }
+        case END_STMT:
+            emit(OP_END);
+            break;
+        case GOTO_STMT:
+            compileJump(OP_JUMP, ((GotoStatement *) stmt)->getTarget());
+            break;
+        case IF_STMT: {
+            auto *ifStmt = (IfStatement *) stmt;
+            compileExp(ifStmt->getLHS());
+            compileExp(ifStmt->getRHS());
+            if (fault != STATUS_OK) {
+                emit(OP_FAIL, fault, -2);
+                return;
+            }
+            Opcode jump;
+            switch (ifStmt->getOperator()) {
+                case EQ_OP: jump = OP_JUMP_EQ; break;
+                case LT_OP: jump = OP_JUMP_LT; break;
+                case GT_OP: jump = OP_JUMP_GT; break;
+                case LE_OP: jump = OP_JUMP_LE; break;
+                case GE_OP: jump = OP_JUMP_GE; break;
+                default: jump = OP_JUMP_NE; break;
+            }
+            depth -= 2;
+            compileJump(jump, ifStmt->getTarget());
+            break;
+        }
+    }
+}
+
+/*
+ * Implementation notes: countUses
+ * -------------------------------
+ * The optimizer may share a compound subexpression between several
+ * parents of the same statement.  Such nodes are counted here so that
+ * compileExp evaluates them once and reuses the saved value.  The
+ * children of a shared node are only counted the first time.  Array
+ * elements are never shared themselves, but their subscripts may be.
+ */
+
+void Compiler::countUses(Expression *exp) {
+    if (exp->getType() == ARRAY) {
+        auto *element = (ArrayExp *) exp;
+        for (int k = 0; k < element->getRank(); k++) countUses(element->getSubscript(k));
+        return;
+    }
+    if (exp->getType() != COMPOUND) return;
+    if (uses[exp]++ > 0) return;
+    countUses(((CompoundExp *) exp)->getLHS());
+    countUses(((CompoundExp *) exp)->getRHS());
+}
+
+/*
+ * Implementation notes: compileExp
+ * --------------------------------
+ * Expressions are compiled in the evaluation order of CompoundExp::eval:
+ * the left operand first, except for assignment, which checks its
+ * target before evaluating only the right operand.  The parser only
+ * builds compound nodes for =, +, -, * and /; a subtraction from the
+ * constant 0 is how the parser spells unary minus and becomes OP_NEG.
+ * An array element is located before anything is read from or stored
+ * into it, so a bad subscript is reported first, as in ArrayExp.
+ */
+
+void Compiler::compileExp(Expression *exp) {
+    switch (exp->getType()) {
+        case CONSTANT:
+            emit(OP_PUSH, ((ConstantExp *) exp)->getValue(), 1);
+            return;
+        case IDENTIFIER:
+            emit(OP_LOAD, variable(((IdentifierExp *) exp)->getSlot()), 1);
+            return;
+        case ARRAY:
+            compileElement((ArrayExp *) exp);
+            emit(OP_LOAD_ELEM, variable(((ArrayExp *) exp)->getSlot()));
+            return;
+        case COMPOUND:
+            break;
+    }
+    auto it = temps.find(exp);
+    if (it != temps.end()) {
+        emit(OP_RECALL, it->second, 1);
+        return;
+    }
+    auto *compound = (CompoundExp *) exp;
+    Operator op = compound->getOperator();
+    Expression *lhs = compound->getLHS();
+    if (op == ASSIGN_OP) {
+        if (lhs->getType() == ARRAY) {
+            compileElement((ArrayExp *) lhs);
+            compileExp(compound->getRHS());
+            emit(OP_SET_ELEM, variable(((ArrayExp *) lhs)->getSlot()), -1);
+        } else if (lhs->getType() != IDENTIFIER) {
+            emit(OP_FAIL, STATUS_ILLEGAL_ASSIGNMENT, 1);
+        } else if (((IdentifierExp *) lhs)->getKeyword() == KEYWORD_LET) {
+            emit(OP_FAIL, STATUS_SYNTAX_ERROR, 1);
+        } else {
+            compileExp(compound->getRHS());
+            emit(OP_SET, variable(((IdentifierExp *) lhs)->getSlot()));
+        }
+        return;
+    }
+    if (op == SUB_OP && lhs->getType() == CONSTANT && ((ConstantExp *) lhs)->getValue() == 0) {
+        compileExp(compound->getRHS());
+        emit(OP_NEG);
+    } else {
+        compileExp(lhs);
+        compileExp(compound->getRHS());
+        switch (op) {
+            case ADD_OP: emit(OP_ADD, 0, -1); break;
+            case SUB_OP: emit(OP_SUB, 0, -1); break;
+            case MUL_OP: emit(OP_MUL, 0, -1); break;
+            default: emit(OP_DIV, 0, -1); break;
+        }
+    }
+    if (uses[exp] > 1) {
+        int temp = (int) temps.size();
+        temps[exp] = temp;
+        out.tempCount = std::max(out.tempCount, temp + 1);
+        emit(OP_SAVE, temp);
+    }
+}
+
+void Compiler::compileElement(ArrayExp *element) {
+    compileExp(element->getSubscript(0));
+    if (element->getRank() == 1) {
+        emit(OP_INDEX, variable(element->getSlot()));
+    } else {
+        compileExp(element->getSubscript(1));
+        emit(OP_INDEX2, variable(element->getSlot()), -1);
+    }
+}
+
+void Compiler::compileJump(Opcode op, int lineNumber) {
+    fixups.push_back({(int) out.code.size(), lineNumber});
+    emit(op, -1);
+}
+
+StackEffect stackEffect(Opcode op) {
+    switch (op) {
+        case OP_PUSH: case OP_LOAD: case OP_LOAD_SAFE: case OP_RECALL:
+            return {0, 1};
+        case OP_SET: case OP_NEG: case OP_SAVE: case OP_INDEX: case OP_LOAD_ELEM:
+            return {1, 1};
+        case OP_STORE: case OP_PRINT: case OP_DIM: case OP_INPUT_ELEM:
+            return {1, 0};
+        case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV:
+        case OP_INDEX2: case OP_INDEX2_SAFE: case OP_SET_ELEM:
+            return {2, 1};
+        case OP_JUMP_EQ: case OP_JUMP_NE: case OP_JUMP_LT: case OP_JUMP_GT: case OP_JUMP_LE: case OP_JUMP_GE:
+        case OP_DIM2: case OP_STORE_ELEM:
+            return {2, 0};
+        default:
+            return {0, 0};
+    }
+}
+
+void compileProgram(Program &program, Bytecode &bytecode, bool markLines) {
+    bytecode = Bytecode();
+    Compiler compiler(bytecode, markLines);
+    compiler.compile(program);
+    markDefinedLoads(bytecode);
+    removeBoundsChecks(bytecode);
+}
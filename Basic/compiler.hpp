@@ -0,0 +1,159 @@
+/*
+ * File: compiler.h
+ * ----------------
+ * This interface exports the bytecode representation of a stored
+ * BASIC program together with the compiler that lowers the parsed
+ * statements of a Program into that form.  The bytecode is executed
+ * by the virtual machine defined in vm.h.
+ */
+
+#ifndef _compiler_h
+#define _compiler_h
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "program.hpp"
+#include "status.hpp"
+
+class NativeCode;
+
+/*
+ * Type: Opcode
+ * ------------
+ * The instruction set of the BASIC virtual machine.  The machine
+ * evaluates expressions on an operand stack; every instruction
+ * carries a single integer operand whose meaning depends on the
+ * opcode, as described next to each constant.
+ */
+
+enum Opcode {
+    OP_PUSH,        /* Push the constant operand                      */
+    OP_LOAD,        /* Push slot #operand (must be defined)           */
+    OP_LOAD_SAFE,   /* Push slot #operand, known to be defined        */
+    OP_STORE,       /* Pop the top value into slot #operand           */
+    OP_SET,         /* Copy the top value into slot #operand          */
+    OP_ADD,         /* Replace the top two values by their sum        */
+    OP_SUB,         /* ... by their difference                        */
+    OP_MUL,         /* ... by their product                           */
+    OP_DIV,         /* ... by their quotient (DIVIDE BY ZERO on 0)    */
+    OP_NEG,         /* Replace the top value by its negation          */
+    OP_SAVE,        /* Copy the top value into temporary #operand     */
+    OP_RECALL,      /* Push temporary #operand                        */
+    OP_JUMP,        /* Continue at instruction #operand               */
+    OP_JUMP_EQ,     /* Pop two values; jump to #operand if lhs = rhs  */
+    OP_JUMP_NE,     /* ... if lhs <> rhs                              */
+    OP_JUMP_LT,     /* ... if lhs < rhs                               */
+    OP_JUMP_GT,     /* ... if lhs > rhs                               */
+    OP_JUMP_LE,     /* ... if lhs <= rhs                              */
+    OP_JUMP_GE,     /* ... if lhs >= rhs                              */
+    OP_PRINT,       /* Pop the top value and print it                 */
+    OP_INPUT,       /* Read an integer into slot #operand             */
+    OP_DIM,         /* Pop n; make array #operand a list 0 to n       */
+    OP_DIM2,        /* Pop m, n; make it a table 0 to n by 0 to m     */
+    OP_INDEX,       /* Check the top value as a subscript of #operand */
+    OP_INDEX2,      /* Pop column, row; check them, push the position */
+    OP_INDEX2_SAFE, /* ... known to be in range, without the checks   */
+    OP_LOAD_ELEM,   /* Replace the top position by that element       */
+    OP_STORE_ELEM,  /* Pop a value and a position; store the element  */
+    OP_SET_ELEM,    /* ... and push the value back                    */
+    OP_INPUT_ELEM,  /* Pop a position; read an integer into it        */
+    OP_END,         /* Stop the program                               */
+    OP_FAIL,        /* Stop with the error Status #operand            */
+    OP_LINE         /* Line #operand of the index starts (profiling)  */
+};
+
+/*
+ * Constant: BYTECODE_VERSION
+ * --------------------------
+ * Identifies the code that compileProgram generates.  It must change
+ * whenever the instruction set or the code generated for some program
+ * changes, since compiled programs may be kept on disk.
+ */
+
+const int BYTECODE_VERSION = 4;
+
+/*
+ * Type: Instruction
+ * -----------------
+ * A single bytecode instruction.
+ */
+
+struct Instruction {
+    Opcode op;
+    int operand;
+};
+
+/*
+ * Type: StackEffect
+ * -----------------
+ * The number of values an instruction takes from the operand stack
+ * and the number it leaves in their place.
+ */
+
+struct StackEffect {
+    int pops;
+    int pushes;
+};
+
+/*
+ * Function: stackEffect
+ * Usage: StackEffect effect = stackEffect(op);
+ * --------------------------------------------
+ * Returns the effect on the operand stack of every instruction with
+ * opcode op, whatever its operand.
+ */
+
+StackEffect stackEffect(Opcode op);
+
+/*
+ * Type: Bytecode
+ * --------------
+ * The compiled form of a program.  Variables and arrays are numbered in
+ * the order in which the program first mentions them, and slots holds
+ * the SymbolTable slot of each, so that EvalState::bind can put them
+ * where the operands expect; jump operands are indices into code.  An
+ * element is addressed by its position from the start of its array,
+ * which OP_INDEX or OP_INDEX2 computes from the subscripts and checks.
+ * The final instruction is always OP_END so that control falling off
+ * the last line stops the machine.  Temporaries hold the values of
+ * shared subexpressions and never outlive the statement that computes
+ * them.  lineStarts holds the index of the first instruction of each
+ * line of the program, followed by the index of that final OP_END; the
+ * operand stack is empty at each of these points.  The virtual machine
+ * keeps the machine code translation of the program in native the first
+ * time a run needs it, and sets nativeTried even if the translation
+ * fails, so that every later run of the same bytecode shares the one
+ * attempt.
+ */
+
+struct Bytecode {
+    std::vector<Instruction> code;
+    std::vector<int> lineStarts;
+    std::vector<int> slots;
+    int maxStack = 0;
+    int tempCount = 0;
+    mutable std::shared_ptr<const NativeCode> native;
+    mutable bool nativeTried = false;
+};
+
+/*
+ * Function: compileProgram
+ * Usage: compileProgram(program, bytecode);
+ *        compileProgram(program, bytecode, markLines);
+ * ---------------------------------------------------
+ * Lowers every parsed statement of the program into bytecode, resolving
+ * GOTO and IF targets to instruction offsets.  Lines that have no
+ * parsed representation produce no code.  A jump to a line number
+ * that does not exist continues at the next line after it, matching
+ * the way the interpreter advances past a missing line.  If markLines
+ * is true, every line starts with an OP_LINE instruction for the
+ * profiler.  Loads of variables that are assigned on every path to
+ * them are finally turned into OP_LOAD_SAFE by markDefinedLoads, and
+ * the subscript checks that cannot fail are removed by
+ * removeBoundsChecks.
+ */
+
+void compileProgram(Program &program, Bytecode &bytecode, bool markLines = false);
+
+#endif
@@ -0,0 +1,796 @@
+/*
+ * File: dataflow.cpp
+ * ------------------
+ * This file implements the definite-assignment analysis and the
+ * analysis of subscript ranges.
+ */
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <deque>
+#include <set>
+#include <vector>
+#include "dataflow.hpp"
+
+/* Constants */
+
+static const long long MAX_BITS = 1LL << 24;  /* Bits in each set array */
+static const long long MAX_FACTS = 1LL << 21; /* Ranges over all blocks */
+static const int MAX_VISITS = 64;             /* Average visits a block */
+
+/*
+ * Type: FlowGraph
+ * ---------------
+ * The basic blocks of the bytecode, which begin at the start of the
+ * code, at every jump target and after every jump, OP_END and OP_FAIL.
+ * starts holds the first instruction of each block followed by the
+ * size of the code, and blockOf the block of each instruction.
+ */
+
+struct FlowGraph {
+    std::vector<int> starts;
+    std::vector<int> blockOf;
+    std::vector<std::vector<int>> preds;
+    std::vector<std::vector<int>> succs;
+    int size() const { return (int) starts.size() - 1; }
+};
+
+/* Private function prototypes */
+
+static void buildFlowGraph(const std::vector<Instruction> &code, FlowGraph &graph);
+static bool isJump(Opcode op);
+static bool isDefinition(Opcode op);
+
+/*
+ * Implementation notes: markDefinedLoads
+ * --------------------------------------
+ * For each basic block the analysis computes the set of variables
+ * that are defined whenever control enters it: nothing for the first
+ * block, and for the others the intersection of the sets with which
+ * their predecessors are left.  A variable never becomes undefined
+ * while a program runs, so leaving a block adds every variable that
+ * the block stores into.  Sets start out full and only shrink, and a
+ * worklist revisits a block whenever the set leaving a predecessor
+ * changes, which reaches the greatest fixed point.  Blocks that cannot
+ * be reached keep the full set; their loads never run.
+ *
+ * Only variables that are both loaded and stored somewhere are worth
+ * tracking.  The sets hold one bit per tracked variable and block, and
+ * if that would take more than MAX_BITS bits per array, the variables
+ * with the most loads are tracked and the others keep their checks.
+ */
+
+void markDefinedLoads(Bytecode &bytecode) {
+    std::vector<Instruction> &code = bytecode.code;
+    std::vector<int> loads(bytecode.slots.size()), stores(bytecode.slots.size());
+    for (const Instruction &in : code) {
+        if (in.op == OP_LOAD) loads[in.operand]++;
+        if (isDefinition(in.op)) stores[in.operand]++;
+    }
+
+    std::vector<int> candidates;
+    for (int slot = 0; slot < (int) bytecode.slots.size(); slot++) {
+        if (loads[slot] > 0 && stores[slot] > 0) candidates.push_back(slot);
+    }
+    if (candidates.empty()) return;
+    FlowGraph graph;
+    buildFlowGraph(code, graph);
+    const std::vector<int> &starts = graph.starts;
+    int nBlocks = graph.size();
+    long long limit = std::max(64LL, MAX_BITS / nBlocks / 64 * 64);
+    if ((long long) candidates.size() > limit) {
+        std::stable_sort(candidates.begin(), candidates.end(),
+                         [&](int a, int b) { return loads[a] > loads[b]; });
+        candidates.resize(limit);
+    }
+    std::vector<int> bit(bytecode.slots.size(), -1);
+    for (int i = 0; i < (int) candidates.size(); i++) bit[candidates[i]] = i;
+    int words = ((int) candidates.size() + 63) / 64;
+
+    std::vector<uint64_t> gen((size_t) nBlocks * words, 0);
+    for (int b = 0; b < nBlocks; b++) {
+        for (int i = starts[b]; i < starts[b + 1]; i++) {
+            if (isDefinition(code[i].op) && bit[code[i].operand] >= 0) {
+                int k = bit[code[i].operand];
+                gen[(size_t) b * words + k / 64] |= 1ULL << (k % 64);
+            }
+        }
+    }
+
+    std::vector<uint64_t> in((size_t) nBlocks * words, ~0ULL);
+    std::vector<uint64_t> out((size_t) nBlocks * words, ~0ULL);
+    std::fill(in.begin(), in.begin() + words, 0);
+    std::deque<int> worklist;
+    std::vector<char> queued(nBlocks, 1);
+    for (int b = 0; b < nBlocks; b++) worklist.push_back(b);
+    while (!worklist.empty()) {
+        int b = worklist.front();
+        worklist.pop_front();
+        queued[b] = 0;
+        uint64_t *blockIn = &in[(size_t) b * words];
+        if (b != 0 && !graph.preds[b].empty()) {
+            for (int w = 0; w < words; w++) {
+                uint64_t meet = ~0ULL;
+                for (int p : graph.preds[b]) meet &= out[(size_t) p * words + w];
+                blockIn[w] = meet;
+            }
+        }
+        bool changed = false;
+        for (int w = 0; w < words; w++) {
+            uint64_t word = blockIn[w] | gen[(size_t) b * words + w];
+            if (word != out[(size_t) b * words + w]) {
+                out[(size_t) b * words + w] = word;
+                changed = true;
+            }
+        }
+        if (!changed) continue;
+        for (int s : graph.succs[b]) {
+            if (!queued[s]) {
+                queued[s] = 1;
+                worklist.push_back(s);
+            }
+        }
+    }
+
+    std::vector<uint64_t> defined(words);
+    for (int b = 0; b < nBlocks; b++) {
+        std::copy(&in[(size_t) b * words], &in[(size_t) b * words] + words, defined.begin());
+        for (int i = starts[b]; i < starts[b + 1]; i++) {
+            Instruction &instruction = code[i];
+            int k = (instruction.op == OP_LOAD || isDefinition(instruction.op)) ? bit[instruction.operand] : -1;
+            if (k < 0) continue;
+            if (isDefinition(instruction.op)) {
+                defined[k / 64] |= 1ULL << (k % 64);
+            } else if (defined[k / 64] >> (k % 64) & 1) {
+                instruction.op = OP_LOAD_SAFE;
+            }
+        }
+    }
+}
+
+namespace {
+
+/*
+ * Type: Range
+ * -----------
+ * The values from lo to hi that a variable or a stack entry may hold.
+ */
+
+struct Range {
+    int lo;
+    int hi;
+};
+
+const Range ANY = {INT_MIN, INT_MAX};
+
+/*
+ * Type: Shape
+ * -----------
+ * What is known about an array: nothing if rank is 0, and otherwise
+ * that DIM has made it a list (rank 1) or a table (rank 2) whose
+ * subscripts run at least up to rows and columns.
+ */
+
+struct Shape {
+    int rank;
+    int rows;
+    int columns;
+};
+
+/*
+ * Type: Facts
+ * -----------
+ * The ranges of the tracked variables and the shapes of the tracked
+ * arrays whenever control enters a block, if it is reached at all.
+ */
+
+struct Facts {
+    bool reached = false;
+    std::vector<Range> vars;
+    std::vector<Shape> arrays;
+};
+
+/*
+ * Type: Entry
+ * -----------
+ * The range of a value on the operand stack, together with the
+ * tracked variable that holds the same value, or -1.
+ */
+
+struct Entry {
+    Range value;
+    int var;
+};
+
+/*
+ * Class: BoundsAnalysis
+ * ---------------------
+ * Computes the ranges of the subscripts of one program and removes the
+ * checks that they make redundant.
+ */
+
+class BoundsAnalysis {
+
+public:
+
+    explicit BoundsAnalysis(Bytecode &bytecode) : bytecode(bytecode) {}
+
+    void run();
+
+private:
+
+    Bytecode &bytecode;
+    FlowGraph graph;
+    std::vector<int> varOf;             /* Tracked variable of a slot   */
+    std::vector<int> arrayOf;           /* Tracked array of a slot      */
+    std::vector<int> thresholds;        /* Sorted widening bounds       */
+    std::vector<Facts> in;
+    std::vector<std::pair<int, Facts>> edges;
+
+    void chooseVariables();
+    void chooseThresholds();
+    bool solve();
+    bool transfer(int block, Facts facts, std::vector<char> *safe);
+    void leave(int target, Facts &facts);
+    bool merge(int block, const Facts &incoming, bool widen);
+    void compact(const std::vector<char> &safe);
+
+};
+
+/*
+ * Range arithmetic
+ * ----------------
+ * Each operation returns a range that contains every result of the
+ * operation on values from its operands.  Arithmetic in the program
+ * wraps around, so a result that might not fit in an int is ANY.
+ */
+
+Range fit(long long lo, long long hi) {
+    if (lo < INT_MIN || hi > INT_MAX) return ANY;
+    return {(int) lo, (int) hi};
+}
+
+Range add(Range a, Range b) {
+    return fit((long long) a.lo + b.lo, (long long) a.hi + b.hi);
+}
+
+Range subtract(Range a, Range b) {
+    return fit((long long) a.lo - b.hi, (long long) a.hi - b.lo);
+}
+
+Range multiply(Range a, Range b) {
+    long long p[] = {(long long) a.lo * b.lo, (long long) a.lo * b.hi,
+                     (long long) a.hi * b.lo, (long long) a.hi * b.hi};
+    return fit(*std::min_element(p, p + 4), *std::max_element(p, p + 4));
+}
+
+/*
+ * Implementation notes: divide
+ * ----------------------------
+ * For divisors of one sign, truncating division is monotonic in each
+ * operand, so the extremes are among the quotients of the corners.  A
+ * divisor range that spans 0 is split into its negative and positive
+ * parts, since dividing by 0 stops the program.
+ */
+
+Range divide(Range a, Range b) {
+    if (b.lo <= 0 && b.hi >= 0) {
+        bool negative = b.lo < 0, positive = b.hi > 0;
+        if (!negative && !positive) return ANY;
+        Range low = negative ? divide(a, {b.lo, -1}) : divide(a, {1, b.hi});
+        Range high = positive ? divide(a, {1, b.hi}) : low;
+        return {std::min(low.lo, high.lo), std::max(low.hi, high.hi)};
+    }
+    long long q[] = {(long long) a.lo / b.lo, (long long) a.lo / b.hi,
+                     (long long) a.hi / b.lo, (long long) a.hi / b.hi};
+    return fit(*std::min_element(q, q + 4), *std::max_element(q, q + 4));
+}
+
+Range negate(Range a) {
+    return fit(-(long long) a.hi, -(long long) a.lo);
+}
+
+/*
+ * Implementation notes: constrain
+ * -------------------------------
+ * Narrows x to the values that can satisfy x op y for some value y in
+ * r, where op is the condition of a jump, and returns false if there
+ * are none.
+ */
+
+bool constrain(Range &x, Opcode op, Range r) {
+    long long lo = x.lo, hi = x.hi;
+    switch (op) {
+        case OP_JUMP_EQ: lo = std::max(lo, (long long) r.lo); hi = std::min(hi, (long long) r.hi); break;
+        case OP_JUMP_LT: hi = std::min(hi, r.hi - 1LL); break;
+        case OP_JUMP_LE: hi = std::min(hi, (long long) r.hi); break;
+        case OP_JUMP_GT: lo = std::max(lo, r.lo + 1LL); break;
+        case OP_JUMP_GE: lo = std::max(lo, (long long) r.lo); break;
+        default:
+            if (r.lo == r.hi && lo == r.lo) lo++;
+            if (r.lo == r.hi && hi == r.hi) hi--;
+            break;
+    }
+    if (lo > hi) return false;
+    x = {(int) lo, (int) hi};
+    return true;
+}
+
+Opcode negateCondition(Opcode op) {
+    switch (op) {
+        case OP_JUMP_EQ: return OP_JUMP_NE;
+        case OP_JUMP_LT: return OP_JUMP_GE;
+        case OP_JUMP_GT: return OP_JUMP_LE;
+        case OP_JUMP_LE: return OP_JUMP_GT;
+        case OP_JUMP_GE: return OP_JUMP_LT;
+        default: return OP_JUMP_EQ;
+    }
+}
+
+Opcode swapCondition(Opcode op) {
+    switch (op) {
+        case OP_JUMP_LT: return OP_JUMP_GT;
+        case OP_JUMP_GT: return OP_JUMP_LT;
+        case OP_JUMP_LE: return OP_JUMP_GE;
+        case OP_JUMP_GE: return OP_JUMP_LE;
+        default: return op;
+    }
+}
+
+bool contains(int lo, int hi, Range r) {
+    return r.lo >= lo && r.hi <= hi;
+}
+
+/*
+ * Implementation notes: run
+ * -------------------------
+ * The analysis computes, for every basic block, the range of each
+ * tracked variable and the shape of each tracked array on entry, and
+ * then replays each reached block from those facts to find the checks
+ * whose subscripts always lie within the shape of their array.  Only
+ * the variables that can affect a subscript or a bound are tracked;
+ * see chooseVariables.  If the facts do not settle within MAX_VISITS
+ * visits per block on average, every check is kept.
+ */
+
+void BoundsAnalysis::run() {
+    const std::vector<Instruction> &code = bytecode.code;
+    bool indexed = false;
+    for (const Instruction &in : code) {
+        if (in.op == OP_INDEX || in.op == OP_INDEX2) indexed = true;
+    }
+    if (!indexed) return;
+    buildFlowGraph(code, graph);
+    chooseVariables();
+    chooseThresholds();
+    if (!solve()) return;
+    std::vector<char> safe(code.size(), 0);
+    for (int b = 0; b < graph.size(); b++) {
+        if (in[b].reached) transfer(b, in[b], &safe);
+        edges.clear();
+    }
+    compact(safe);
+}
+
+/*
+ * Implementation notes: chooseVariables
+ * -------------------------------------
+ * A variable matters if it is loaded by a line that indexes or
+ * dimensions an array, or by a line that assigns a variable that
+ * matters, or by an IF that compares a variable that matters.  The
+ * closure is computed line by line with a worklist of variables.  If
+ * the ranges of every tracked variable in every block would take more
+ * than MAX_FACTS entries, the variables with the most loads are kept.
+ * Every array that is indexed is tracked.
+ */
+
+void BoundsAnalysis::chooseVariables() {
+    const std::vector<Instruction> &code = bytecode.code;
+    const std::vector<int> &lineStarts = bytecode.lineStarts;
+    int nLines = (int) lineStarts.size() - 1;
+    int nSlots = (int) bytecode.slots.size();
+    std::vector<std::vector<int>> loadsOf(nLines);
+    std::vector<std::vector<int>> linesOf(nSlots);
+    std::vector<int> loads(nSlots, 0);
+    std::vector<char> relevant(nSlots, 0);
+    std::vector<char> expanded(nLines, 0);
+    std::vector<int> worklist;
+    arrayOf.assign(nSlots, -1);
+    int nArrays = 0;
+    for (int line = 0; line < nLines; line++) {
+        bool seeds = false;
+        int last = lineStarts[line + 1] - 1;
+        for (int i = lineStarts[line]; i <= last; i++) {
+            const Instruction &in = code[i];
+            if (in.op == OP_LOAD || in.op == OP_LOAD_SAFE) {
+                loadsOf[line].push_back(in.operand);
+                loads[in.operand]++;
+            }
+            if (isDefinition(in.op)) linesOf[in.operand].push_back(line);
+            if (in.op == OP_INDEX || in.op == OP_INDEX2) {
+                if (arrayOf[in.operand] < 0) arrayOf[in.operand] = nArrays++;
+                seeds = true;
+            }
+            if (in.op == OP_DIM || in.op == OP_DIM2) seeds = true;
+        }
+        if (last >= lineStarts[line] && isJump(code[last].op) && code[last].op != OP_JUMP) {
+            for (int slot : loadsOf[line]) linesOf[slot].push_back(line);
+        }
+        if (!seeds) continue;
+        expanded[line] = 1;
+        for (int slot : loadsOf[line]) {
+            if (!relevant[slot]) {
+                relevant[slot] = 1;
+                worklist.push_back(slot);
+            }
+        }
+    }
+    while (!worklist.empty()) {
+        int slot = worklist.back();
+        worklist.pop_back();
+        for (int line : linesOf[slot]) {
+            if (expanded[line]) continue;
+            expanded[line] = 1;
+            for (int other : loadsOf[line]) {
+                if (!relevant[other]) {
+                    relevant[other] = 1;
+                    worklist.push_back(other);
+                }
+            }
+        }
+    }
+
+    std::vector<int> candidates;
+    for (int slot = 0; slot < nSlots; slot++) {
+        if (relevant[slot]) candidates.push_back(slot);
+    }
+    long long limit = MAX_FACTS / graph.size();
+    if ((long long) candidates.size() > limit) {
+        std::stable_sort(candidates.begin(), candidates.end(),
+                         [&](int a, int b) { return loads[a] > loads[b]; });
+        candidates.resize(limit);
+    }
+    varOf.assign(nSlots, -1);
+    for (int k = 0; k < (int) candidates.size(); k++) varOf[candidates[k]] = k;
+    in.assign(graph.size(), Facts());
+    in[0].reached = true;
+    in[0].vars.assign(candidates.size(), ANY);
+    in[0].arrays.assign(nArrays, {0, 0, 0});
+}
+
+/*
+ * Implementation notes: chooseThresholds
+ * --------------------------------------
+ * A range that grows each time round a loop is widened to the next of
+ * the program's constants, one less than them or one more, and beyond
+ * the last of those to the limit of an int.  Loops usually count up to
+ * or down from one of these values, so the widened range still bounds
+ * the counter.
+ */
+
+void BoundsAnalysis::chooseThresholds() {
+    thresholds.assign(1, 0);
+    for (const Instruction &in : bytecode.code) {
+        if (in.op != OP_PUSH) continue;
+        long long c = in.operand;
+        for (long long t = c - 1; t <= c + 1; t++) {
+            if (t >= INT_MIN && t <= INT_MAX) thresholds.push_back((int) t);
+        }
+    }
+    std::sort(thresholds.begin(), thresholds.end());
+    thresholds.erase(std::unique(thresholds.begin(), thresholds.end()), thresholds.end());
+}
+
+/*
+ * Implementation notes: solve
+ * ---------------------------
+ * A block is a loop head if some jump leads back to it from a block
+ * that does not come before it, and every cycle passes through one.
+ * Facts are merged into a loop head with widening, which moves each
+ * growing bound to a threshold, so the facts reach a fixed point.  The
+ * worklist takes the blocks in program order.
+ */
+
+bool BoundsAnalysis::solve() {
+    int nBlocks = graph.size();
+    std::vector<char> loopHead(nBlocks, 0);
+    for (int b = 0; b < nBlocks; b++) {
+        for (int s : graph.succs[b]) {
+            if (s <= b) loopHead[s] = 1;
+        }
+    }
+    std::set<int> worklist = {0};
+    long long visits = (long long) MAX_VISITS * nBlocks;
+    while (!worklist.empty()) {
+        if (--visits < 0) return false;
+        int b = *worklist.begin();
+        worklist.erase(worklist.begin());
+        edges.clear();
+        transfer(b, in[b], nullptr);
+        for (const auto &edge : edges) {
+            if (merge(edge.first, edge.second, loopHead[edge.first])) worklist.insert(edge.first);
+        }
+    }
+    return true;
+}
+
+/*
+ * Implementation notes: transfer
+ * ------------------------------
+ * Executes the block on ranges instead of values, starting from facts,
+ * and adds the facts with which control leaves it to edges.  Each way
+ * out of a conditional jump narrows the variables compared by it.  A
+ * check that passes narrows its subscripts, and a DIM that succeeds
+ * sets the shape of its array.  If safe is not NULL, the checks that
+ * cannot fail are marked in it.  Returns false if the end of the block
+ * cannot be reached.
+ */
+
+bool BoundsAnalysis::transfer(int block, Facts facts, std::vector<char> *safe) {
+    const std::vector<Instruction> &code = bytecode.code;
+    std::vector<Entry> stack;
+    std::vector<Range> temps(bytecode.tempCount, ANY);
+    auto pop = [&]() {
+        if (stack.empty()) return Entry{ANY, -1};
+        Entry entry = stack.back();
+        stack.pop_back();
+        return entry;
+    };
+    auto assign = [&](int slot, Range value) {
+        int k = varOf[slot];
+        if (k < 0) return;
+        for (Entry &entry : stack) {
+            if (entry.var == k) entry.var = -1;
+        }
+        facts.vars[k] = value;
+    };
+    auto narrow = [&](Entry &entry, int lo) {
+        if (entry.value.hi < lo) return false;
+        entry.value.lo = std::max(entry.value.lo, lo);
+        if (entry.var >= 0) facts.vars[entry.var] = entry.value;
+        return true;
+    };
+    for (int i = graph.starts[block]; i < graph.starts[block + 1]; i++) {
+        const Instruction &in = code[i];
+        switch (in.op) {
+            case OP_PUSH:
+                stack.push_back({{in.operand, in.operand}, -1});
+                break;
+            case OP_LOAD: case OP_LOAD_SAFE: {
+                int k = varOf[in.operand];
+                stack.push_back({(k >= 0) ? facts.vars[k] : ANY, k});
+                break;
+            }
+            case OP_STORE:
+                assign(in.operand, pop().value);
+                break;
+            case OP_SET:
+                if (stack.empty()) stack.push_back({ANY, -1});
+                assign(in.operand, stack.back().value);
+                stack.back().var = varOf[in.operand];
+                break;
+            case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: {
+                Range b = pop().value, a = pop().value;
+                Range r = (in.op == OP_ADD) ? add(a, b) : (in.op == OP_SUB) ? subtract(a, b)
+                        : (in.op == OP_MUL) ? multiply(a, b) : divide(a, b);
+                stack.push_back({r, -1});
+                break;
+            }
+            case OP_NEG:
+                stack.push_back({negate(pop().value), -1});
+                break;
+            case OP_SAVE:
+                temps[in.operand] = stack.empty() ? ANY : stack.back().value;
+                break;
+            case OP_RECALL:
+                stack.push_back({temps[in.operand], -1});
+                break;
+            case OP_JUMP:
+                leave(graph.blockOf[in.operand], facts);
+                return true;
+            case OP_JUMP_EQ: case OP_JUMP_NE: case OP_JUMP_LT:
+            case OP_JUMP_GT: case OP_JUMP_LE: case OP_JUMP_GE: {
+                Entry rhs = pop(), lhs = pop();
+                Opcode conditions[] = {in.op, negateCondition(in.op)};
+                int targets[] = {graph.blockOf[in.operand], graph.blockOf[i + 1]};
+                for (int way = 0; way < 2; way++) {
+                    Facts out = facts;
+                    bool feasible = true;
+                    if (lhs.var >= 0) feasible = constrain(out.vars[lhs.var], conditions[way], rhs.value);
+                    if (feasible && rhs.var >= 0) {
+                        feasible = constrain(out.vars[rhs.var], swapCondition(conditions[way]), lhs.value);
+                    }
+                    if (feasible) leave(targets[way], out);
+                }
+                return true;
+            }
+            case OP_PRINT:
+                pop();
+                break;
+            case OP_INPUT:
+                assign(in.operand, ANY);
+                break;
+            case OP_DIM: case OP_DIM2: {
+                Range columns = (in.op == OP_DIM2) ? pop().value : Range{0, 0};
+                Range rows = pop().value;
+                if (rows.hi < 0 || columns.hi < 0) return false;
+                int a = arrayOf[in.operand];
+                int rank = (in.op == OP_DIM) ? 1 : 2;
+                if (a >= 0) facts.arrays[a] = {rank, std::max(rows.lo, 0), std::max(columns.lo, 0)};
+                break;
+            }
+            case OP_INDEX: {
+                if (stack.empty()) stack.push_back({ANY, -1});
+                Shape shape = facts.arrays[arrayOf[in.operand]];
+                Entry &row = stack.back();
+                if (shape.rank == 2) return false;
+                if (safe != nullptr && shape.rank == 1 && contains(0, shape.rows, row.value)) (*safe)[i] = 1;
+                if (!narrow(row, 0)) return false;
+                break;
+            }
+            case OP_INDEX2: case OP_INDEX2_SAFE: {
+                Entry column = pop(), row = pop();
+                Shape shape = facts.arrays[arrayOf[in.operand]];
+                if (shape.rank == 1) return false;
+                if (safe != nullptr && shape.rank == 2 && contains(0, shape.rows, row.value)
+                        && contains(0, shape.columns, column.value)) {
+                    (*safe)[i] = 1;
+                }
+                if (!narrow(row, 0) || !narrow(column, 0)) return false;
+                stack.push_back({{0, INT_MAX}, -1});
+                break;
+            }
+            case OP_LOAD_ELEM:
+                pop();
+                stack.push_back({ANY, -1});
+                break;
+            case OP_STORE_ELEM:
+                pop();
+                pop();
+                break;
+            case OP_SET_ELEM: {
+                Entry value = pop();
+                pop();
+                stack.push_back(value);
+                break;
+            }
+            case OP_INPUT_ELEM:
+                pop();
+                break;
+            case OP_END: case OP_FAIL:
+                return false;
+            case OP_LINE:
+                break;
+        }
+    }
+    if (block + 1 < graph.size()) leave(block + 1, facts);
+    return true;
+}
+
+void BoundsAnalysis::leave(int target, Facts &facts) {
+    edges.emplace_back(target, facts);
+}
+
+/*
+ * Implementation notes: merge
+ * ---------------------------
+ * Joins incoming into the facts of block and returns true if they
+ * changed.  Ranges are joined by taking the smallest range containing
+ * both, and shapes by keeping what both guarantee.  With widening, a
+ * bound that moves goes to the next threshold instead, and a shape
+ * that changes is forgotten.
+ */
+
+bool BoundsAnalysis::merge(int block, const Facts &incoming, bool widen) {
+    Facts &facts = in[block];
+    if (!facts.reached) {
+        facts = incoming;
+        facts.reached = true;
+        return true;
+    }
+    bool changed = false;
+    for (size_t k = 0; k < facts.vars.size(); k++) {
+        Range &old = facts.vars[k];
+        Range value = incoming.vars[k];
+        if (value.lo < old.lo) {
+            auto it = std::upper_bound(thresholds.begin(), thresholds.end(), value.lo);
+            old.lo = (!widen) ? value.lo : (it == thresholds.begin()) ? INT_MIN : *(it - 1);
+            changed = true;
+        }
+        if (value.hi > old.hi) {
+            auto it = std::lower_bound(thresholds.begin(), thresholds.end(), value.hi);
+            old.hi = (!widen) ? value.hi : (it == thresholds.end()) ? INT_MAX : *it;
+            changed = true;
+        }
+    }
+    for (size_t a = 0; a < facts.arrays.size(); a++) {
+        Shape &old = facts.arrays[a];
+        Shape shape = incoming.arrays[a];
+        if (old.rank == 0) continue;
+        if (shape.rank == old.rank && shape.rows >= old.rows && shape.columns >= old.columns) continue;
+        if (widen || shape.rank != old.rank) {
+            old = {0, 0, 0};
+        } else {
+            old.rows = std::min(old.rows, shape.rows);
+            old.columns = std::min(old.columns, shape.columns);
+        }
+        changed = true;
+    }
+    return changed;
+}
+
+/*
+ * Implementation notes: compact
+ * -----------------------------
+ * Safe two-dimensional checks keep their instruction, which still
+ * computes the position, in its unchecked form.  Safe OP_INDEX
+ * instructions are deleted, which never removes the start of a line,
+ * and every instruction index in the bytecode is renumbered.
+ */
+
+void BoundsAnalysis::compact(const std::vector<char> &safe) {
+    std::vector<Instruction> &code = bytecode.code;
+    int n = (int) code.size();
+    std::vector<int> renumber(n + 1);
+    int kept = 0;
+    for (int i = 0; i < n; i++) {
+        renumber[i] = kept;
+        if (safe[i] && code[i].op == OP_INDEX) continue;
+        if (safe[i]) code[i].op = OP_INDEX2_SAFE;
+        code[kept++] = code[i];
+    }
+    renumber[n] = kept;
+    if (kept == n) return;
+    code.resize(kept);
+    for (Instruction &in : code) {
+        if (isJump(in.op)) in.operand = renumber[in.operand];
+    }
+    for (int &start : bytecode.lineStarts) start = renumber[start];
+}
+
+}
+
+void removeBoundsChecks(Bytecode &bytecode) {
+    BoundsAnalysis analysis(bytecode);
+    analysis.run();
+}
+
+static void buildFlowGraph(const std::vector<Instruction> &code, FlowGraph &graph) {
+    int n = (int) code.size();
+    std::vector<char> leader(n + 1);
+    leader[0] = 1;
+    for (int i = 0; i < n; i++) {
+        Opcode op = code[i].op;
+        if (isJump(op)) leader[code[i].operand] = 1;
+        if (isJump(op) || op == OP_END || op == OP_FAIL) leader[i + 1] = 1;
+    }
+    graph.starts.clear();
+    graph.blockOf.assign(n + 1, 0);
+    for (int i = 0; i < n; i++) {
+        if (leader[i]) graph.starts.push_back(i);
+        graph.blockOf[i] = (int) graph.starts.size() - 1;
+    }
+    int nBlocks = (int) graph.starts.size();
+    graph.starts.push_back(n);
+    graph.blockOf[n] = nBlocks;
+
+    graph.preds.assign(nBlocks, std::vector<int>());
+    graph.succs.assign(nBlocks, std::vector<int>());
+    for (int b = 0; b < nBlocks; b++) {
+        int last = graph.starts[b + 1] - 1;
+        Opcode op = code[last].op;
+        if (isJump(op)) graph.succs[b].push_back(graph.blockOf[code[last].operand]);
+        if (op != OP_JUMP && op != OP_END && op != OP_FAIL && last + 1 < n) graph.succs[b].push_back(b + 1);
+        for (int s : graph.succs[b]) graph.preds[s].push_back(b);
+    }
+}
+
+static bool isJump(Opcode op) {
+    return op == OP_JUMP || op == OP_JUMP_EQ || op == OP_JUMP_NE || op == OP_JUMP_LT
+        || op == OP_JUMP_GT || op == OP_JUMP_LE || op == OP_JUMP_GE;
+}
+
+static bool isDefinition(Opcode op) {
+    return op == OP_STORE || op == OP_SET || op == OP_INPUT;
+}
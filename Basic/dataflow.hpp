@@ -0,0 +1,45 @@
+/*
+ * File: dataflow.h
+ * ----------------
+ * This interface exports the analyses that the compiler runs over the
+ * bytecode of every program to remove runtime checks that cannot fail.
+ */
+
+#ifndef _dataflow_h
+#define _dataflow_h
+
+#include "compiler.hpp"
+
+/*
+ * Function: markDefinedLoads
+ * Usage: markDefinedLoads(bytecode);
+ * ----------------------------------
+ * Replaces each OP_LOAD whose variable is assigned on every path from
+ * the start of the program to it by OP_LOAD_SAFE, which reads the
+ * variable without checking that it is defined.  The analysis follows
+ * every jump, including both ways out of each IF, and counts only
+ * LET, INPUT and assignments within expressions as definitions.  A
+ * variable set before RUN, or by an earlier run, is not assumed to be
+ * defined, so the loads of such variables keep their check.
+ */
+
+void markDefinedLoads(Bytecode &bytecode);
+
+/*
+ * Function: removeBoundsChecks
+ * Usage: removeBoundsChecks(bytecode);
+ * ------------------------------------
+ * Removes the subscript checks that cannot fail: an OP_INDEX is
+ * deleted, and an OP_INDEX2 becomes OP_INDEX2_SAFE, when on every
+ * path to it DIM has made the array large enough for every value its
+ * subscripts can take there.  Those values are bounded by constants,
+ * arithmetic and the comparisons of the IF statements along the way,
+ * so a subscript that a loop counts up to the size of the array keeps
+ * no check.  Jump targets and lineStarts are adjusted to the shorter
+ * code.  As in markDefinedLoads, nothing is assumed about variables
+ * and arrays that exist before RUN.
+ */
+
+void removeBoundsChecks(Bytecode &bytecode);
+
+#endif
@@ -7,11 +7,52 @@
  */
 
 
+#include <algorithm>
+#include <new>
 #include "evalstate.hpp"
 
 
 //using namespace std;
 
+/* Implementation of the SymbolTable class */
+
+SymbolTable &SymbolTable::instance() {
+    static SymbolTable table;
+    return table;
+}
+
+/*
+ * Implementation notes: SymbolTable
+ * ---------------------------------
+ * Every access holds the table's lock, since sessions running on
+ * other threads may intern new names at any time.  The names are kept
+ * in a deque, which never moves its elements, so the references that
+ * getName returns stay valid after the lock is released.
+ */
+
+int SymbolTable::intern(const std::string &name) {
+    SymbolTable &table = instance();
+    std::lock_guard<std::mutex> guard(table.lock);
+    auto it = table.slots.find(name);
+    if (it != table.slots.end()) return it->second;
+    int slot = (int) table.names.size();
+    table.names.push_back(name);
+    table.slots.emplace(name, slot);
+    return slot;
+}
+
+const std::string &SymbolTable::getName(int slot) {
+    SymbolTable &table = instance();
+    std::lock_guard<std::mutex> guard(table.lock);
+    return table.names[slot];
+}
+
+int SymbolTable::size() {
+    SymbolTable &table = instance();
+    std::lock_guard<std::mutex> guard(table.lock);
+    return (int) table.names.size();
+}
+
 /* Implementation of the EvalState class */
 
 EvalState::EvalState() {
@@ -22,20 +63,150 @@ EvalState::~EvalState() {
     /* Empty */
 }
 
-void EvalState::setValue(std::string var, int value) {
-    if(isDefined(var)) symbolTable[var] = value;
-    else symbolTable.emplace(var,value);
+void EvalState::setValue(const std::string &var, int value) {
+    setValue(SymbolTable::intern(var), value);
 }
 
-int EvalState::getValue(std::string var) {
-    if(isDefined(var)) return symbolTable[var];
-    else return 0;
+int EvalState::getValue(const std::string &var) {
+    return getValue(SymbolTable::intern(var));
 }
 
-bool EvalState::isDefined(std::string var) {
-    return symbolTable.find(var)!=symbolTable.end();
+bool EvalState::isDefined(const std::string &var) {
+    return isDefined(SymbolTable::intern(var));
+}
+
+void EvalState::setValue(int slot, int value) {
+    int index = position(slot);
+    values[index] = value;
+    defined[index] = 1;
+}
+
+int EvalState::getValue(int slot) const {
+    int index = find(slot);
+    return (index >= 0 && defined[index]) ? values[index] : 0;
+}
+
+bool EvalState::isDefined(int slot) const {
+    int index = find(slot);
+    return index >= 0 && defined[index];
+}
+
+int EvalState::find(int slot) const {
+    auto it = positions.find(slot);
+    return (it == positions.end()) ? -1 : it->second;
+}
+
+int EvalState::position(int slot) {
+    auto result = positions.emplace(slot, (int) slots.size());
+    if (result.second) {
+        slots.push_back(slot);
+        values.push_back(0);
+        defined.push_back(0);
+        arrays.emplace_back();
+        storage.emplace_back();
+    }
+    return result.first->second;
+}
+
+/*
+ * Implementation notes: bind
+ * --------------------------
+ * The names are put in place one position at a time.  A name already
+ * at a later position changes places with the one at position k, so
+ * every name keeps its value and array and the positions before k are
+ * never disturbed again.  A program that runs again finds its names
+ * already in place, which a single comparison recognizes without
+ * looking any of them up.
+ */
+
+void EvalState::bind(const std::vector<int> &order) {
+    int n = (int) order.size();
+    if (n <= (int) slots.size() && std::equal(order.begin(), order.end(), slots.begin())) return;
+    for (int k = 0; k < n; k++) {
+        if (k < (int) slots.size() && slots[k] == order[k]) continue;
+        int index = position(order[k]);
+        if (index != k) exchange(index, k);
+    }
+}
+
+void EvalState::exchange(int i, int j) {
+    std::swap(slots[i], slots[j]);
+    std::swap(values[i], values[j]);
+    std::swap(defined[i], defined[j]);
+    std::swap(arrays[i], arrays[j]);
+    storage[i].swap(storage[j]);
+    positions[slots[i]] = i;
+    positions[slots[j]] = j;
+}
+
+/*
+ * Implementation notes: dimension
+ * -------------------------------
+ * The elements of each array live in a vector of their own, and the
+ * Array record points at its data.  Growing the vector of vectors
+ * moves the element vectors without moving their data, so the record
+ * stays valid until DIM replaces the array.  The new elements are
+ * allocated before the old ones are released, so that the old array
+ * survives a failed allocation, and that failure is reported like any
+ * other invalid dimension rather than ending the process.  The
+ * virtual machine calls dimensionAt with the position of the array.
+ */
+
+Status EvalState::dimension(int slot, int bound) {
+    return dimensionAt(position(slot), bound);
+}
+
+Status EvalState::dimension(int slot, int rowBound, int columnBound) {
+    return dimensionAt(position(slot), rowBound, columnBound);
+}
+
+Status EvalState::dimensionAt(int index, int bound) {
+    if (bound < 0) return STATUS_INVALID_DIMENSION;
+    Status status = allocate(index, bound + 1LL);
+    if (status != STATUS_OK) return status;
+    arrays[index].length = bound + 1;
+    return STATUS_OK;
+}
+
+Status EvalState::dimensionAt(int index, int rowBound, int columnBound) {
+    if (rowBound < 0 || columnBound < 0) return STATUS_INVALID_DIMENSION;
+    Status status = allocate(index, (rowBound + 1LL) * (columnBound + 1LL));
+    if (status != STATUS_OK) return status;
+    arrays[index].rows = rowBound + 1;
+    arrays[index].columns = columnBound + 1;
+    return STATUS_OK;
+}
+
+Status EvalState::allocate(int index, long long size) {
+    long long total = elementCount - (long long) storage[index].size() + size;
+    if (total > MAX_ELEMENTS) return STATUS_INVALID_DIMENSION;
+    std::vector<int> elements;
+    try {
+        elements.assign(size, 0);
+    } catch (const std::bad_alloc &) {
+        return STATUS_INVALID_DIMENSION;
+    }
+    storage[index].swap(elements);
+    elementCount = total;
+    arrays[index] = Array();
+    arrays[index].elements = storage[index].data();
+    return STATUS_OK;
+}
+
+const Array &EvalState::getArray(int slot) const {
+    static const Array NONE;
+    int index = find(slot);
+    return (index >= 0) ? arrays[index] : NONE;
+}
+
+void EvalState::setElement(int slot, int index, int value) {
+    arrays[find(slot)].elements[index] = value;
 }
 
 void EvalState::Clear() {
-    symbolTable.clear();
-}
\ No newline at end of file
+    values.assign(values.size(), 0);
+    defined.assign(defined.size(), 0);
+    arrays.assign(arrays.size(), Array());
+    storage.assign(storage.size(), std::vector<int>());
+    elementCount = 0;
+}
@@ -9,8 +9,81 @@
 #ifndef _evalstate_h
 #define _evalstate_h
 
+#include <deque>
+#include <mutex>
 #include <string>
-#include <map>
+#include <vector>
+#include <unordered_map>
+#include "status.hpp"
+
+/*
+ * Class: SymbolTable
+ * ------------------
+ * This class interns variable names.  The parser converts every
+ * identifier it reads into an integer slot, and all later accesses
+ * to the variable use that slot instead of the name.  Slots are
+ * shared by every session, are assigned in the order in which names
+ * are first seen and remain valid for the life of the process.  The
+ * table may be used from several threads at once.
+ */
+
+class SymbolTable {
+
+public:
+
+/*
+ * Method: intern
+ * Usage: int slot = SymbolTable::intern(name);
+ * --------------------------------------------
+ * Returns the slot for name, allocating a new one if the name has
+ * not been seen before.
+ */
+
+    static int intern(const std::string &name);
+
+/*
+ * Method: getName
+ * Usage: string name = SymbolTable::getName(slot);
+ * ------------------------------------------------
+ * Returns the name that was interned into the specified slot.
+ */
+
+    static const std::string &getName(int slot);
+
+/*
+ * Method: size
+ * Usage: int n = SymbolTable::size();
+ * -----------------------------------
+ * Returns the number of slots allocated so far.
+ */
+
+    static int size();
+
+private:
+
+    std::unordered_map<std::string, int> slots;
+    std::deque<std::string> names;
+    std::mutex lock;
+
+    static SymbolTable &instance();
+
+};
+
+/*
+ * Type: Array
+ * -----------
+ * The shape and elements of an array created by DIM.  A list has
+ * length elements; a table has rows times columns elements, stored
+ * one row after another, and a length of 0.  An array that DIM has
+ * not created has neither elements nor rows.
+ */
+
+struct Array {
+    int *elements = nullptr;
+    int length = 0;
+    int rows = 0;
+    int columns = 0;
+};
 
 /*
  * Class: EvalState
@@ -18,10 +91,14 @@
  * This class is passed by reference through the recursive levels
  * of the evaluator and contains information from the evaluation
  * environment that the evaluator may need to know.  In this
- * version, the only information maintained by the EvalState class
- * is a symbol table that maps variable names into their values.
- * In your implementation, you may include additional information
- * in the EvalState class.
+ * version, the information maintained by the EvalState class is
+ * the values of the variables, held in a flat array together with a
+ * flag for each position recording whether the variable has been
+ * defined, and the arrays, described by a second flat array with the
+ * same positions.  An array and a variable may share a name.  Every
+ * method takes the SymbolTable slot of a name, but positions are
+ * handed out by each state to the names it has seen, so a session
+ * pays only for its own names however many the process has interned.
  */
 
 class EvalState {
@@ -46,38 +123,150 @@ public:
 
     ~EvalState();
 
+    EvalState(EvalState &&) = default;
+
+    EvalState &operator=(EvalState &&) = default;
+
 /*
  * Method: setValue
  * Usage: state.setValue(var, value);
- * ----------------------------------
- * Sets the value associated with the specified var.
+ *        state.setValue(slot, value);
+ * -----------------------------------
+ * Sets the value associated with the specified var, which may be
+ * given either by name or by its slot.
  */
 
-    void setValue(std::string var, int value);
+    void setValue(const std::string &var, int value);
+
+    void setValue(int slot, int value);
 
 /*
  * Method: getValue
  * Usage: int value = state.getValue(var);
- * ---------------------------------------
- * Returns the value associated with the specified variable.
+ *        int value = state.getValue(slot);
+ * ----------------------------------------
+ * Returns the value associated with the specified variable, or 0 if
+ * the variable is not defined.
  */
 
-    int getValue(std::string var);
+    int getValue(const std::string &var);
+
+    int getValue(int slot) const;
 
 /*
  * Method: isDefined
  * Usage: if (state.isDefined(var)) . . .
- * --------------------------------------
+ *        if (state.isDefined(slot)) . . .
+ * ---------------------------------------
  * Returns true if the specified variable is defined.
  */
 
-    bool isDefined(std::string var);
+    bool isDefined(const std::string &var);
+
+    bool isDefined(int slot) const;
+
+/*
+ * Method: bind
+ * Usage: state.bind(order);
+ * -------------------------
+ * Moves the variables and arrays whose slots are listed in order to
+ * the first positions, so that the virtual machine can address the
+ * one named by order[k] directly at position k.  Binding the same
+ * order again only compares it with the current one.
+ */
+
+    void bind(const std::vector<int> &order);
+
+/*
+ * Method: getSlots
+ * Usage: for (int slot : state.getSlots()) ...
+ * --------------------------------------------
+ * Returns the SymbolTable slots of every name that has a position in
+ * the state, which include those of all defined variables and arrays.
+ */
+
+    const std::vector<int> &getSlots() const { return slots; }
+
+/*
+ * Method: dimension
+ * Usage: Status status = state.dimension(slot, bound);
+ *        Status status = state.dimension(slot, rowBound, columnBound);
+ * --------------------------------------------------------------------
+ * Replaces the array in slot by a list of zeros with the subscripts 0
+ * through bound, or by a table of zeros whose rows and columns run
+ * from 0 through rowBound and columnBound.  If a bound is negative,
+ * if the arrays of the state would then have more than MAX_ELEMENTS
+ * elements between them or if the memory cannot be allocated, the old
+ * array is kept and STATUS_INVALID_DIMENSION is returned.  The limit
+ * keeps all the arrays of one session within 64 MiB.
+ */
+
+    Status dimension(int slot, int bound);
+    Status dimension(int slot, int rowBound, int columnBound);
+
+    static const int MAX_ELEMENTS = 1 << 24;
+
+/*
+ * Method: dimensionAt
+ * Usage: Status status = state.dimensionAt(index, bound);
+ *        Status status = state.dimensionAt(index, rowBound, columnBound);
+ * -----------------------------------------------------------------------
+ * Works like dimension, but names the array by its position, as code
+ * compiled for a bound state does.
+ */
+
+    Status dimensionAt(int index, int bound);
+    Status dimensionAt(int index, int rowBound, int columnBound);
+
+/*
+ * Method: getElementCount
+ * Usage: long long n = state.getElementCount();
+ * ---------------------------------------------
+ * Returns the number of elements in all the arrays of the state, which
+ * counts against MAX_ELEMENTS.
+ */
+
+    long long getElementCount() const { return elementCount; }
+
+/*
+ * Method: getArray
+ * Usage: const Array &array = state.getArray(slot);
+ * -------------------------------------------------
+ * Returns the array in slot.  The reference is invalidated when a
+ * new name is given a position or the state is bound.
+ */
+
+    const Array &getArray(int slot) const;
+
+/*
+ * Method: setElement
+ * Usage: state.setElement(slot, index, value);
+ * --------------------------------------------
+ * Sets the element of the array in slot that lies index elements from
+ * its start, which must be within the array.
+ */
+
+    void setElement(int slot, int index, int value);
 
     void Clear();
 
 private:
 
-    std::map<std::string, int> symbolTable;
+    std::vector<int> slots;                     /* Slot at each position */
+    std::unordered_map<int, int> positions;     /* Position of each slot */
+    std::vector<int> values;
+    std::vector<char> defined;
+    std::vector<Array> arrays;
+    std::vector<std::vector<int>> storage;
+    long long elementCount = 0;                 /* Elements in all arrays */
+
+    int find(int slot) const;
+    int position(int slot);
+    void exchange(int i, int j);
+    Status allocate(int index, long long size);
+
+    friend class VM;
+    friend class NativeCode;
 
 };
 
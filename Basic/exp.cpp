@@ -4,9 +4,55 @@
  * This file implements the Expression class and its subclasses.
  */
 
+#include <cctype>
 #include "exp.hpp"
 
 
+/*
+ * Implementation notes: toOperator, operatorName
+ * ----------------------------------------------
+ * These functions translate between operator tokens and the Operator
+ * constants.  They are used only while expressions are being built
+ * or printed, never during evaluation.
+ */
+
+Operator toOperator(std::string_view token) {
+    if (token == "=") return ASSIGN_OP;
+    if (token == "+") return ADD_OP;
+    if (token == "-") return SUB_OP;
+    if (token == "*") return MUL_OP;
+    if (token == "/") return DIV_OP;
+    return UNKNOWN_OP;
+}
+
+Operator toRelationalOperator(std::string_view token) {
+    if (token == "=") return EQ_OP;
+    if (token == "<>") return NE_OP;
+    if (token == "<") return LT_OP;
+    if (token == ">") return GT_OP;
+    if (token == "<=") return LE_OP;
+    if (token == ">=") return GE_OP;
+    return UNKNOWN_OP;
+}
+
+const char *operatorName(Operator op) {
+    switch (op) {
+        case ASSIGN_OP: return "=";
+        case ADD_OP: return "+";
+        case SUB_OP: return "-";
+        case MUL_OP: return "*";
+        case DIV_OP: return "/";
+        case EQ_OP: return "=";
+        case NE_OP: return "<>";
+        case LT_OP: return "<";
+        case GT_OP: return ">";
+        case LE_OP: return "<=";
+        case GE_OP: return ">=";
+        case UNKNOWN_OP: break;
+    }
+    return "?";
+}
+
 /*
  * Implementation notes: the Expression class
  * ------------------------------------------
@@ -29,8 +75,9 @@ ConstantExp::ConstantExp(int value) {
     this->value = value;
 }
 
-int ConstantExp::eval(EvalState &state) {
-    return value;
+Status ConstantExp::eval(EvalState &, int &value) {
+    value = this->value;
+    return STATUS_OK;
 }
 
 std::string ConstantExp::toString() {
@@ -48,22 +95,39 @@ int ConstantExp::getValue() {
 /*
  * Implementation notes: the IdentifierExp subclass
  * ------------------------------------------------
- * The IdentifierExp subclass declares a single instance variable that
- * stores the name of the variable.  The implementation of eval must
- * look this variable up in the evaluation state.
+ * The IdentifierExp subclass stores the slot of the variable and the
+ * keyword its name spells, which is looked up once here so that no
+ * later pass has to compare names.  Only a name in upper case spells
+ * a keyword, since a variable named let, unlike one named LET, has
+ * always been assignable in an expression.  The implementation of
+ * eval must look the slot up in the evaluation state.
  */
 
+static Keyword spelledKeyword(std::string_view name) {
+    for (char ch : name) {
+        if (islower((unsigned char) ch)) return KEYWORD_NONE;
+    }
+    return lookupKeyword(name);
+}
+
 IdentifierExp::IdentifierExp(std::string name) {
-    this->name = name;
+    this->slot = SymbolTable::intern(name);
+    this->keyword = spelledKeyword(name);
+}
+
+IdentifierExp::IdentifierExp(int slot) {
+    this->slot = slot;
+    this->keyword = spelledKeyword(SymbolTable::getName(slot));
 }
 
-int IdentifierExp::eval(EvalState &state) {
-    if (!state.isDefined(name)) error("VARIABLE NOT DEFINED");
-    return state.getValue(name);
+Status IdentifierExp::eval(EvalState &state, int &value) {
+    if (!state.isDefined(slot)) return STATUS_VARIABLE_NOT_DEFINED;
+    value = state.getValue(slot);
+    return STATUS_OK;
 }
 
 std::string IdentifierExp::toString() {
-    return name;
+    return SymbolTable::getName(slot);
 }
 
 ExpressionType IdentifierExp::getType() {
@@ -71,7 +135,15 @@ ExpressionType IdentifierExp::getType() {
 }
 
 std::string IdentifierExp::getName() {
-    return name;
+    return SymbolTable::getName(slot);
+}
+
+int IdentifierExp::getSlot() {
+    return slot;
+}
+
+Keyword IdentifierExp::getKeyword() {
+    return keyword;
 }
 
 /*
@@ -83,14 +155,15 @@ std::string IdentifierExp::getName() {
  */
 
 CompoundExp::CompoundExp(std::string op, Expression *lhs, Expression *rhs) {
-    this->op = op;
+    this->op = toOperator(op);
     this->lhs = lhs;
     this->rhs = rhs;
 }
 
-CompoundExp::~CompoundExp() {
-    delete lhs;
-    delete rhs;
+CompoundExp::CompoundExp(Operator op, Expression *lhs, Expression *rhs) {
+    this->op = op;
+    this->lhs = lhs;
+    this->rhs = rhs;
 }
 
 /*
@@ -98,34 +171,47 @@ CompoundExp::~CompoundExp() {
  * --------------------------
  * The eval method for the compound expression case must check for the
  * assignment operator as a special case.  Unlike the arithmetic operators
- * the assignment operator does not evaluate its left operand.
+ * the assignment operator does not evaluate its left operand, apart
+ * from the subscripts of an array element, which are evaluated and
+ * checked before the value.  Arithmetic wraps around as it does in
+ * the virtual machine.
  */
 
-int CompoundExp::eval(EvalState &state) {
-    if (op == "=") {
-        if (lhs->getType() != IDENTIFIER) {
-            error("Illegal variable in assignment");
+Status CompoundExp::eval(EvalState &state, int &value) {
+    if (op == ASSIGN_OP) {
+        if (lhs->getType() == ARRAY) {
+            ArrayExp *element = (ArrayExp *) lhs;
+            int index;
+            Status status = element->locate(state, index);
+            if (status == STATUS_OK) status = rhs->eval(state, value);
+            if (status == STATUS_OK) state.setElement(element->getSlot(), index, value);
+            return status;
         }
-        if (lhs->getType() == IDENTIFIER && lhs->toString() == "LET")
-            error("SYNTAX ERROR");
-        int val = rhs->eval(state);
-        state.setValue(((IdentifierExp *) lhs)->getName(), val);
-        return val;
+        if (lhs->getType() != IDENTIFIER) return STATUS_ILLEGAL_ASSIGNMENT;
+        if (((IdentifierExp *) lhs)->getKeyword() == KEYWORD_LET) return STATUS_SYNTAX_ERROR;
+        Status status = rhs->eval(state, value);
+        if (status == STATUS_OK) state.setValue(((IdentifierExp *) lhs)->getSlot(), value);
+        return status;
     }
-    int left = lhs->eval(state);
-    int right = rhs->eval(state);
-    if (op == "+") return left + right;
-    if (op == "-") return left - right;
-    if (op == "*") return left * right;
-    if (op == "/") {
-        if (right == 0) error("DIVIDE BY ZERO");
-        return left / right;
+    int left, right;
+    Status status = lhs->eval(state, left);
+    if (status == STATUS_OK) status = rhs->eval(state, right);
+    if (status != STATUS_OK) return status;
+    switch (op) {
+        case ADD_OP: value = (int) ((unsigned) left + (unsigned) right); break;
+        case SUB_OP: value = (int) ((unsigned) left - (unsigned) right); break;
+        case MUL_OP: value = (int) ((unsigned) left * (unsigned) right); break;
+        case DIV_OP:
+            if (right == 0) return STATUS_DIVIDE_BY_ZERO;
+            value = (right == -1) ? (int) (0u - (unsigned) left) : left / right;
+            break;
+        default: value = 0; break;
     }
-    return 0;
+    return STATUS_OK;
 }
 
 std::string CompoundExp::toString() {
-    return '(' + lhs->toString() + ' ' + op + ' ' + rhs->toString() + ')';
+    return '(' + lhs->toString() + ' ' + operatorName(op) + ' ' + rhs->toString() + ')';
 }
 
 ExpressionType CompoundExp::getType() {
@@ -133,6 +219,10 @@ ExpressionType CompoundExp::getType() {
 }
 
 std::string CompoundExp::getOp() {
+    return operatorName(op);
+}
+
+Operator CompoundExp::getOperator() {
     return op;
 }
 
@@ -143,3 +233,70 @@ Expression *CompoundExp::getLHS() {
 Expression *CompoundExp::getRHS() {
     return rhs;
 }
+
+/*
+ * Implementation notes: the ArrayExp subclass
+ * -------------------------------------------
+ * The ArrayExp subclass declares instance variables for the slot of
+ * the array and its subscripts.  The subscripts are evaluated from
+ * left to right before the array is looked up, since evaluating them
+ * may reserve new slots in the state.  Comparing the subscripts as
+ * unsigned values rejects the negative ones in the same test.
+ */
+
+ArrayExp::ArrayExp(int slot, Expression *row, Expression *column) {
+    this->slot = slot;
+    subscripts[0] = row;
+    subscripts[1] = column;
+}
+
+Status ArrayExp::eval(EvalState &state, int &value) {
+    int index;
+    Status status = locate(state, index);
+    if (status == STATUS_OK) value = state.getArray(slot).elements[index];
+    return status;
+}
+
+Status ArrayExp::locate(EvalState &state, int &index) {
+    int row, column = 0;
+    Status status = subscripts[0]->eval(state, row);
+    if (status == STATUS_OK && subscripts[1] != nullptr) status = subscripts[1]->eval(state, column);
+    if (status != STATUS_OK) return status;
+    const Array &array = state.getArray(slot);
+    if (subscripts[1] == nullptr) {
+        if ((unsigned) row >= (unsigned) array.length) return STATUS_SUBSCRIPT_OUT_OF_RANGE;
+        index = row;
+    } else {
+        if ((unsigned) row >= (unsigned) array.rows || (unsigned) column >= (unsigned) array.columns) {
+            return STATUS_SUBSCRIPT_OUT_OF_RANGE;
+        }
+        index = row * array.columns + column;
+    }
+    return STATUS_OK;
+}
+
+std::string ArrayExp::toString() {
+    std::string str = SymbolTable::getName(slot) + '(' + subscripts[0]->toString();
+    if (subscripts[1] != nullptr) str += ", " + subscripts[1]->toString();
+    return str + ')';
+}
+
+ExpressionType ArrayExp::getType() {
+    return ARRAY;
+}
+
+std::string ArrayExp::getName() {
+    return SymbolTable::getName(slot);
+}
+
+int ArrayExp::getSlot() {
+    return slot;
+}
+
+int ArrayExp::getRank() {
+    return (subscripts[1] == nullptr) ? 1 : 2;
+}
+
+Expression *ArrayExp::getSubscript(int k) {
+    return subscripts[k];
+}
@@ -10,33 +10,76 @@
 #define _exp_h
 
 #include <string>
+#include <string_view>
 #include "Utils/error.hpp"
 #include "evalstate.hpp"
+#include "keyword.hpp"
+#include "status.hpp"
 #include "Utils/strlib.hpp"
 
 /*
  * Type: ExpressionType
  * --------------------
- * This enumerated type is used to differentiate the three different
- * expression types: CONSTANT, IDENTIFIER, and COMPOUND.
+ * This enumerated type is used to differentiate the four different
+ * expression types: CONSTANT, IDENTIFIER, COMPOUND, and ARRAY.
  */
 
 enum ExpressionType {
-    CONSTANT, IDENTIFIER, COMPOUND
+    CONSTANT, IDENTIFIER, COMPOUND, ARRAY
 };
 
+/*
+ * Type: Operator
+ * --------------
+ * This enumerated type identifies the binary operators.  Operators are
+ * converted from their token once, when the expression or statement is
+ * built, so that evaluation can dispatch on the constant.  The first
+ * group appears in CompoundExp, the relational group in IF statements.
+ */
+
+enum Operator {
+    ASSIGN_OP, ADD_OP, SUB_OP, MUL_OP, DIV_OP,
+    EQ_OP, NE_OP, LT_OP, GT_OP, LE_OP, GE_OP,
+    UNKNOWN_OP
+};
+
+/*
+ * Functions: toOperator, toRelationalOperator
+ * Usage: Operator op = toOperator(token);
+ *        Operator op = toRelationalOperator(token);
+ * -------------------------------------------------
+ * Return the expression operator or the relational operator denoted
+ * by token, or UNKNOWN_OP if the token is not such an operator.  The
+ * two are separate because "=" means assignment in an expression but
+ * equality in an IF statement.
+ */
+
+Operator toOperator(std::string_view token);
+
+Operator toRelationalOperator(std::string_view token);
+
+/*
+ * Function: operatorName
+ * Usage: string str = operatorName(op);
+ * -------------------------------------
+ * Returns the token that denotes the operator.
+ */
+
+const char *operatorName(Operator op);
+
 /*
  * Class: Expression
  * -----------------
  * This class is used to represent a node in an expression tree.
  * Expression is an example of an abstract class, which defines
  * the structure and behavior of a set of classes but has no
- * objects of its own.  Any object must be one of the three
+ * objects of its own.  Any object must be one of the four
  * concrete subclasses of Expression:
  *
  *  1. ConstantExp   -- an integer constant
  *  2. IdentifierExp -- a string representing an identifier
  *  3. CompoundExp   -- two expressions combined by an operator
+ *  4. ArrayExp      -- an element of an array created by DIM
  *
  * The Expression class defines the interface common to all
  * Expression objects; each subclass provides its own specific
@@ -63,24 +106,25 @@ public:
 
 /*
  * Destructor: ~Expression
- * Usage: delete exp;
- * ------------------
- * The destructor deallocates the storage for this expression.
- * It must be declared virtual to ensure that the correct subclass
- * destructor is called when deleting an expression.
+ * -----------------------
+ * Expressions are allocated in the Arena of the line that contains
+ * them and are released together with it, so expressions are never
+ * deleted and must not own heap storage.  Subexpressions are placed
+ * in the same arena as their parent.
  */
 
     virtual ~Expression();
 
 /*
  * Method: eval
- * Usage: int value = exp->eval(state);
- * ------------------------------------
- * Evaluates this expression and returns its value in the context of
- * the specified EvalState object.
+ * Usage: Status status = exp->eval(state, value);
+ * -----------------------------------------------
+ * Evaluates this expression in the context of the specified EvalState
+ * object and stores its value in value.  The result is STATUS_OK, or
+ * the runtime error that stopped the evaluation.
  */
 
-    virtual int eval(EvalState &state) = 0;
+    virtual Status eval(EvalState &state, int &value) = 0;
 
 /*
  * Method: toString
@@ -96,7 +140,7 @@ public:
  * Usage: ExpressionType type = exp->getType();
  * --------------------------------------------
  * Returns the type of the expression, which must be one of the constants
- * CONSTANT, IDENTIFIER, or COMPOUND.
+ * CONSTANT, IDENTIFIER, COMPOUND, or ARRAY.
  */
 
     virtual ExpressionType getType() = 0;
@@ -115,7 +159,7 @@ public:
 
 /*
  * Constructor: ConstantExp
- * Usage: Expression *exp = new ConstantExp(value);
+ * Usage: Expression *exp = arena.make<ConstantExp>(value);
  * ------------------------------------------------
  * The constructor initializes a new integer constant expression
  * to the given value.
@@ -130,7 +174,7 @@ public:
  * base class and don't require additional documentation.
  */
 
-    virtual int eval(EvalState &state);
+    virtual Status eval(EvalState &state, int &value);
 
     virtual std::string toString();
 
@@ -164,14 +208,25 @@ public:
 
 /*
  * Constructor: IdentifierExp
- * Usage: Expression *exp = new IdentifierExp(name);
+ * Usage: Expression *exp = arena.make<IdentifierExp>(name);
  * -------------------------------------------------
  * The constructor initializes a new identifier expression
- * for the variable named by name.
+ * for the variable named by name, which is interned into its
+ * SymbolTable slot.
  */
 
     IdentifierExp(std::string name);
 
+/*
+ * Constructor: IdentifierExp
+ * Usage: Expression *exp = arena.make<IdentifierExp>(slot);
+ * ---------------------------------------------------------
+ * Initializes an identifier expression for the variable that has
+ * already been interned into the given SymbolTable slot.
+ */
+
+    explicit IdentifierExp(int slot);
+
 /*
  * Prototypes for the virtual methods
  * ----------------------------------
@@ -179,7 +234,7 @@ public:
  * base class and don't require additional documentation.
  */
 
-    virtual int eval(EvalState &state);
+    virtual Status eval(EvalState &state, int &value);
 
     virtual std::string toString();
 
@@ -195,9 +250,31 @@ public:
 
     std::string getName();
 
+/*
+ * Method: getSlot
+ * Usage: int slot = ((IdentifierExp *) exp)->getSlot();
+ * -----------------------------------------------------
+ * Returns the SymbolTable slot of the variable and can be applied only
+ * to an object known to be an IdentifierExp.
+ */
+
+    int getSlot();
+
+/*
+ * Method: getKeyword
+ * Usage: Keyword keyword = ((IdentifierExp *) exp)->getKeyword();
+ * ---------------------------------------------------------------
+ * Returns the keyword that the name of the variable spells in upper
+ * case, or KEYWORD_NONE, as determined when the node was built.  It can be
+ * applied only to an object known to be an IdentifierExp.
+ */
+
+    Keyword getKeyword();
+
 private:
 
-    std::string name;
+    int slot;
+    Keyword keyword;
 
 };
 
@@ -214,15 +291,18 @@ public:
 
 /*
  * Constructor: CompoundExp
- * Usage: Expression *exp = new CompoundExp(op, lhs, rhs);
+ * Usage: Expression *exp = arena.make<CompoundExp>(op, lhs, rhs);
  * -------------------------------------------------------
  * The constructor initializes a new compound expression
- * which is composed of the operator (op) and the left and
- * right subexpression (lhs and rhs).
+ * which is composed of the operator (op), given either as its
+ * token or as an Operator, and the left and right subexpression
+ * (lhs and rhs).
  */
 
     CompoundExp(std::string op, Expression *lhs, Expression *rhs);
 
+    CompoundExp(Operator op, Expression *lhs, Expression *rhs);
+
 /*
  * Prototypes for the virtual methods
  * ----------------------------------
@@ -230,17 +310,16 @@ public:
  * base class and don't require additional documentation.
  */
 
-    virtual ~CompoundExp();
-
-    virtual int eval(EvalState &state);
+    virtual Status eval(EvalState &state, int &value);
 
     virtual std::string toString();
 
     virtual ExpressionType getType();
 
 /*
- * Methods: getOp, getLHS, getRHS
+ * Methods: getOp, getOperator, getLHS, getRHS
  * Usage: string op = ((CompoundExp *) exp)->getOp();
+ *        Operator op = ((CompoundExp *) exp)->getOperator();
  *        Expression *lhs = ((CompoundExp *) exp)->getLHS();
  *        Expression *rhs = ((CompoundExp *) exp)->getRHS();
  * ---------------------------------------------------------
@@ -250,15 +329,95 @@ public:
 
     std::string getOp();
 
+    Operator getOperator();
+
     Expression *getLHS();
 
     Expression *getRHS();
 
 private:
 
-    std::string op;
+    Operator op;
     Expression *lhs, *rhs;
 
 };
 
+/*
+ * Class: ArrayExp
+ * ---------------
+ * This subclass represents an element of an array, selected by one
+ * subscript in a list or by a row and a column subscript in a table.
+ * The same node stands for the element when it is the target of an
+ * assignment.
+ */
+
+class ArrayExp : public Expression {
+
+public:
+
+/*
+ * Constructor: ArrayExp
+ * Usage: ArrayExp *exp = arena.make<ArrayExp>(slot, row);
+ *        ArrayExp *exp = arena.make<ArrayExp>(slot, row, column);
+ * ---------------------------------------------------------------
+ * Initializes an element of the array whose name has been interned
+ * into the given SymbolTable slot.  The column subscript is nullptr
+ * for an element of a list.
+ */
+
+    ArrayExp(int slot, Expression *row, Expression *column = nullptr);
+
+/*
+ * Prototypes for the virtual methods
+ * ----------------------------------
+ * These methods have the same prototypes as those in the Expression
+ * base class and don't require additional documentation.
+ */
+
+    virtual Status eval(EvalState &state, int &value);
+
+    virtual std::string toString();
+
+    virtual ExpressionType getType();
+
+/*
+ * Method: locate
+ * Usage: Status status = element->locate(state, index);
+ * -----------------------------------------------------
+ * Evaluates the subscripts and stores in index the position of the
+ * element from the start of the array, counting row after row.  The
+ * result is STATUS_SUBSCRIPT_OUT_OF_RANGE if a subscript lies outside
+ * the array, if DIM has not created the array or if it was created
+ * with the other number of subscripts.
+ */
+
+    Status locate(EvalState &state, int &index);
+
+/*
+ * Methods: getName, getSlot, getRank, getSubscript
+ * Usage: string name = element->getName();
+ *        int slot = element->getSlot();
+ *        int rank = element->getRank();
+ *        Expression *subscript = element->getSubscript(k);
+ * --------------------------------------------------------
+ * These methods return the array and the subscripts of the element:
+ * its rank is the number of subscripts, 1 or 2, and subscript k is
+ * the row for k = 0 and the column for k = 1.
+ */
+
+    std::string getName();
+
+    int getSlot();
+
+    int getRank();
+
+    Expression *getSubscript(int k);
+
+private:
+
+    int slot;
+    Expression *subscripts[2];
+
+};
+
 #endif
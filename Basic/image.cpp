@@ -0,0 +1,640 @@
+/*
+ * File: image.cpp
+ * ---------------
+ * This file implements the binary program images written by SAVE and
+ * read by LOAD.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "image.hpp"
+#include "keyword.hpp"
+#include "statement.hpp"
+#include "Utils/error.hpp"
+
+/*
+ * Implementation notes: image layout
+ * ----------------------------------
+ * An image is a header followed by seven tables:
+ *
+ *   lines      One LineRecord per program line, in line-number order
+ *   nodes      The parsed statements, as NodeRecords in postorder
+ *   symbols    The names of the variables and arrays the image uses
+ *   variables  The defined variables and their values
+ *   arrays     The shapes of the arrays created by DIM
+ *   elements   The elements of those arrays, one array after another
+ *   strings    The source lines, REM texts and names, back to back
+ *
+ * Every field is a 32-bit integer in the byte order of the machine
+ * that wrote the image, and all references are table indices or
+ * offsets into the strings, so the file is mapped into memory and read
+ * in place.  The nodes of a line refer to each other by their position
+ * among that line's nodes, so shared subexpressions stay shared; its
+ * statement is always the last of them.  Variables and arrays are
+ * named by symbol numbers, which are translated into SymbolTable
+ * slots once per name when the image is loaded; that is the only
+ * fixup.
+ */
+
+static const char MAGIC[8] = {'B', 'A', 'S', 'I', 'C', 'I', 'M', '2'};
+
+struct ImageHeader {
+    char magic[8];
+    uint32_t lineCount, nodeCount, symbolCount, variableCount, arrayCount, elementCount, stringSize;
+    uint32_t linesOffset, nodesOffset, symbolsOffset, variablesOffset, arraysOffset, elementsOffset;
+    uint32_t stringsOffset;
+};
+
+struct LineRecord {
+    int32_t lineNumber;
+    uint32_t sourceOffset, sourceLength;
+    uint32_t firstNode, nodeCount;          /* No statement if nodeCount is 0 */
+};
+
+enum NodeKind : uint8_t {
+    NODE_CONSTANT,      /* a = value                                  */
+    NODE_IDENTIFIER,    /* a = symbol                                 */
+    NODE_COMPOUND,      /* op, a = lhs node, b = rhs node             */
+    NODE_REM,           /* a = comment offset, b = comment length     */
+    NODE_LET,           /* a = symbol, b = expression node            */
+    NODE_PRINT,         /* b = expression node                        */
+    NODE_INPUT,         /* a = symbol                                 */
+    NODE_END,
+    NODE_GOTO,          /* a = target line                            */
+    NODE_IF,            /* op, a = lhs node, b = rhs node, c = target */
+    NODE_ARRAY,         /* a = symbol, b = row node, c = column node  */
+    NODE_DIM,           /* a = symbol, b = row node, c = column node  */
+    NODE_LET_ELEMENT,   /* a = array node, b = expression node        */
+    NODE_INPUT_ELEMENT  /* a = array node                             */
+};
+
+struct NodeRecord {
+    uint8_t kind;
+    uint8_t op;
+    uint16_t unused;
+    int32_t a, b, c;
+};
+
+struct SymbolRecord {
+    uint32_t offset, length;
+};
+
+struct VariableRecord {
+    int32_t symbol, value;
+};
+
+struct ArrayRecord {
+    int32_t symbol, length, rows, columns;  /* As in Array; no column node is -1 */
+    uint32_t firstElement;
+};
+
+/*
+ * Class: ImageWriter
+ * ------------------
+ * Collects the tables of an image in memory before they are written.
+ */
+
+class ImageWriter {
+
+public:
+
+    void addLine(int lineNumber, std::string_view source, Statement *stmt);
+    void addVariable(int slot, int value);
+    void addArray(int slot, const Array &array);
+    void write(const std::string &filename);
+
+private:
+
+    std::vector<LineRecord> lines;
+    std::vector<NodeRecord> nodes;
+    std::vector<SymbolRecord> symbols;
+    std::vector<VariableRecord> variables;
+    std::vector<ArrayRecord> arrays;
+    std::vector<int32_t> elements;
+    std::string strings;
+    std::unordered_map<int, int> symbolOf;          /* Slot to symbol number  */
+    std::unordered_map<Expression *, int> encoded;  /* Nodes of current line  */
+    size_t lineStart = 0;
+
+    int addNode(NodeKind kind, int op = 0, int a = 0, int b = 0, int c = 0);
+    int encodeExp(Expression *exp);
+    int encodeOptional(Expression *exp);
+    uint32_t addString(std::string_view str);
+    int symbol(int slot);
+
+    template <typename T>
+    static void writeTable(FILE *out, const std::vector<T> &table) {
+        if (!table.empty()) std::fwrite(table.data(), sizeof(T), table.size(), out);
+    }
+
+};
+
+void ImageWriter::addLine(int lineNumber, std::string_view source, Statement *stmt) {
+    LineRecord line = {lineNumber, addString(source), (uint32_t) source.size(), (uint32_t) nodes.size(), 0};
+    lineStart = nodes.size();
+    encoded.clear();
+    if (stmt != nullptr) {
+        switch (stmt->getType()) {
+            case REM_STMT: {
+                std::string_view comment = ((RemStatement *) stmt)->getComment();
+                addNode(NODE_REM, 0, (int) addString(comment), (int) comment.size());
+                break;
+            }
+            case LET_STMT: {
+                auto *let = (LetStatement *) stmt;
+                if (let->getElement() != nullptr) {
+                    int element = encodeExp(let->getElement());
+                    addNode(NODE_LET_ELEMENT, 0, element, encodeExp(let->getExp()));
+                    break;
+                }
+                int exp = encodeExp(let->getExp());
+                addNode(NODE_LET, 0, symbol(let->getSlot()), exp);
+                break;
+            }
+            case PRINT_STMT:
+                addNode(NODE_PRINT, 0, 0, encodeExp(((PrintStatement *) stmt)->getExp()));
+                break;
+            case INPUT_STMT: {
+                auto *input = (InputStatement *) stmt;
+                if (input->getElement() != nullptr) {
+                    addNode(NODE_INPUT_ELEMENT, 0, encodeExp(input->getElement()));
+                } else {
+                    addNode(NODE_INPUT, 0, symbol(input->getSlot()));
+                }
+                break;
+            }
+            case END_STMT:
+                addNode(NODE_END);
+                break;
+            case GOTO_STMT:
+                addNode(NODE_GOTO, 0, ((GotoStatement *) stmt)->getTarget());
+                break;
+            case IF_STMT: {
+                auto *ifStmt = (IfStatement *) stmt;
+                int lhs = encodeExp(ifStmt->getLHS());
+                int rhs = encodeExp(ifStmt->getRHS());
+                addNode(NODE_IF, ifStmt->getOperator(), lhs, rhs, ifStmt->getTarget());
+                break;
+            }
+            case DIM_STMT: {
+                auto *dim = (DimStatement *) stmt;
+                int rowBound = encodeExp(dim->getBound(0));
+                int columnBound = encodeOptional(dim->getBound(1));
+                addNode(NODE_DIM, 0, symbol(dim->getSlot()), rowBound, columnBound);
+                break;
+            }
+        }
+        line.nodeCount = (uint32_t) (nodes.size() - lineStart);
+    }
+    lines.push_back(line);
+}
+
+void ImageWriter::addVariable(int slot, int value) {
+    variables.push_back({symbol(slot), value});
+}
+
+void ImageWriter::addArray(int slot, const Array &array) {
+    int count = (array.length > 0) ? array.length : array.rows * array.columns;
+    arrays.push_back({symbol(slot), array.length, array.rows, array.columns, (uint32_t) elements.size()});
+    elements.insert(elements.end(), array.elements, array.elements + count);
+}
+
+int ImageWriter::addNode(NodeKind kind, int op, int a, int b, int c) {
+    nodes.push_back({kind, (uint8_t) op, 0, a, b, c});
+    return (int) (nodes.size() - 1 - lineStart);
+}
+
+int ImageWriter::encodeExp(Expression *exp) {
+    auto it = encoded.find(exp);
+    if (it != encoded.end()) return it->second;
+    int index;
+    switch (exp->getType()) {
+        case CONSTANT:
+            index = addNode(NODE_CONSTANT, 0, ((ConstantExp *) exp)->getValue());
+            break;
+        case IDENTIFIER:
+            index = addNode(NODE_IDENTIFIER, 0, symbol(((IdentifierExp *) exp)->getSlot()));
+            break;
+        case ARRAY: {
+            auto *element = (ArrayExp *) exp;
+            int row = encodeExp(element->getSubscript(0));
+            int column = encodeOptional(element->getSubscript(1));
+            index = addNode(NODE_ARRAY, 0, symbol(element->getSlot()), row, column);
+            break;
+        }
+        default: {
+            auto *compound = (CompoundExp *) exp;
+            int lhs = encodeExp(compound->getLHS());
+            int rhs = encodeExp(compound->getRHS());
+            index = addNode(NODE_COMPOUND, compound->getOperator(), lhs, rhs);
+            break;
+        }
+    }
+    encoded[exp] = index;
+    return index;
+}
+
+int ImageWriter::encodeOptional(Expression *exp) {
+    return (exp == nullptr) ? -1 : encodeExp(exp);
+}
+
+uint32_t ImageWriter::addString(std::string_view str) {
+    uint32_t offset = (uint32_t) strings.size();
+    strings.append(str);
+    return offset;
+}
+
+int ImageWriter::symbol(int slot) {
+    auto it = symbolOf.find(slot);
+    if (it != symbolOf.end()) return it->second;
+    const std::string &name = SymbolTable::getName(slot);
+    symbols.push_back({addString(name), (uint32_t) name.size()});
+    return symbolOf[slot] = (int) symbols.size() - 1;
+}
+
+void ImageWriter::write(const std::string &filename) {
+    ImageHeader header;
+    memcpy(header.magic, MAGIC, sizeof MAGIC);
+    header.lineCount = (uint32_t) lines.size();
+    header.nodeCount = (uint32_t) nodes.size();
+    header.symbolCount = (uint32_t) symbols.size();
+    header.variableCount = (uint32_t) variables.size();
+    header.arrayCount = (uint32_t) arrays.size();
+    header.elementCount = (uint32_t) elements.size();
+    header.stringSize = (uint32_t) strings.size();
+    header.linesOffset = sizeof header;
+    header.nodesOffset = header.linesOffset + header.lineCount * sizeof(LineRecord);
+    header.symbolsOffset = header.nodesOffset + header.nodeCount * sizeof(NodeRecord);
+    header.variablesOffset = header.symbolsOffset + header.symbolCount * sizeof(SymbolRecord);
+    header.arraysOffset = header.variablesOffset + header.variableCount * sizeof(VariableRecord);
+    header.elementsOffset = header.arraysOffset + header.arrayCount * sizeof(ArrayRecord);
+    header.stringsOffset = header.elementsOffset + header.elementCount * sizeof(int32_t);
+    uint64_t size = sizeof header + lines.size() * sizeof(LineRecord) + nodes.size() * sizeof(NodeRecord)
+                    + symbols.size() * sizeof(SymbolRecord) + variables.size() * sizeof(VariableRecord)
+                    + arrays.size() * sizeof(ArrayRecord) + elements.size() * sizeof(int32_t)
+                    + strings.size();
+    if (size > UINT32_MAX) error("PROGRAM TOO LARGE FOR " + filename);
+    FILE *out = std::fopen(filename.c_str(), "wb");
+    if (out == nullptr) error("CANNOT WRITE " + filename);
+    std::fwrite(&header, sizeof header, 1, out);
+    writeTable(out, lines);
+    writeTable(out, nodes);
+    writeTable(out, symbols);
+    writeTable(out, variables);
+    writeTable(out, arrays);
+    writeTable(out, elements);
+    std::fwrite(strings.data(), 1, strings.size(), out);
+    bool failed = std::ferror(out) != 0;
+    if (std::fclose(out) != 0 || failed) error("CANNOT WRITE " + filename);
+}
+
+void saveImage(Program &program, EvalState &state, const std::string &filename) {
+    ImageWriter writer;
+    int nLines = program.getLineCount();
+    for (int i = 0; i < nLines; i++) {
+        writer.addLine(program.getLineNumberAt(i), program.getSourceLineAt(i), program.getStatementAt(i));
+    }
+    for (int slot : state.getSlots()) {
+        if (state.isDefined(slot)) writer.addVariable(slot, state.getValue(slot));
+        if (state.getArray(slot).elements != nullptr) writer.addArray(slot, state.getArray(slot));
+    }
+    writer.write(filename);
+}
+
+/*
+ * Class: MappedFile
+ * -----------------
+ * A file mapped read-only into memory for as long as the object lives.
+ */
+
+class MappedFile {
+
+public:
+
+    explicit MappedFile(const std::string &filename);
+
+    ~MappedFile() {
+        if (data != nullptr) munmap((void *) data, size);
+    }
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const char *data = nullptr;
+    size_t size = 0;
+
+};
+
+MappedFile::MappedFile(const std::string &filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) error("CANNOT READ " + filename);
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void *address = mmap(nullptr, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address != MAP_FAILED) {
+            data = (const char *) address;
+            size = (size_t) info.st_size;
+        }
+    }
+    close(fd);
+    if (data == nullptr) error("CANNOT READ " + filename);
+}
+
+/*
+ * Class: ImageReader
+ * ------------------
+ * Checks a mapped image and rebuilds the program it holds.
+ */
+
+class ImageReader {
+
+public:
+
+    ImageReader(const MappedFile &file, const std::string &filename);
+
+    void load(Program &program, EvalState &state);
+
+private:
+
+    const MappedFile &file;
+    std::string filename;
+    ImageHeader header;
+    const LineRecord *lines;
+    const NodeRecord *nodes;
+    const SymbolRecord *symbols;
+    const VariableRecord *variables;
+    const ArrayRecord *arrays;
+    const int32_t *elements;
+    const char *strings;
+    long long elementTotal = 0;
+
+    template <typename T>
+    const T *table(uint32_t offset, uint32_t count);
+    void check(bool condition);
+    void checkString(uint32_t offset, uint32_t length);
+    void checkLine(const LineRecord &line);
+    void checkArray(const ArrayRecord &array);
+    static bool isExpression(uint8_t kind);
+    bool isReservedSymbol(uint32_t symbol) const;
+    Statement *decode(const LineRecord &line, const std::vector<int> &slots, Arena &arena,
+                      std::vector<Expression *> &built);
+
+};
+
+/*
+ * Implementation notes: ImageReader
+ * ---------------------------------
+ * The whole image is checked before anything is changed, so that a
+ * damaged or foreign file cannot leave a half-loaded program or
+ * produce statements that refer outside the image.
+ */
+
+ImageReader::ImageReader(const MappedFile &file, const std::string &filename)
+    : file(file), filename(filename) {
+    check(file.size >= sizeof header);
+    memcpy(&header, file.data, sizeof header);
+    check(memcmp(header.magic, MAGIC, sizeof MAGIC) == 0);
+    lines = table<LineRecord>(header.linesOffset, header.lineCount);
+    nodes = table<NodeRecord>(header.nodesOffset, header.nodeCount);
+    symbols = table<SymbolRecord>(header.symbolsOffset, header.symbolCount);
+    variables = table<VariableRecord>(header.variablesOffset, header.variableCount);
+    arrays = table<ArrayRecord>(header.arraysOffset, header.arrayCount);
+    elements = table<int32_t>(header.elementsOffset, header.elementCount);
+    strings = table<char>(header.stringsOffset, header.stringSize);
+    for (uint32_t i = 0; i < header.lineCount; i++) {
+        check(i == 0 || lines[i].lineNumber > lines[i - 1].lineNumber);
+        checkLine(lines[i]);
+    }
+    for (uint32_t i = 0; i < header.symbolCount; i++) {
+        checkString(symbols[i].offset, symbols[i].length);
+        check(symbols[i].length > 0);
+    }
+    for (uint32_t i = 0; i < header.variableCount; i++) {
+        check((uint32_t) variables[i].symbol < header.symbolCount);
+    }
+    for (uint32_t i = 0; i < header.arrayCount; i++) {
+        checkArray(arrays[i]);
+    }
+}
+
+template <typename T>
+const T *ImageReader::table(uint32_t offset, uint32_t count) {
+    check(offset % alignof(T) == 0 && offset <= file.size && count <= (file.size - offset) / sizeof(T));
+    return (const T *) (file.data + offset);
+}
+
+void ImageReader::check(bool condition) {
+    if (!condition) error("INVALID IMAGE " + filename);
+}
+
+void ImageReader::checkString(uint32_t offset, uint32_t length) {
+    check(offset <= header.stringSize && length <= header.stringSize - offset);
+}
+
+/*
+ * Implementation notes: checkLine
+ * -------------------------------
+ * Every node may only refer to nodes before it in the same line, which
+ * guarantees that decoding finds its operands already built, and only
+ * the last node of a line may be a statement.
+ */
+
+void ImageReader::checkLine(const LineRecord &line) {
+    checkString(line.sourceOffset, line.sourceLength);
+    check(line.firstNode <= header.nodeCount && line.nodeCount <= header.nodeCount - line.firstNode);
+    for (uint32_t i = 0; i < line.nodeCount; i++) {
+        const NodeRecord &node = nodes[line.firstNode + i];
+        bool last = i + 1 == line.nodeCount;
+        auto isOperand = [&](int32_t index) {
+            return index >= 0 && (uint32_t) index < i && isExpression(nodes[line.firstNode + index].kind);
+        };
+        auto isElement = [&](int32_t index) {
+            return isOperand(index) && nodes[line.firstNode + index].kind == NODE_ARRAY;
+        };
+        bool isSymbol = (uint32_t) node.a < header.symbolCount;
+        switch (node.kind) {
+            case NODE_CONSTANT:
+                check(!last);
+                break;
+            case NODE_IDENTIFIER:
+                check(!last && (uint32_t) node.a < header.symbolCount);
+                break;
+            case NODE_COMPOUND:
+                check(!last && node.op < UNKNOWN_OP && isOperand(node.a) && isOperand(node.b));
+                break;
+            case NODE_REM:
+                check(last);
+                checkString((uint32_t) node.a, (uint32_t) node.b);
+                break;
+            case NODE_LET:
+                check(last && (uint32_t) node.a < header.symbolCount && isOperand(node.b));
+                break;
+            case NODE_PRINT:
+                check(last && isOperand(node.b));
+                break;
+            case NODE_INPUT:
+                check(last && (uint32_t) node.a < header.symbolCount);
+                break;
+            case NODE_END:
+            case NODE_GOTO:
+                check(last);
+                break;
+            case NODE_IF:
+                check(last && node.op <= UNKNOWN_OP && isOperand(node.a) && isOperand(node.b));
+                break;
+            case NODE_ARRAY:
+            case NODE_DIM:
+                check(last == (node.kind == NODE_DIM) && isSymbol && isOperand(node.b));
+                check(node.c == -1 || isOperand(node.c));
+                break;
+            case NODE_LET_ELEMENT:
+                check(last && isElement(node.a) && isOperand(node.b));
+                break;
+            case NODE_INPUT_ELEMENT:
+                check(last && isElement(node.a));
+                break;
+            default:
+                check(false);
+        }
+    }
+}
+
+/*
+ * Implementation notes: checkArray
+ * --------------------------------
+ * An array must have a shape that DIM could have produced, and all the
+ * arrays together must fit in an EvalState, so that loading them can
+ * fail only for want of memory.  Its elements must lie in the table.
+ */
+
+void ImageReader::checkArray(const ArrayRecord &array) {
+    check((uint32_t) array.symbol < header.symbolCount);
+    bool list = array.length > 0 && array.rows == 0 && array.columns == 0;
+    bool table = array.length == 0 && array.rows > 0 && array.columns > 0;
+    check(list || table);
+    long long count = list ? array.length : (long long) array.rows * array.columns;
+    elementTotal += count;
+    check(elementTotal <= EvalState::MAX_ELEMENTS);
+    check(array.firstElement <= header.elementCount && count <= header.elementCount - array.firstElement);
+}
+
+bool ImageReader::isExpression(uint8_t kind) {
+    return kind == NODE_CONSTANT || kind == NODE_IDENTIFIER || kind == NODE_COMPOUND || kind == NODE_ARRAY;
+}
+
+bool ImageReader::isReservedSymbol(uint32_t symbol) const {
+    std::string_view name(strings + symbols[symbol].offset, symbols[symbol].length);
+    return isReservedKeyword(lookupKeyword(name));
+}
+
+/*
+ * Implementation notes: load
+ * --------------------------
+ * Each name is interned once.  The variables and arrays are loaded
+ * into a new EvalState first, so that running out of memory for the
+ * arrays leaves the session as it was.  Then every line is rebuilt in
+ * an arena of its own and appended to the program, which takes
+ * constant time per line since the lines arrive in order.
+ */
+
+void ImageReader::load(Program &program, EvalState &state) {
+    std::vector<int> slots(header.symbolCount);
+    for (uint32_t i = 0; i < header.symbolCount; i++) {
+        slots[i] = SymbolTable::intern(std::string(strings + symbols[i].offset, symbols[i].length));
+    }
+    EvalState loaded;
+    for (uint32_t i = 0; i < header.variableCount; i++) {
+        loaded.setValue(slots[variables[i].symbol], variables[i].value);
+    }
+    for (uint32_t i = 0; i < header.arrayCount; i++) {
+        const ArrayRecord &array = arrays[i];
+        int slot = slots[array.symbol];
+        int count = array.length;
+        Status status;
+        if (array.length > 0) {
+            status = loaded.dimension(slot, array.length - 1);
+        } else {
+            status = loaded.dimension(slot, array.rows - 1, array.columns - 1);
+            count = array.rows * array.columns;
+        }
+        if (status != STATUS_OK) error("NOT ENOUGH MEMORY FOR " + filename);
+        for (int k = 0; k < count; k++) loaded.setElement(slot, k, elements[array.firstElement + k]);
+    }
+    program.clear();
+    std::vector<Expression *> built;
+    for (uint32_t i = 0; i < header.lineCount; i++) {
+        const LineRecord &line = lines[i];
+        Arena arena;
+        Statement *stmt = decode(line, slots, arena, built);
+        program.appendLine(line.lineNumber, std::string_view(strings + line.sourceOffset, line.sourceLength),
+                           stmt, std::move(arena));
+    }
+    state = std::move(loaded);
+}
+
+Statement *ImageReader::decode(const LineRecord &line, const std::vector<int> &slots, Arena &arena,
+                               std::vector<Expression *> &built) {
+    if (line.nodeCount == 0) return nullptr;
+    built.resize(line.nodeCount);
+    for (uint32_t i = 0; i < line.nodeCount; i++) {
+        const NodeRecord &node = nodes[line.firstNode + i];
+        switch (node.kind) {
+            case NODE_CONSTANT:
+                built[i] = arena.make<ConstantExp>(node.a);
+                break;
+            case NODE_IDENTIFIER:
+                built[i] = arena.make<IdentifierExp>(slots[node.a]);
+                break;
+            case NODE_COMPOUND:
+                built[i] = arena.make<CompoundExp>((Operator) node.op, built[node.a], built[node.b]);
+                break;
+            case NODE_ARRAY: {
+                Expression *column = (node.c < 0) ? nullptr : built[node.c];
+                built[i] = arena.make<ArrayExp>(slots[node.a], built[node.b], column);
+                break;
+            }
+            case NODE_REM:
+                return arena.make<RemStatement>(arena.copyString(std::string_view(strings + node.a, node.b)));
+            case NODE_LET:
+                return arena.make<LetStatement>(slots[node.a], built[node.b], isReservedSymbol(node.a));
+            case NODE_PRINT:
+                return arena.make<PrintStatement>(built[node.b]);
+            case NODE_INPUT:
+                return arena.make<InputStatement>(slots[node.a], isReservedSymbol(node.a));
+            case NODE_END:
+                return arena.make<EndStatement>();
+            case NODE_GOTO:
+                return arena.make<GotoStatement>(node.a);
+            case NODE_IF:
+                return arena.make<IfStatement>(built[node.a], (Operator) node.op, built[node.b], node.c);
+            case NODE_DIM: {
+                Expression *columnBound = (node.c < 0) ? nullptr : built[node.c];
+                return arena.make<DimStatement>(slots[node.a], built[node.b], columnBound);
+            }
+            case NODE_LET_ELEMENT: {
+                bool reserved = isReservedSymbol(nodes[line.firstNode + node.a].a);
+                return arena.make<LetStatement>((ArrayExp *) built[node.a], built[node.b], reserved);
+            }
+            case NODE_INPUT_ELEMENT: {
+                bool reserved = isReservedSymbol(nodes[line.firstNode + node.a].a);
+                return arena.make<InputStatement>((ArrayExp *) built[node.a], reserved);
+            }
+        }
+    }
+    return nullptr;
+}
+
+void loadImage(Program &program, EvalState &state, const std::string &filename) {
+    MappedFile file(filename);
+    ImageReader reader(file, filename);
+    reader.load(program, state);
+}
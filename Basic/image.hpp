@@ -0,0 +1,41 @@
+/*
+ * File: image.h
+ * -------------
+ * This interface exports the functions that save a program, together
+ * with its variables, as a binary image and load it back.  Loading an
+ * image restores the parsed statements directly, without tokenizing
+ * or parsing a single line, so that large programs start quickly.
+ */
+
+#ifndef _image_h
+#define _image_h
+
+#include <string>
+#include "evalstate.hpp"
+#include "program.hpp"
+
+/*
+ * Function: saveImage
+ * Usage: saveImage(program, state, filename);
+ * -------------------------------------------
+ * Writes the lines of program, their parsed statements, the values
+ * of all variables defined in state and its arrays to the named file.
+ * If the file cannot be written, this function raises an error.
+ */
+
+void saveImage(Program &program, EvalState &state, const std::string &filename);
+
+/*
+ * Function: loadImage
+ * Usage: loadImage(program, state, filename);
+ * -------------------------------------------
+ * Replaces the program, the variables and the arrays with those
+ * stored in the named image, as if the program had been cleared and
+ * every line entered again.  If the file cannot be read or is not a
+ * valid image, this function raises an error and leaves them
+ * unchanged.
+ */
+
+void loadImage(Program &program, EvalState &state, const std::string &filename);
+
+#endif
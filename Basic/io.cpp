@@ -0,0 +1,267 @@
+/*
+ * File: io.cpp
+ * ------------
+ * This file implements the buffered output sink, the line reader and
+ * the channels that can replace them.
+ */
+
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "io.hpp"
+
+/*
+ * Implementation notes: output buffer
+ * -----------------------------------
+ * Output is collected in a fixed buffer and handed to the operating
+ * system with write(2), bypassing iostream entirely.  Nothing else in
+ * the interpreter writes to standard output, so no other buffer can
+ * reorder the output.
+ */
+
+static const size_t BUFFER_SIZE = 1 << 16;
+
+static thread_local Channel *channel = nullptr;
+
+static char buffer[BUFFER_SIZE];
+static size_t used = 0;
+static FlushPolicy policy = FLUSH_INPUT;
+
+void setFlushPolicy(FlushPolicy newPolicy) {
+    policy = newPolicy;
+}
+
+FlushPolicy getFlushPolicy() {
+    return policy;
+}
+
+static void writeAll(const char *data, size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = write(STDOUT_FILENO, data + done, size - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        done += (size_t) n;
+    }
+}
+
+void flushOutput() {
+    if (channel != nullptr) return;
+    writeAll(buffer, used);
+    used = 0;
+}
+
+/*
+ * Implementation notes: flushOnAbnormalExit
+ * -----------------------------------------
+ * The signal handler only calls write(2), which is safe in a signal
+ * handler, and then raises the signal again with its default action
+ * restored.  The terminate handler passes control on to the previous
+ * one, which prints the exception and aborts.  Either may run on a
+ * thread with a channel, so both write the shared buffer directly.
+ */
+
+static const int FATAL_SIGNALS[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+
+static std::terminate_handler previousTerminate = nullptr;
+
+static void flushOnSignal(int sig) {
+    writeAll(buffer, used);
+    used = 0;
+    raise(sig);
+}
+
+static void flushOnTerminate() {
+    writeAll(buffer, used);
+    used = 0;
+    if (previousTerminate != nullptr) previousTerminate();
+    std::abort();
+}
+
+void flushOnAbnormalExit() {
+    struct sigaction action = {};
+    action.sa_handler = flushOnSignal;
+    action.sa_flags = SA_RESETHAND | SA_NODEFER;
+    sigemptyset(&action.sa_mask);
+    for (int sig : FATAL_SIGNALS) sigaction(sig, &action, nullptr);
+    previousTerminate = std::set_terminate(flushOnTerminate);
+}
+
+void writeString(std::string_view str) {
+    if (channel != nullptr) {
+        channel->write(str);
+        return;
+    }
+    if (str.size() > BUFFER_SIZE - used) {
+        flushOutput();
+        if (str.size() > BUFFER_SIZE) {
+            writeAll(str.data(), str.size());
+            return;
+        }
+    }
+    memcpy(buffer + used, str.data(), str.size());
+    used += str.size();
+}
+
+/*
+ * Implementation notes: writeInteger
+ * ----------------------------------
+ * The digits are generated from the right into a small local buffer.
+ * Working on the unsigned magnitude makes INT_MIN print correctly.
+ */
+
+void writeInteger(int value) {
+    char digits[16];
+    char *end = digits + sizeof digits;
+    char *p = end;
+    unsigned magnitude = value < 0 ? 0u - (unsigned) value : (unsigned) value;
+    do {
+        *--p = (char) ('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (value < 0) *--p = '-';
+    writeString(std::string_view(p, end - p));
+}
+
+void endLine() {
+    if (channel != nullptr) {
+        channel->write("\n");
+        return;
+    }
+    if (used == BUFFER_SIZE) flushOutput();
+    buffer[used++] = '\n';
+    if (policy == FLUSH_LINE) flushOutput();
+}
+
+void writeLine(std::string_view str) {
+    writeString(str);
+    endLine();
+}
+
+void writeError(std::string_view message) {
+    writeLine(message);
+    if (policy != FLUSH_FULL) flushOutput();
+}
+
+void flushBeforeInput() {
+    if (policy != FLUSH_FULL) flushOutput();
+}
+
+/*
+ * Implementation notes: input
+ * ---------------------------
+ * Input comes either from a memory-mapped file, in which case the
+ * whole file is a single block, or from a descriptor that is read in
+ * blocks of at least BLOCK_SIZE bytes.  The unread part of the input
+ * is always inputData[inputStart, inputEnd).  Lines are found with
+ * memchr and handed out as views into that range.  When the range
+ * holds no complete line, its contents are moved to the front of the
+ * buffer, which grows only when a single line does not fit.
+ */
+
+static const size_t BLOCK_SIZE = 1 << 16;
+
+static int inputFd = STDIN_FILENO;
+static std::vector<char> inputBuffer;
+static const char *inputData = nullptr;
+static size_t inputStart = 0;
+static size_t inputEnd = 0;
+static bool inputAtEnd = false;
+
+bool openInput(const char *filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+        size_t size = (size_t) info.st_size;
+        void *map = size == 0 ? nullptr : mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            if (map != nullptr) madvise(map, size, MADV_SEQUENTIAL);
+            close(fd);
+            inputData = (const char *) map;
+            inputStart = 0;
+            inputEnd = size;
+            inputAtEnd = true;
+            return true;
+        }
+    }
+    inputFd = fd;
+    return true;
+}
+
+static bool fillInput() {
+    if (inputAtEnd) return false;
+    if (inputStart > 0) {
+        memmove(inputBuffer.data(), inputBuffer.data() + inputStart, inputEnd - inputStart);
+        inputEnd -= inputStart;
+        inputStart = 0;
+    }
+    if (inputBuffer.size() - inputEnd < BLOCK_SIZE) inputBuffer.resize(inputEnd + BLOCK_SIZE);
+    inputData = inputBuffer.data();
+    while (true) {
+        ssize_t n = read(inputFd, inputBuffer.data() + inputEnd, inputBuffer.size() - inputEnd);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            inputAtEnd = true;
+            return false;
+        }
+        inputEnd += (size_t) n;
+        return true;
+    }
+}
+
+bool readLine(std::string_view &line) {
+    if (channel != nullptr) return channel->readLine(line);
+    size_t scanned = 0;     /* Bytes after inputStart that hold no newline */
+    while (true) {
+        size_t from = inputStart + scanned;
+        if (from < inputEnd) {
+            const char *newline = (const char *) memchr(inputData + from, '\n', inputEnd - from);
+            if (newline != nullptr) {
+                size_t end = newline - inputData;
+                line = std::string_view(inputData + inputStart, end - inputStart);
+                inputStart = end + 1;
+                return true;
+            }
+            scanned = inputEnd - inputStart;
+        }
+        if (!fillInput()) break;
+    }
+    if (inputStart == inputEnd) return false;
+    line = std::string_view(inputData + inputStart, inputEnd - inputStart);
+    inputStart = inputEnd;
+    return true;
+}
+
+bool StringChannel::readLine(std::string_view &line) {
+    if (position == input.size()) return false;
+    size_t end = input.find('\n', position);
+    if (end == std::string::npos) end = input.size();
+    line = std::string_view(input.data() + position, end - position);
+    position = (end == input.size()) ? end : end + 1;
+    return true;
+}
+
+/*
+ * Implementation notes: channels
+ * ------------------------------
+ * The selected channel is a thread-local variable, so sessions running
+ * on different threads never see each other's input or output.  All
+ * other state in this file belongs to the standard streams and is only
+ * touched by threads that have not selected a channel.
+ */
+
+Channel *setChannel(Channel *newChannel) {
+    Channel *previous = channel;
+    channel = newChannel;
+    return previous;
+}
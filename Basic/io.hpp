@@ -0,0 +1,241 @@
+/*
+ * File: io.h
+ * ----------
+ * This interface exports the buffered output sink through which the
+ * interpreter writes everything it prints to standard output, and the
+ * line reader from which it takes all of its input.  Each thread may
+ * redirect both to a Channel of its own.
+ */
+
+#ifndef _io_h
+#define _io_h
+
+#include <string>
+#include <string_view>
+
+/*
+ * Type: FlushPolicy
+ * -----------------
+ * Determines when buffered output is written to standard output.
+ * Output is always written when the buffer fills up and when the
+ * interpreter exits, normally or, after flushOnAbnormalExit, through
+ * an uncaught exception or a fatal signal.
+ *
+ *   FLUSH_LINE   Write after every complete line.  This is the
+ *                behavior of std::endl and suits interactive use.
+ *   FLUSH_INPUT  Write before an INPUT prompt waits for the user and
+ *                after an error message.  This is the default.
+ *   FLUSH_FULL   Write only when the buffer is full or on exit.
+ */
+
+enum FlushPolicy {
+    FLUSH_LINE, FLUSH_INPUT, FLUSH_FULL
+};
+
+/*
+ * Function: setFlushPolicy
+ * Usage: setFlushPolicy(policy);
+ * ------------------------------
+ * Sets the policy that decides when output is flushed.
+ */
+
+void setFlushPolicy(FlushPolicy policy);
+
+/*
+ * Function: getFlushPolicy
+ * Usage: FlushPolicy policy = getFlushPolicy();
+ * ---------------------------------------------
+ * Returns the current flush policy.
+ */
+
+FlushPolicy getFlushPolicy();
+
+/*
+ * Function: writeString
+ * Usage: writeString(str);
+ * ------------------------
+ * Appends the characters of str to the output.
+ */
+
+void writeString(std::string_view str);
+
+/*
+ * Function: writeInteger
+ * Usage: writeInteger(value);
+ * ---------------------------
+ * Appends the decimal representation of value to the output.
+ */
+
+void writeInteger(int value);
+
+/*
+ * Function: endLine
+ * Usage: endLine();
+ * -----------------
+ * Terminates the current output line, flushing it if the policy is
+ * FLUSH_LINE.
+ */
+
+void endLine();
+
+/*
+ * Function: writeLine
+ * Usage: writeLine(str);
+ * ----------------------
+ * Writes str as a complete line.
+ */
+
+void writeLine(std::string_view str);
+
+/*
+ * Function: writeError
+ * Usage: writeError(message);
+ * ---------------------------
+ * Writes an error message as a complete line.  Unless the policy is
+ * FLUSH_FULL, the output is flushed so that the message appears
+ * immediately.
+ */
+
+void writeError(std::string_view message);
+
+/*
+ * Function: flushBeforeInput
+ * Usage: flushBeforeInput();
+ * --------------------------
+ * Flushes the output, unless the policy is FLUSH_FULL, before the
+ * interpreter waits for input from the user.
+ */
+
+void flushBeforeInput();
+
+/*
+ * Function: flushOutput
+ * Usage: flushOutput();
+ * ---------------------
+ * Writes all buffered output to standard output.
+ */
+
+void flushOutput();
+
+/*
+ * Function: flushOnAbnormalExit
+ * Usage: flushOnAbnormalExit();
+ * -----------------------------
+ * Arranges for buffered output to be written if the process ends
+ * through an uncaught exception or a fatal signal such as SIGSEGV or
+ * SIGFPE, so that everything printed before the failure still
+ * appears.  The process then ends as it would have otherwise.
+ */
+
+void flushOnAbnormalExit();
+
+/*
+ * Function: openInput
+ * Usage: if (!openInput(filename)) ...
+ * ------------------------------------
+ * Makes the named file, instead of standard input, the source of the
+ * lines returned by readLine.  A regular file is mapped into memory;
+ * other files are read in blocks.  Returns false if the file cannot
+ * be opened.
+ */
+
+bool openInput(const char *filename);
+
+/*
+ * Function: readLine
+ * Usage: if (readLine(line)) ...
+ * ------------------------------
+ * Reads the next line of input, without its terminating newline, and
+ * returns true, or returns false at the end of the input.  As with
+ * getline, a final line without a newline is still returned.  Input
+ * is read in large blocks, and line points into the block that holds
+ * it, so it remains valid only until the next call to readLine.  The
+ * interpreter's commands and the values read by INPUT are taken from
+ * this one stream.
+ */
+
+bool readLine(std::string_view &line);
+
+/*
+ * Class: Channel
+ * --------------
+ * The abstract interface of a replacement for standard input and
+ * output.  While a channel is selected for a thread, every output
+ * function above appends to the channel instead of the shared output
+ * buffer, and readLine reads from the channel.  Flush policies do not
+ * apply to channels.
+ */
+
+class Channel {
+
+public:
+
+    virtual ~Channel() = default;
+
+/*
+ * Method: write
+ * Usage: channel.write(data);
+ * ---------------------------
+ * Appends data to the output of the channel.
+ */
+
+    virtual void write(std::string_view data) = 0;
+
+/*
+ * Method: readLine
+ * Usage: if (channel.readLine(line)) ...
+ * --------------------------------------
+ * Reads the next input line, with the same contract as the free
+ * function readLine.
+ */
+
+    virtual bool readLine(std::string_view &line) = 0;
+
+};
+
+/*
+ * Class: StringChannel
+ * --------------------
+ * A channel that reads its input from a string given in advance and
+ * collects its output in memory.
+ */
+
+class StringChannel : public Channel {
+
+public:
+
+    explicit StringChannel(std::string input) : input(std::move(input)) {}
+
+    void write(std::string_view data) override { output.append(data); }
+
+    bool readLine(std::string_view &line) override;
+
+/*
+ * Method: getOutput
+ * Usage: const std::string &output = channel.getOutput();
+ * -------------------------------------------------------
+ * Returns everything written to the channel so far.
+ */
+
+    const std::string &getOutput() const { return output; }
+
+private:
+
+    std::string input;
+    size_t position = 0;
+    std::string output;
+
+};
+
+/*
+ * Function: setChannel
+ * Usage: Channel *previous = setChannel(&channel);
+ * ------------------------------------------------
+ * Selects the channel used for input and output by the calling thread
+ * and returns the one selected before.  A null channel selects
+ * standard input and output.
+ */
+
+Channel *setChannel(Channel *channel);
+
+#endif
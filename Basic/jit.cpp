@@ -0,0 +1,672 @@
+/*
+ * File: jit.cpp
+ * -------------
+ * This file implements the translation of bytecode into x86-64 machine
+ * code.  On other platforms NativeCode::isSupported returns false and
+ * the virtual machine never asks for a translation.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <sys/mman.h>
+#include "jit.hpp"
+#include "io.hpp"
+#include "statement.hpp"
+#include "Utils/error.hpp"
+
+/*
+ * Implementation notes: calling convention
+ * ----------------------------------------
+ * The generated code is a single function with the System V signature
+ *
+ *    int code(Context *context, const void *entry);
+ *
+ * which saves the callee-saved registers, loads the base addresses
+ * below from the context and jumps to entry.  It returns one of the
+ * exit codes that follow, and run turns each of them into the
+ * corresponding Status.  The helpers that the generated code calls
+ * report their own errors through the context.
+ *
+ *    rbx   values of the variables        r14   the context
+ *    r12   defined flags of the variables r15   operand stack spill area
+ *    r13   temporaries                    rbp   records of the arrays
+ */
+
+namespace {
+
+struct Context {
+    int *values;
+    char *defined;
+    int *temps;
+    int *stack;
+    Array *arrays;
+    EvalState *state;
+    int status;
+    char failed;
+    int position;                       /* Kept across a call to input  */
+};
+
+enum ExitCode {
+    EXIT_END, EXIT_UNDEFINED, EXIT_DIVIDE_BY_ZERO, EXIT_SUBSCRIPT, EXIT_CALL, EXIT_FAIL
+};
+
+typedef int (*Function)(Context *context, const void *entry);
+
+}
+
+#if defined(__x86_64__) && defined(__unix__)
+
+namespace {
+
+enum Register {
+    RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15
+};
+
+/*
+ * Implementation notes: operand stack
+ * -----------------------------------
+ * The depth of the operand stack before every instruction is known
+ * when the code is generated, so stack entries are given fixed homes:
+ * the first ones live in caller-saved registers that no instruction
+ * uses implicitly, the rest in the spill area addressed through r15.
+ * Calls out of the generated code happen only where the stack holds
+ * nothing that survives them.
+ */
+
+const Register STACK_REGISTERS[] = {RCX, RSI, RDI, R8, R9, R10, R11};
+const int N_STACK_REGISTERS = sizeof STACK_REGISTERS / sizeof STACK_REGISTERS[0];
+
+/*
+ * Constant: LOOP_ALIGNMENT
+ * ------------------------
+ * The boundary on which the target of every backward jump starts.
+ * Without it, the speed of a tight loop depended on where earlier code
+ * happened to end, by as much as half.
+ */
+
+const int LOOP_ALIGNMENT = 32;
+
+/*
+ * Type: Operand
+ * -------------
+ * A 32-bit operand, either a register or the doubleword at base + disp.
+ */
+
+struct Operand {
+    bool memory;
+    int reg;
+    int base;
+    int disp;
+};
+
+Operand reg(int r) {
+    return {false, r, 0, 0};
+}
+
+Operand mem(int base, int disp) {
+    return {true, 0, base, disp};
+}
+
+Operand stackEntry(int depth) {
+    if (depth < N_STACK_REGISTERS) return reg(STACK_REGISTERS[depth]);
+    return mem(R15, 4 * (depth - N_STACK_REGISTERS));
+}
+
+/*
+ * Class: Assembler
+ * ----------------
+ * Encodes the small subset of x86-64 that the translation needs.
+ * Operations on 32-bit operands are written as op(dst, src) in Intel
+ * operand order; the label functions support forward jumps.
+ */
+
+class Assembler {
+
+public:
+
+    std::vector<unsigned char> bytes;
+
+    int size() const { return (int) bytes.size(); }
+
+    void byte(int b) { bytes.push_back((unsigned char) b); }
+
+    void dword(int32_t v) {
+        for (int i = 0; i < 4; i++) byte((v >> (8 * i)) & 0xFF);
+    }
+
+    void qword(uint64_t v) {
+        for (int i = 0; i < 8; i++) byte((int) ((v >> (8 * i)) & 0xFF));
+    }
+
+/*
+ * Method: encode
+ * Usage: encode({opcode...}, regField, rm, wide);
+ * -----------------------------------------------
+ * Emits the REX prefix if one is needed, the opcode bytes and the
+ * ModRM byte, with its SIB byte and displacement, for rm.
+ */
+
+    void encode(std::initializer_list<int> opcode, int regField, const Operand &rm, bool wide = false) {
+        int low = rm.memory ? rm.base : rm.reg;
+        int rex = 0x40 | (wide ? 8 : 0) | ((regField & 8) ? 4 : 0) | ((low & 8) ? 1 : 0);
+        if (rex != 0x40) byte(rex);
+        for (int b : opcode) byte(b);
+        if (!rm.memory) {
+            byte(0xC0 | (regField & 7) << 3 | (rm.reg & 7));
+            return;
+        }
+        int mod = (rm.disp == 0 && (rm.base & 7) != RBP) ? 0 : (rm.disp >= -128 && rm.disp < 128) ? 1 : 2;
+        byte(mod << 6 | (regField & 7) << 3 | (rm.base & 7));
+        if ((rm.base & 7) == RSP) byte(0x24);
+        if (mod == 1) byte(rm.disp);
+        if (mod == 2) dword(rm.disp);
+    }
+
+    void load(int r, const Operand &src) { encode({0x8B}, r, src); }
+    void store(const Operand &dst, int r) { encode({0x89}, r, dst); }
+
+    void move(const Operand &dst, const Operand &src) {
+        if (!dst.memory) {
+            load(dst.reg, src);
+        } else if (!src.memory) {
+            store(dst, src.reg);
+        } else {
+            load(RAX, src);
+            store(dst, RAX);
+        }
+    }
+
+    void moveImmediate(const Operand &dst, int32_t value) {
+        if (dst.memory) {
+            encode({0xC7}, 0, dst);
+        } else {
+            if (dst.reg & 8) byte(0x41);
+            byte(0xB8 + (dst.reg & 7));
+        }
+        dword(value);
+    }
+
+    void loadPointer(int r, int base, int disp) { encode({0x8B}, r, mem(base, disp), true); }
+    void movePointer(int dst, int src) { encode({0x89}, src, reg(dst), true); }
+
+    void compareImmediate(const Operand &dst, int8_t value) { encode({0x83}, 7, dst); byte(value); }
+    void compareByte(const Operand &dst, int8_t value) { encode({0x80}, 7, dst); byte(value); }
+    void storeByte(const Operand &dst, int8_t value) { encode({0xC6}, 0, dst); byte(value); }
+
+/*
+ * Method: addScaled
+ * Usage: as.addScaled(base, index);
+ * ---------------------------------
+ * Emits lea base, [base + 4 * index], which advances the address of
+ * the first element of an array to the element at position index.
+ * The base must be neither rbp nor r13, and the index must have been
+ * written as a 32-bit value, which clears its upper half.
+ */
+
+    void addScaled(int base, int index) {
+        byte(0x48 | ((base & 8) ? 4 : 0) | ((index & 8) ? 2 : 0) | ((base & 8) ? 1 : 0));
+        byte(0x8D);
+        byte(0x04 | (base & 7) << 3);
+        byte(0x80 | (index & 7) << 3 | (base & 7));
+    }
+
+    void push(int r) { if (r & 8) byte(0x41); byte(0x50 + (r & 7)); }
+    void pop(int r) { if (r & 8) byte(0x41); byte(0x58 + (r & 7)); }
+
+    void call(const void *function) {
+        byte(0x48);
+        byte(0xB8);
+        qword((uint64_t) (uintptr_t) function);
+        encode({0xFF}, 2, reg(RAX));
+    }
+
+/*
+ * Methods: jump, jumpIf, bind
+ * ---------------------------
+ * jump and jumpIf emit a jump with a 32-bit displacement and return
+ * the position of that displacement, which bind later fills in.  The
+ * condition codes are those of the Jcc encodings.
+ */
+
+    void align(int boundary) {
+        while (size() % boundary != 0) byte(0x90);
+    }
+
+    int jump() { byte(0xE9); dword(0); return size() - 4; }
+    int jumpIf(int cc) { byte(0x0F); byte(0x80 | cc); dword(0); return size() - 4; }
+
+    void bind(int at, int target) {
+        int32_t rel = target - (at + 4);
+        memcpy(&bytes[at], &rel, 4);
+    }
+
+};
+
+enum Condition {
+    CC_AE = 0x3, CC_E = 0x4, CC_NE = 0x5, CC_L = 0xC, CC_GE = 0xD, CC_LE = 0xE, CC_G = 0xF
+};
+
+/*
+ * Function: field
+ * Usage: int disp = field(slot, offsetof(Array, length));
+ * -------------------------------------------------------
+ * Returns the displacement from rbp of a field of the record of the
+ * array in slot.
+ */
+
+int field(int slot, size_t offset) {
+    return slot * (int) sizeof(Array) + (int) offset;
+}
+
+/* Helpers called from the generated code */
+
+void report(Context *context, Status status) {
+    if (status != STATUS_OK) {
+        context->status = status;
+        context->failed = 1;
+    }
+}
+
+void printValue(int value) {
+    writeInteger(value);
+    endLine();
+}
+
+int inputValue(Context *context) {
+    int value = 0;
+    report(context, readInputValue(value));
+    return value;
+}
+
+void dimensionList(Context *context, int slot, int bound) {
+    report(context, context->state->dimensionAt(slot, bound));
+}
+
+void dimensionTable(Context *context, int slot, int rowBound, int columnBound) {
+    report(context, context->state->dimensionAt(slot, rowBound, columnBound));
+}
+
+/*
+ * Class: Translator
+ * -----------------
+ * Translates one program instruction by instruction.  The exits for
+ * runtime errors are shared stubs at the end of the code.
+ */
+
+class Translator {
+
+public:
+
+    Translator(const Bytecode &bytecode, std::vector<int> &offsets)
+            : bytecode(bytecode), offsets(offsets) {}
+
+    std::vector<unsigned char> translate();
+
+private:
+
+    struct Fixup {
+        int at;
+        int instruction;
+    };
+
+    const Bytecode &bytecode;
+    std::vector<int> &offsets;
+    Assembler as;
+    std::vector<Fixup> fixups;
+    std::vector<int> exits[EXIT_FAIL];
+    std::vector<int> failures;
+
+    void translate(const Instruction &in, int depth);
+    void arithmetic(Opcode op, int depth);
+    void element(const Instruction &in, int depth);
+    void checkCall();
+    void exitTo(ExitCode code, int at) { exits[code].push_back(at); }
+
+};
+
+/*
+ * Implementation notes: translate
+ * -------------------------------
+ * The stack depth is reset to zero at the start of every line.  After
+ * an instruction that never falls through, code up to the next line
+ * start is unreachable, because jumps only lead to line starts, and is
+ * not translated at all.
+ */
+
+std::vector<unsigned char> Translator::translate() {
+    as.push(RBP);
+    as.push(RBX);
+    as.push(R12);
+    as.push(R13);
+    as.push(R14);
+    as.push(R15);
+    as.encode({0x83}, 5, reg(RSP), true);       /* sub rsp, 8: align for calls */
+    as.byte(8);
+    as.movePointer(R14, RDI);
+    as.loadPointer(RBX, R14, offsetof(Context, values));
+    as.loadPointer(R12, R14, offsetof(Context, defined));
+    as.loadPointer(R13, R14, offsetof(Context, temps));
+    as.loadPointer(R15, R14, offsetof(Context, stack));
+    as.loadPointer(RBP, R14, offsetof(Context, arrays));
+    as.encode({0xFF}, 4, reg(RSI));             /* jmp rsi */
+
+    int n = (int) bytecode.code.size();
+    std::vector<char> lineStart(n + 1, 0);
+    for (int start : bytecode.lineStarts) lineStart[start] = 1;
+    std::vector<char> loopHead(n + 1, 0);
+    for (int i = 0; i < n; i++) {
+        const Instruction &in = bytecode.code[i];
+        if (in.op >= OP_JUMP && in.op <= OP_JUMP_GE && in.operand <= i) loopHead[in.operand] = 1;
+    }
+    offsets.assign(n, 0);
+    int depth = 0;
+    bool reachable = true;
+    for (int i = 0; i < n; i++) {
+        const Instruction &in = bytecode.code[i];
+        if (lineStart[i]) {
+            depth = 0;
+            reachable = true;
+        }
+        if (loopHead[i]) as.align(LOOP_ALIGNMENT);
+        offsets[i] = as.size();
+        if (!reachable) continue;
+        translate(in, depth);
+        StackEffect effect = stackEffect(in.op);
+        depth += effect.pushes - effect.pops;
+        if (in.op == OP_JUMP || in.op == OP_END || in.op == OP_FAIL) reachable = false;
+    }
+    for (const Fixup &f : fixups) as.bind(f.at, offsets[f.instruction]);
+
+    for (int code = EXIT_UNDEFINED; code < EXIT_FAIL; code++) {
+        for (int at : exits[code]) as.bind(at, as.size());
+        as.moveImmediate(reg(RAX), code);
+        int done = as.jump();
+        exitTo(EXIT_END, done);
+    }
+    for (int at : exits[EXIT_END]) as.bind(at, as.size());
+    as.encode({0x83}, 0, reg(RSP), true);       /* add rsp, 8 */
+    as.byte(8);
+    as.pop(R15);
+    as.pop(R14);
+    as.pop(R13);
+    as.pop(R12);
+    as.pop(RBX);
+    as.pop(RBP);
+    as.byte(0xC3);
+    return as.bytes;
+}
+
+void Translator::translate(const Instruction &in, int depth) {
+    Operand top = stackEntry(std::max(depth - 1, 0));
+    switch (in.op) {
+        case OP_PUSH:
+            as.moveImmediate(stackEntry(depth), in.operand);
+            break;
+        case OP_LOAD:
+            as.compareByte(mem(R12, in.operand), 0);
+            exitTo(EXIT_UNDEFINED, as.jumpIf(CC_E));
+            as.move(stackEntry(depth), mem(RBX, 4 * in.operand));
+            break;
+        case OP_LOAD_SAFE:
+            as.move(stackEntry(depth), mem(RBX, 4 * in.operand));
+            break;
+        case OP_STORE:
+        case OP_SET:
+            as.move(mem(RBX, 4 * in.operand), top);
+            as.storeByte(mem(R12, in.operand), 1);
+            break;
+        case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV:
+            arithmetic(in.op, depth);
+            break;
+        case OP_NEG:
+            as.encode({0xF7}, 3, top);
+            break;
+        case OP_SAVE:
+            as.move(mem(R13, 4 * in.operand), top);
+            break;
+        case OP_RECALL:
+            as.move(stackEntry(depth), mem(R13, 4 * in.operand));
+            break;
+        case OP_JUMP:
+            fixups.push_back({as.jump(), in.operand});
+            break;
+        case OP_JUMP_EQ: case OP_JUMP_NE: case OP_JUMP_LT:
+        case OP_JUMP_GT: case OP_JUMP_LE: case OP_JUMP_GE: {
+            Operand lhs = stackEntry(depth - 2);
+            if (lhs.memory) {
+                as.load(RAX, lhs);
+                lhs = reg(RAX);
+            }
+            as.encode({0x3B}, lhs.reg, top);
+            int cc;
+            switch (in.op) {
+                case OP_JUMP_EQ: cc = CC_E; break;
+                case OP_JUMP_NE: cc = CC_NE; break;
+                case OP_JUMP_LT: cc = CC_L; break;
+                case OP_JUMP_GT: cc = CC_G; break;
+                case OP_JUMP_LE: cc = CC_LE; break;
+                default: cc = CC_GE; break;
+            }
+            fixups.push_back({as.jumpIf(cc), in.operand});
+            break;
+        }
+        case OP_PRINT:
+            as.load(RDI, top);
+            as.call((const void *) &printValue);
+            break;
+        case OP_INPUT:
+            as.movePointer(RDI, R14);
+            as.call((const void *) &inputValue);
+            checkCall();
+            as.store(mem(RBX, 4 * in.operand), RAX);
+            as.storeByte(mem(R12, in.operand), 1);
+            break;
+        case OP_DIM:
+            as.load(RDX, top);
+            as.moveImmediate(reg(RSI), in.operand);
+            as.movePointer(RDI, R14);
+            as.call((const void *) &dimensionList);
+            checkCall();
+            break;
+        case OP_DIM2:
+            as.load(RAX, top);
+            as.load(RDX, stackEntry(depth - 2));
+            as.load(RCX, reg(RAX));
+            as.moveImmediate(reg(RSI), in.operand);
+            as.movePointer(RDI, R14);
+            as.call((const void *) &dimensionTable);
+            checkCall();
+            break;
+        case OP_INDEX: {
+            int r = top.memory ? RAX : top.reg;
+            if (top.memory) as.load(RAX, top);
+            as.encode({0x3B}, r, mem(RBP, field(in.operand, offsetof(Array, length))));
+            exitTo(EXIT_SUBSCRIPT, as.jumpIf(CC_AE));
+            break;
+        }
+        case OP_INDEX2: case OP_INDEX2_SAFE: {
+            Operand row = stackEntry(depth - 2);
+            int r = row.memory ? RAX : row.reg;
+            int c = top.memory ? RDX : top.reg;
+            if (row.memory) as.load(RAX, row);
+            if (top.memory) as.load(RDX, top);
+            if (in.op == OP_INDEX2) {
+                as.encode({0x3B}, r, mem(RBP, field(in.operand, offsetof(Array, rows))));
+                exitTo(EXIT_SUBSCRIPT, as.jumpIf(CC_AE));
+                as.encode({0x3B}, c, mem(RBP, field(in.operand, offsetof(Array, columns))));
+                exitTo(EXIT_SUBSCRIPT, as.jumpIf(CC_AE));
+            }
+            as.encode({0x0F, 0xAF}, r, mem(RBP, field(in.operand, offsetof(Array, columns))));
+            as.encode({0x03}, r, reg(c));
+            if (row.memory) as.store(row, RAX);
+            break;
+        }
+        case OP_LOAD_ELEM: case OP_STORE_ELEM: case OP_SET_ELEM: case OP_INPUT_ELEM:
+            element(in, depth);
+            break;
+        case OP_END:
+            as.moveImmediate(reg(RAX), EXIT_END);
+            exitTo(EXIT_END, as.jump());
+            break;
+        case OP_FAIL:
+            as.moveImmediate(reg(RAX), EXIT_FAIL + in.operand);
+            exitTo(EXIT_END, as.jump());
+            break;
+        case OP_LINE:
+            break;
+    }
+}
+
+void Translator::checkCall() {
+    as.compareByte(mem(R14, offsetof(Context, failed)), 0);
+    exitTo(EXIT_CALL, as.jumpIf(CC_NE));
+}
+
+/*
+ * Implementation notes: element
+ * -----------------------------
+ * An element is reached by loading the address of the first element
+ * of its array into rax and advancing it by the position, which is in
+ * a register by then.  INPUT keeps the position in the context while
+ * the value is read, since no register survives the call.
+ */
+
+void Translator::element(const Instruction &in, int depth) {
+    int elements = field(in.operand, offsetof(Array, elements));
+    Operand top = stackEntry(depth - 1);
+    if (in.op == OP_INPUT_ELEM) {
+        as.move(mem(R14, offsetof(Context, position)), top);
+        as.movePointer(RDI, R14);
+        as.call((const void *) &inputValue);
+        checkCall();
+        as.load(RCX, reg(RAX));
+        as.load(RDX, mem(R14, offsetof(Context, position)));
+        as.loadPointer(RAX, RBP, elements);
+        as.addScaled(RAX, RDX);
+        as.store(mem(RAX, 0), RCX);
+        return;
+    }
+    Operand position = (in.op == OP_LOAD_ELEM) ? top : stackEntry(depth - 2);
+    int r = position.memory ? RDX : position.reg;
+    if (position.memory) as.load(RDX, position);
+    as.loadPointer(RAX, RBP, elements);
+    as.addScaled(RAX, r);
+    if (in.op == OP_LOAD_ELEM) {
+        as.load(r, mem(RAX, 0));
+        if (position.memory) as.store(position, RDX);
+        return;
+    }
+    if (top.memory) {
+        as.load(RDX, top);
+        as.store(mem(RAX, 0), RDX);
+    } else {
+        as.store(mem(RAX, 0), top.reg);
+    }
+    if (in.op == OP_SET_ELEM) as.move(position, top);
+}
+
+/*
+ * Implementation notes: arithmetic
+ * --------------------------------
+ * Addition, subtraction and multiplication wrap around like the
+ * unsigned arithmetic of the virtual machine.  Division checks for a
+ * zero divisor first and, like the virtual machine, negates instead
+ * of dividing by -1, since idiv traps on INT_MIN divided by -1.
+ */
+
+void Translator::arithmetic(Opcode op, int depth) {
+    Operand lhs = stackEntry(depth - 2);
+    Operand rhs = stackEntry(depth - 1);
+    if (op == OP_DIV) {
+        as.compareImmediate(rhs, 0);
+        exitTo(EXIT_DIVIDE_BY_ZERO, as.jumpIf(CC_E));
+        as.compareImmediate(rhs, -1);
+        int divide = as.jumpIf(CC_NE);
+        as.encode({0xF7}, 3, lhs);              /* neg */
+        int done = as.jump();
+        as.bind(divide, as.size());
+        as.load(RAX, lhs);
+        as.byte(0x99);                          /* cdq */
+        as.encode({0xF7}, 7, rhs);              /* idiv */
+        as.store(lhs, RAX);
+        as.bind(done, as.size());
+        return;
+    }
+    int r = lhs.memory ? RAX : lhs.reg;
+    if (lhs.memory) as.load(RAX, lhs);
+    switch (op) {
+        case OP_ADD: as.encode({0x03}, r, rhs); break;
+        case OP_SUB: as.encode({0x2B}, r, rhs); break;
+        default: as.encode({0x0F, 0xAF}, r, rhs); break;
+    }
+    if (lhs.memory) as.store(lhs, RAX);
+}
+
+}
+
+bool NativeCode::isSupported() {
+    return true;
+}
+
+Status NativeCode::compile(const Bytecode &bytecode) {
+    release();
+    Translator translator(bytecode, offsets);
+    std::vector<unsigned char> code = translator.translate();
+    size_t page = 4096;
+    size = (code.size() + page - 1) / page * page;
+    void *pages = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (pages == MAP_FAILED) {
+        size = 0;
+        return STATUS_NATIVE_MEMORY;
+    }
+    memcpy(pages, code.data(), code.size());
+    memory = (unsigned char *) pages;
+    if (mprotect(pages, size, PROT_READ | PROT_EXEC) != 0) {
+        release();
+        return STATUS_NATIVE_MEMORY;
+    }
+    return STATUS_OK;
+}
+
+void NativeCode::release() {
+    if (memory != nullptr) munmap(memory, size);
+    memory = nullptr;
+    size = 0;
+}
+
+#else
+
+bool NativeCode::isSupported() {
+    return false;
+}
+
+Status NativeCode::compile(const Bytecode &bytecode) {
+    (void) bytecode;
+    error("Native code is not supported on this platform");
+    return STATUS_OK;
+}
+
+void NativeCode::release() {
+}
+
+#endif
+
+NativeCode::~NativeCode() {
+    release();
+}
+
+Status NativeCode::run(int entry, EvalState &state, int *temps, int *stack) const {
+    Context context = {state.values.data(), state.defined.data(), temps, stack,
+                       state.arrays.data(), &state, STATUS_OK, 0, 0};
+    int code = ((Function) (void *) memory)(&context, memory + offsets[entry]);
+    switch (code) {
+        case EXIT_END: return STATUS_OK;
+        case EXIT_UNDEFINED: return STATUS_VARIABLE_NOT_DEFINED;
+        case EXIT_DIVIDE_BY_ZERO: return STATUS_DIVIDE_BY_ZERO;
+        case EXIT_SUBSCRIPT: return STATUS_SUBSCRIPT_OUT_OF_RANGE;
+        case EXIT_CALL: return (Status) context.status;
+        default: return (Status) (code - EXIT_FAIL);
+    }
+}
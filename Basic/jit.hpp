@@ -0,0 +1,86 @@
+/*
+ * File: jit.h
+ * -----------
+ * This interface exports the NativeCode class, which translates the
+ * bytecode of a program into x86-64 machine code.  The virtual machine
+ * uses it as an optional second tier for programs whose loops run hot.
+ */
+
+#ifndef _jit_h
+#define _jit_h
+
+#include <cstddef>
+#include <vector>
+#include "compiler.hpp"
+#include "evalstate.hpp"
+
+/*
+ * Class: NativeCode
+ * -----------------
+ * Holds the machine code for one compiled program in executable pages
+ * of its own.  The code performs arithmetic, variable access, the
+ * relational tests and all jumps itself; PRINT and INPUT call back
+ * into the interpreter, and runtime errors leave the machine code and
+ * are returned by run as the statuses the virtual machine uses, so
+ * the output of a program does not depend on where it ran.
+ */
+
+class NativeCode {
+
+public:
+
+/*
+ * Method: isSupported
+ * Usage: if (NativeCode::isSupported()) ...
+ * -----------------------------------------
+ * Returns true if machine code can be generated on this platform.
+ */
+
+    static bool isSupported();
+
+    NativeCode() = default;
+
+    ~NativeCode();
+
+    NativeCode(const NativeCode &) = delete;
+
+    NativeCode &operator=(const NativeCode &) = delete;
+
+/*
+ * Method: compile
+ * Usage: Status status = native.compile(bytecode);
+ * ------------------------------------------------
+ * Translates the whole program into machine code, replacing any code
+ * compiled before.  Returns STATUS_NATIVE_MEMORY if no executable
+ * memory can be had for it.  Must only be called if isSupported
+ * returns true.
+ */
+
+    Status compile(const Bytecode &bytecode);
+
+/*
+ * Method: run
+ * Usage: Status status = native.run(entry, state, temps, stack);
+ * --------------------------------------------------------------
+ * Executes the compiled program from instruction entry, which must be
+ * the start of a line, until it reaches OP_END.  The variables and
+ * arrays are those of state, which must be bound to the program, and
+ * temps and stack are the temporaries and the operand stack of the
+ * virtual machine that was running the bytecode.  The code itself is
+ * never written, so several threads may run it at once.  Returns
+ * STATUS_OK or the runtime error that stopped it.
+ */
+
+    Status run(int entry, EvalState &state, int *temps, int *stack) const;
+
+private:
+
+    unsigned char *memory = nullptr;    /* The executable pages         */
+    size_t size = 0;                    /* Their size in bytes          */
+    std::vector<int> offsets;           /* Code offset per instruction  */
+
+    void release();
+
+};
+
+#endif
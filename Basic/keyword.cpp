@@ -0,0 +1,77 @@
+/*
+ * File: keyword.cpp
+ * -----------------
+ * This file implements the keyword.h interface.
+ */
+
+#include <array>
+#include "keyword.hpp"
+
+/*
+ * Implementation notes: keyword table
+ * -----------------------------------
+ * The keywords are found with a perfect hash of the length and the
+ * first and last letters of a word, so that a lookup reads one table
+ * entry and then compares at most one name.  The table is built when
+ * the interpreter is compiled, and the static_assert below fails the
+ * build if a keyword added later collides with another; the
+ * multipliers in slotOf must then be chosen again.
+ */
+
+namespace {
+
+constexpr std::string_view KEYWORD_NAMES[] = {
+    "", "REM", "LET", "PRINT", "INPUT", "END", "GOTO", "IF", "THEN", "RUN", "LIST",
+    "CLEAR", "QUIT", "HELP", "PROFILE", "SAVE", "LOAD", "CACHE", "SAMPLE", "VERIFY",
+    "DIM"
+};
+
+constexpr int N_KEYWORDS = sizeof KEYWORD_NAMES / sizeof KEYWORD_NAMES[0];
+constexpr int KEYWORD_SLOTS = 32;
+constexpr size_t MIN_LENGTH = 2;
+constexpr size_t MAX_LENGTH = 7;
+
+constexpr char upper(char ch) {
+    return (ch >= 'a' && ch <= 'z') ? (char) (ch - 'a' + 'A') : ch;
+}
+
+constexpr int slotOf(std::string_view word) {
+    unsigned first = (unsigned char) upper(word.front());
+    unsigned last = (unsigned char) upper(word.back());
+    return (int) ((first * 14 + last * 13 + word.size() * 2) % KEYWORD_SLOTS);
+}
+
+constexpr std::array<Keyword, KEYWORD_SLOTS> buildTable() {
+    std::array<Keyword, KEYWORD_SLOTS> table = {};
+    for (int k = 1; k < N_KEYWORDS; k++) {
+        table[slotOf(KEYWORD_NAMES[k])] = (Keyword) k;
+    }
+    return table;
+}
+
+constexpr std::array<Keyword, KEYWORD_SLOTS> KEYWORD_TABLE = buildTable();
+
+constexpr bool isPerfect() {
+    for (int k = 1; k < N_KEYWORDS; k++) {
+        std::string_view name = KEYWORD_NAMES[k];
+        if (KEYWORD_TABLE[slotOf(name)] != k) return false;
+        if (name.size() < MIN_LENGTH || name.size() > MAX_LENGTH) return false;
+    }
+    return true;
+}
+
+static_assert(isPerfect(), "keyword hash has a collision");
+static_assert(N_KEYWORDS == KEYWORD_DIM + 1, "keyword names out of step with Keyword");
+
+}
+
+Keyword lookupKeyword(std::string_view word) {
+    if (word.size() < MIN_LENGTH || word.size() > MAX_LENGTH) return KEYWORD_NONE;
+    Keyword keyword = KEYWORD_TABLE[slotOf(word)];
+    std::string_view name = KEYWORD_NAMES[keyword];
+    if (name.size() != word.size()) return KEYWORD_NONE;
+    for (size_t i = 0; i < word.size(); i++) {
+        if (upper(word[i]) != name[i]) return KEYWORD_NONE;
+    }
+    return keyword;
+}
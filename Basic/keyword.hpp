@@ -0,0 +1,69 @@
+/*
+ * File: keyword.h
+ * ---------------
+ * This interface exports the keywords of the interpreter: the names
+ * of its statements and commands, and the words that may not be used
+ * as variables.
+ */
+
+#ifndef _keyword_h
+#define _keyword_h
+
+#include <string_view>
+
+/*
+ * Type: Keyword
+ * -------------
+ * The words that the interpreter recognizes, in any combination of
+ * case.  KEYWORD_NONE stands for every other word.  The keywords from
+ * KEYWORD_REM to KEYWORD_HELP are reserved; the commands and the DIM
+ * statement added since, and the SAMPLE option of PROFILE, remain
+ * valid variable names.
+ */
+
+enum Keyword {
+    KEYWORD_NONE,
+    KEYWORD_REM,
+    KEYWORD_LET,
+    KEYWORD_PRINT,
+    KEYWORD_INPUT,
+    KEYWORD_END,
+    KEYWORD_GOTO,
+    KEYWORD_IF,
+    KEYWORD_THEN,
+    KEYWORD_RUN,
+    KEYWORD_LIST,
+    KEYWORD_CLEAR,
+    KEYWORD_QUIT,
+    KEYWORD_HELP,
+    KEYWORD_PROFILE,
+    KEYWORD_SAVE,
+    KEYWORD_LOAD,
+    KEYWORD_CACHE,
+    KEYWORD_SAMPLE,
+    KEYWORD_VERIFY,
+    KEYWORD_DIM
+};
+
+/*
+ * Function: lookupKeyword
+ * Usage: Keyword keyword = lookupKeyword(word);
+ * ---------------------------------------------
+ * Returns the keyword spelled by word, compared without regard to
+ * case, or KEYWORD_NONE.  The lookup neither allocates nor copies.
+ */
+
+Keyword lookupKeyword(std::string_view word);
+
+/*
+ * Function: isReservedKeyword
+ * Usage: if (isReservedKeyword(keyword)) . . .
+ * --------------------------------------------
+ * Returns true if the keyword cannot be used as a variable.
+ */
+
+inline bool isReservedKeyword(Keyword keyword) {
+    return keyword >= KEYWORD_REM && keyword <= KEYWORD_HELP;
+}
+
+#endif
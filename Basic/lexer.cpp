@@ -0,0 +1,137 @@
+/*
+ * File: lexer.cpp
+ * ---------------
+ * This file implements the lexer.h interface.
+ */
+
+#include <cctype>
+#include <string>
+#include "lexer.hpp"
+
+Lexer::Lexer(std::string_view input) {
+    setInput(input);
+}
+
+void Lexer::setInput(std::string_view input) {
+    this->input = input;
+    position = 0;
+    head = 0;
+    count = 0;
+    stops = STOP_NONE;
+}
+
+Token Lexer::peek(int k) {
+    while (count <= k) {
+        ring[(head + count) % LOOKAHEAD] = scan();
+        count++;
+    }
+    if (stops != STOP_NONE) {
+        for (int i = 0; i <= k; i++) {
+            const Token &token = ring[(head + i) % LOOKAHEAD];
+            if (isStop(token)) return {TOKEN_END, token.offset, 0};
+        }
+    }
+    return ring[(head + k) % LOOKAHEAD];
+}
+
+Token Lexer::next() {
+    Token token = peek();
+    if (token.kind != TOKEN_END) {
+        head = (head + 1) % LOOKAHEAD;
+        count--;
+    }
+    return token;
+}
+
+bool Lexer::isStop(const Token &token) const {
+    if (token.kind == TOKEN_OPERATOR && (stops & STOP_RELATIONAL)) {
+        char ch = input[token.offset];
+        return ch == '<' || ch == '>' || ch == '=';
+    }
+    if (token.kind == TOKEN_WORD && (stops & STOP_THEN) && token.length == 4) {
+        for (int i = 0; i < 4; i++) {
+            if (toupper((unsigned char) input[token.offset + i]) != "THEN"[i]) return false;
+        }
+        return true;
+    }
+    return false;
+}
+
+/*
+ * Implementation notes: scan
+ * --------------------------
+ * Characters are classified through unsigned char so that bytes
+ * outside the ASCII range behave as they do when they are read from
+ * an istream, which makes them operator tokens.
+ */
+
+Token Lexer::scan() {
+    size_t n = input.size();
+    while (position < n && isspace((unsigned char) input[position])) position++;
+    if (position >= n) return {TOKEN_END, (int) n, 0};
+    size_t start = position;
+    unsigned char ch = input[start];
+    if (isdigit(ch)) {
+        size_t end = scanNumber(start);
+        return {TOKEN_NUMBER, (int) start, (int) (end - start)};
+    }
+    if (isalnum(ch)) {
+        while (position < n && isalnum((unsigned char) input[position])) position++;
+        return {TOKEN_WORD, (int) start, (int) (position - start)};
+    }
+    position++;
+    return {TOKEN_OPERATOR, (int) start, 1};
+}
+
+/*
+ * Implementation notes: scanNumber
+ * --------------------------------
+ * Returns the end of the number that starts at start and sets the
+ * position where scanning continues.  The two usually coincide, but
+ * an exponent marker that is not followed by digits reproduces the
+ * behavior of TokenScanner::scanNumber: the E and its sign remain
+ * part of the number, yet scanning continues at the E, or stops
+ * altogether when the input ends right after them.
+ */
+
+size_t Lexer::scanNumber(size_t start) {
+    size_t n = input.size();
+    size_t i = start + 1;
+    while (i < n && isdigit((unsigned char) input[i])) i++;
+    if (i < n && input[i] == '.') {
+        i++;
+        while (i < n && isdigit((unsigned char) input[i])) i++;
+    }
+    if (i < n && (input[i] == 'E' || input[i] == 'e')) {
+        size_t exponent = i++;
+        if (i < n && (input[i] == '+' || input[i] == '-')) i++;
+        if (i < n && isdigit((unsigned char) input[i])) {
+            while (i < n && isdigit((unsigned char) input[i])) i++;
+        } else {
+            position = (i < n) ? exponent : n;
+            return i;
+        }
+    }
+    position = i;
+    return i;
+}
+
+/*
+ * Implementation notes: tokenToInteger
+ * ------------------------------------
+ * A number token starts with a digit, so the conversion succeeds
+ * exactly when the token consists of digits only and its value fits
+ * in an int.
+ */
+
+bool tokenToInteger(std::string_view str, int &value) {
+    long long result = 0;
+    if (str.empty()) return false;
+    for (char ch : str) {
+        if (!isdigit((unsigned char) ch)) return false;
+        result = result * 10 + (ch - '0');
+        if (result > 2147483647LL) return false;
+    }
+    value = (int) result;
+    return true;
+}
@@ -0,0 +1,192 @@
+/*
+ * File: lexer.h
+ * -------------
+ * This interface exports the Lexer class, which divides a line of
+ * BASIC into tokens without copying it.
+ */
+
+#ifndef _lexer_h
+#define _lexer_h
+
+#include <string_view>
+
+/*
+ * Type: TokenKind
+ * ---------------
+ * The kinds of token produced by the lexer.  TOKEN_END is returned
+ * once the input is exhausted, and on every call after that.
+ */
+
+enum TokenKind {
+    TOKEN_END, TOKEN_WORD, TOKEN_NUMBER, TOKEN_OPERATOR
+};
+
+/*
+ * Type: Token
+ * -----------
+ * A token is described by its kind and by the position and length of
+ * its text within the input of the lexer that produced it.
+ */
+
+struct Token {
+    TokenKind kind;
+    int offset;
+    int length;
+};
+
+/*
+ * Constants: STOP_NONE, STOP_RELATIONAL, STOP_THEN
+ * -----------------------------------------------
+ * Classes of tokens at which the lexer can be told to stop, as if the
+ * input ended there.  STOP_RELATIONAL covers the tokens <, > and =, and
+ * STOP_THEN the keyword THEN in any combination of case.
+ */
+
+enum {
+    STOP_NONE = 0, STOP_RELATIONAL = 1, STOP_THEN = 2
+};
+
+/*
+ * Class: Lexer
+ * ------------
+ * A lexer reads tokens from a string_view, which must stay alive as
+ * long as the lexer and its tokens are in use.  It splits the input
+ * exactly as a TokenScanner configured with ignoreWhitespace and
+ * scanNumbers does:
+ *
+ *   - whitespace separates tokens and is otherwise ignored;
+ *   - a run of letters and digits that starts with a letter is a word;
+ *   - a number starts with a digit and may contain a fraction and an
+ *     exponent, so that 1.5 and 2E+3 are single tokens;
+ *   - every other character is an operator token of its own.
+ *
+ * Tokens are scanned on demand into a small ring buffer, so up to
+ * LOOKAHEAD tokens can be inspected before they are consumed.
+ * TOKEN_END is never consumed; next keeps returning it.
+ */
+
+class Lexer {
+
+public:
+
+    static const int LOOKAHEAD = 4;
+
+/*
+ * Constructor: Lexer
+ * Usage: Lexer lexer(input);
+ * --------------------------
+ * Creates a lexer that reads tokens from input.
+ */
+
+    explicit Lexer(std::string_view input = std::string_view());
+
+/*
+ * Method: setInput
+ * Usage: lexer.setInput(input);
+ * -----------------------------
+ * Restarts the lexer at the beginning of input, discarding any tokens
+ * that have been scanned ahead.
+ */
+
+    void setInput(std::string_view input);
+
+/*
+ * Method: peek
+ * Usage: Token token = lexer.peek();
+ *        Token token = lexer.peek(k);
+ * -----------------------------------
+ * Returns the token k positions ahead of the current one, without
+ * consuming anything.  The argument k must be less than LOOKAHEAD.
+ */
+
+    Token peek(int k = 0);
+
+/*
+ * Method: next
+ * Usage: Token token = lexer.next();
+ * ----------------------------------
+ * Returns and consumes the current token.
+ */
+
+    Token next();
+
+/*
+ * Method: setStops
+ * Usage: lexer.setStops(STOP_RELATIONAL | STOP_THEN);
+ * ---------------------------------------------------
+ * Makes the lexer report TOKEN_END, positioned at the stopping token,
+ * in place of the first token of one of the given classes, so that a
+ * caller can read a part of a line that has no delimiter of its own.
+ * The stopping token becomes visible again when the stops are reset
+ * with STOP_NONE.
+ */
+
+    void setStops(int stops) { this->stops = stops; }
+
+/*
+ * Method: hasMoreTokens
+ * Usage: if (lexer.hasMoreTokens()) ...
+ * -------------------------------------
+ * Returns true if there are tokens left to consume.
+ */
+
+    bool hasMoreTokens() { return peek().kind != TOKEN_END; }
+
+/*
+ * Method: text
+ * Usage: std::string_view str = lexer.text(token);
+ * ------------------------------------------------
+ * Returns the characters of the token.
+ */
+
+    std::string_view text(const Token &token) const {
+        return input.substr(token.offset, token.length);
+    }
+
+/*
+ * Method: rest
+ * Usage: std::string_view str = lexer.rest(token);
+ * ------------------------------------------------
+ * Returns the input from the start of the token to the end.
+ */
+
+    std::string_view rest(const Token &token) const {
+        return input.substr(token.offset);
+    }
+
+/*
+ * Method: getInput
+ * Usage: std::string_view str = lexer.getInput();
+ * -----------------------------------------------
+ * Returns the complete input of the lexer.
+ */
+
+    std::string_view getInput() const { return input; }
+
+private:
+
+    std::string_view input;
+    size_t position;                    /* Where the next scan starts   */
+    Token ring[LOOKAHEAD];              /* Tokens scanned ahead         */
+    int head;                           /* Index of the current token   */
+    int count;                          /* Number of tokens in ring     */
+    int stops;                          /* Classes reported as the end  */
+
+    Token scan();
+    bool isStop(const Token &token) const;
+    size_t scanNumber(size_t start);
+
+};
+
+/*
+ * Function: tokenToInteger
+ * Usage: if (tokenToInteger(str, value)) ...
+ * ------------------------------------------
+ * Converts the text of a number token to an integer and returns true,
+ * or returns false if it is not a plain decimal integer that fits in
+ * an int.
+ */
+
+bool tokenToInteger(std::string_view str, int &value);
+
+#endif
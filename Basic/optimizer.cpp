@@ -0,0 +1,329 @@
+/*
+ * File: optimizer.cpp
+ * -------------------
+ * This file implements the expression optimizer.
+ */
+
+#include <unordered_map>
+#include "optimizer.hpp"
+
+/* Private function prototypes */
+
+static bool isConstant(Expression *exp, int value);
+static bool isNegation(Expression *exp);
+static Expression *negatedExp(Expression *exp);
+static bool cannotFail(Expression *exp);
+static bool foldConstants(Operator op, int lhs, int rhs, int &result);
+static bool containsAssignment(Expression *exp);
+static Expression *simplify(Operator op, Expression *lhs, Expression *rhs, Arena &arena);
+
+/*
+ * Implementation notes: optimizeExp
+ * ---------------------------------
+ * The tree is rewritten bottom-up, so each rule sees operands that
+ * have already been simplified.  A node is rebuilt only when one of
+ * its operands changed; otherwise the original node is returned.
+ * The subscripts of an array element are optimized like any operand.
+ */
+
+Expression *optimizeExp(Expression *exp, Arena &arena) {
+    if (exp->getType() == ARRAY) {
+        auto *element = (ArrayExp *) exp;
+        Expression *subscripts[2] = {element->getSubscript(0), element->getSubscript(1)};
+        bool changed = false;
+        for (int k = 0; k < element->getRank(); k++) {
+            subscripts[k] = optimizeExp(element->getSubscript(k), arena);
+            if (subscripts[k] != element->getSubscript(k)) changed = true;
+        }
+        if (!changed) return exp;
+        return arena.make<ArrayExp>(element->getSlot(), subscripts[0], subscripts[1]);
+    }
+    if (exp->getType() != COMPOUND) return exp;
+    auto *compound = (CompoundExp *) exp;
+    Operator op = compound->getOperator();
+    Expression *lhs = compound->getLHS();
+    Expression *rhs = optimizeExp(compound->getRHS(), arena);
+    if (op == ASSIGN_OP) {
+        if (rhs == compound->getRHS()) return exp;
+        return arena.make<CompoundExp>(op, lhs, rhs);
+    }
+    lhs = optimizeExp(lhs, arena);
+    Expression *result = simplify(op, lhs, rhs, arena);
+    if (result != nullptr) return result;
+    if (lhs == compound->getLHS() && rhs == compound->getRHS()) return exp;
+    return arena.make<CompoundExp>(op, lhs, rhs);
+}
+
+/*
+ * Implementation notes: simplify
+ * ------------------------------
+ * Returns the simplified form of lhs op rhs, or NULL if no rule
+ * applies.  Every rule keeps the evaluation order of the operands
+ * that remain, so errors are raised in the original order.
+ */
+
+static Expression *simplify(Operator op, Expression *lhs, Expression *rhs, Arena &arena) {
+    int value;
+    if (lhs->getType() == CONSTANT && rhs->getType() == CONSTANT
+        && foldConstants(op, ((ConstantExp *) lhs)->getValue(), ((ConstantExp *) rhs)->getValue(), value)) {
+        return arena.make<ConstantExp>(value);
+    }
+    switch (op) {
+        case ADD_OP:
+            if (isConstant(rhs, 0)) return lhs;
+            if (isConstant(lhs, 0)) return rhs;
+            if (isNegation(rhs)) return arena.make<CompoundExp>(SUB_OP, lhs, negatedExp(rhs));
+            break;
+        case SUB_OP:
+            if (isConstant(rhs, 0)) return lhs;
+            if (isNegation(rhs)) {
+                if (isConstant(lhs, 0)) return negatedExp(rhs);
+                return arena.make<CompoundExp>(ADD_OP, lhs, negatedExp(rhs));
+            }
+            break;
+        case MUL_OP:
+            if (isConstant(rhs, 1)) return lhs;
+            if (isConstant(lhs, 1)) return rhs;
+            if (isConstant(rhs, 0) && cannotFail(lhs)) return rhs;
+            if (isConstant(lhs, 0) && cannotFail(rhs)) return lhs;
+            if (isNegation(lhs) && isNegation(rhs)) {
+                return arena.make<CompoundExp>(MUL_OP, negatedExp(lhs), negatedExp(rhs));
+            }
+            break;
+        case DIV_OP:
+            if (isConstant(rhs, 1)) return lhs;
+            break;
+        default:
+            break;
+    }
+    return nullptr;
+}
+
+/*
+ * Implementation notes: foldConstants
+ * -----------------------------------
+ * Arithmetic wraps around exactly as it does at run time, where
+ * INT_MIN / -1 is INT_MIN.  Divisions by zero are not folded so that
+ * they still fail when the statement executes.
+ */
+
+static bool foldConstants(Operator op, int lhs, int rhs, int &result) {
+    switch (op) {
+        case ADD_OP: result = (int) ((unsigned) lhs + (unsigned) rhs); return true;
+        case SUB_OP: result = (int) ((unsigned) lhs - (unsigned) rhs); return true;
+        case MUL_OP: result = (int) ((unsigned) lhs * (unsigned) rhs); return true;
+        case DIV_OP:
+            if (rhs == 0) return false;
+            result = (rhs == -1) ? (int) (0u - (unsigned) lhs) : lhs / rhs;
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool isConstant(Expression *exp, int value) {
+    return exp->getType() == CONSTANT && ((ConstantExp *) exp)->getValue() == value;
+}
+
+/*
+ * Implementation notes: isNegation, negatedExp
+ * --------------------------------------------
+ * The parser represents unary minus as 0 - e.  These functions
+ * recognize that form and extract e from it.
+ */
+
+static bool isNegation(Expression *exp) {
+    if (exp->getType() != COMPOUND) return false;
+    auto *compound = (CompoundExp *) exp;
+    return compound->getOperator() == SUB_OP && isConstant(compound->getLHS(), 0);
+}
+
+static Expression *negatedExp(Expression *exp) {
+    return ((CompoundExp *) exp)->getRHS();
+}
+
+/*
+ * Implementation notes: cannotFail
+ * --------------------------------
+ * Returns true only for expressions that neither raise an error nor
+ * assign a variable, which are the ones that may be dropped entirely.
+ * Any variable reference might be undefined and any subscript out of
+ * range, so in practice these are expressions built from constants
+ * and safe divisions.
+ */
+
+static bool cannotFail(Expression *exp) {
+    switch (exp->getType()) {
+        case CONSTANT: return true;
+        case IDENTIFIER: return false;
+        case ARRAY: return false;
+        case COMPOUND: break;
+    }
+    auto *compound = (CompoundExp *) exp;
+    Operator op = compound->getOperator();
+    if (op == ASSIGN_OP) return false;
+    if (op == DIV_OP && !(compound->getRHS()->getType() == CONSTANT
+                          && !isConstant(compound->getRHS(), 0) && !isConstant(compound->getRHS(), -1))) {
+        return false;
+    }
+    return cannotFail(compound->getLHS()) && cannotFail(compound->getRHS());
+}
+
+static bool containsAssignment(Expression *exp) {
+    if (exp->getType() == ARRAY) {
+        auto *element = (ArrayExp *) exp;
+        for (int k = 0; k < element->getRank(); k++) {
+            if (containsAssignment(element->getSubscript(k))) return true;
+        }
+        return false;
+    }
+    if (exp->getType() != COMPOUND) return false;
+    auto *compound = (CompoundExp *) exp;
+    return compound->getOperator() == ASSIGN_OP
+           || containsAssignment(compound->getLHS()) || containsAssignment(compound->getRHS());
+}
+
+/*
+ * Class: Sharer
+ * -------------
+ * Replaces structurally equal subexpressions by a single node.  Leaves
+ * are made canonical first, so two compound nodes are equal exactly
+ * when they have the same operator and the same operand pointers.
+ * Because the expressions are visited in evaluation order, the node
+ * that is kept is the one that is evaluated first.  Array elements
+ * are never merged, but their subscripts take part like operands.
+ */
+
+class Sharer {
+
+public:
+
+    explicit Sharer(Arena &arena) : arena(arena) {}
+
+    Expression *share(Expression *exp);
+
+private:
+
+    struct Key {
+        Operator op;
+        Expression *lhs, *rhs;
+
+        bool operator==(const Key &other) const {
+            return op == other.op && lhs == other.lhs && rhs == other.rhs;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key &key) const {
+            size_t h = std::hash<const void *>()(key.lhs);
+            h = h * 31 + std::hash<const void *>()(key.rhs);
+            return h * 31 + (size_t) key.op;
+        }
+    };
+
+    Arena &arena;
+    std::unordered_map<int, Expression *> constants;
+    std::unordered_map<int, Expression *> identifiers;
+    std::unordered_map<Key, Expression *, KeyHash> compounds;
+
+};
+
+Expression *Sharer::share(Expression *exp) {
+    switch (exp->getType()) {
+        case CONSTANT:
+            return constants.emplace(((ConstantExp *) exp)->getValue(), exp).first->second;
+        case IDENTIFIER:
+            return identifiers.emplace(((IdentifierExp *) exp)->getSlot(), exp).first->second;
+        case ARRAY: {
+            auto *element = (ArrayExp *) exp;
+            Expression *row = share(element->getSubscript(0));
+            Expression *column = (element->getRank() == 2) ? share(element->getSubscript(1)) : nullptr;
+            if (row == element->getSubscript(0) && column == element->getSubscript(1)) return exp;
+            return arena.make<ArrayExp>(element->getSlot(), row, column);
+        }
+        case COMPOUND:
+            break;
+    }
+    auto *compound = (CompoundExp *) exp;
+    Expression *lhs = share(compound->getLHS());
+    Expression *rhs = share(compound->getRHS());
+    Key key = {compound->getOperator(), lhs, rhs};
+    auto it = compounds.find(key);
+    if (it != compounds.end()) return it->second;
+    if (lhs != compound->getLHS() || rhs != compound->getRHS()) {
+        exp = arena.make<CompoundExp>(compound->getOperator(), lhs, rhs);
+    }
+    compounds.emplace(key, exp);
+    return exp;
+}
+
+/*
+ * Implementation notes: optimizeStatement
+ * ---------------------------------------
+ * The subscripts of an element that is assigned or read are
+ * optimized like the value, and so are the bounds of a DIM, since
+ * the bounds analysis can only remove the checks of subscripts it
+ * knows.  One Sharer visits the expressions of a statement in the
+ * order they are evaluated and skips every expression that contains
+ * an assignment, so that no node is shared across a change to a
+ * variable it reads.
+ */
+
+void optimizeStatement(Statement *stmt, Arena &arena) {
+    switch (stmt->getType()) {
+        case LET_STMT: {
+            auto *let = (LetStatement *) stmt;
+            Sharer sharer(arena);
+            if (let->getElement() != nullptr) {
+                let->setElement((ArrayExp *) optimizeExp(let->getElement(), arena));
+                if (!containsAssignment(let->getElement())) {
+                    let->setElement((ArrayExp *) sharer.share(let->getElement()));
+                }
+            }
+            let->setExp(optimizeExp(let->getExp(), arena));
+            if (!containsAssignment(let->getExp())) let->setExp(sharer.share(let->getExp()));
+            break;
+        }
+        case PRINT_STMT: {
+            auto *print = (PrintStatement *) stmt;
+            print->setExp(optimizeExp(print->getExp(), arena));
+            if (!containsAssignment(print->getExp())) {
+                Sharer sharer(arena);
+                print->setExp(sharer.share(print->getExp()));
+            }
+            break;
+        }
+        case IF_STMT: {
+            auto *ifStmt = (IfStatement *) stmt;
+            ifStmt->setLHS(optimizeExp(ifStmt->getLHS(), arena));
+            ifStmt->setRHS(optimizeExp(ifStmt->getRHS(), arena));
+            if (!containsAssignment(ifStmt->getLHS()) && !containsAssignment(ifStmt->getRHS())) {
+                Sharer sharer(arena);
+                ifStmt->setLHS(sharer.share(ifStmt->getLHS()));
+                ifStmt->setRHS(sharer.share(ifStmt->getRHS()));
+            }
+            break;
+        }
+        case INPUT_STMT: {
+            auto *input = (InputStatement *) stmt;
+            if (input->getElement() == nullptr) break;
+            input->setElement((ArrayExp *) optimizeExp(input->getElement(), arena));
+            if (!containsAssignment(input->getElement())) {
+                Sharer sharer(arena);
+                input->setElement((ArrayExp *) sharer.share(input->getElement()));
+            }
+            break;
+        }
+        case DIM_STMT: {
+            auto *dim = (DimStatement *) stmt;
+            Sharer sharer(arena);
+            for (int k = 0; k < dim->getRank(); k++) {
+                dim->setBound(k, optimizeExp(dim->getBound(k), arena));
+                if (!containsAssignment(dim->getBound(k))) dim->setBound(k, sharer.share(dim->getBound(k)));
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
@@ -0,0 +1,45 @@
+/*
+ * File: optimizer.h
+ * -----------------
+ * This interface exports the expression optimizer that is applied to
+ * every statement stored in a program.
+ */
+
+#ifndef _optimizer_h
+#define _optimizer_h
+
+#include "arena.hpp"
+#include "exp.hpp"
+#include "statement.hpp"
+
+/*
+ * Function: optimizeStatement
+ * Usage: optimizeStatement(stmt, arena);
+ * --------------------------------------
+ * Rewrites the expressions of stmt into cheaper equivalent forms.
+ * Constant subexpressions are folded, the identities x + 0, x - 0,
+ * x * 1 and x / 1 are removed, x * 0 becomes 0 when x cannot raise an
+ * error, and negations written as 0 - e are combined with the
+ * surrounding operators.  If the statement contains no assignment,
+ * repeated subexpressions are then shared, so that the expression
+ * trees of the statement may become a DAG.
+ *
+ * The rewritten statement raises the same errors, in the same order,
+ * as the original: divisions that would fail are never folded and the
+ * target of an assignment is left untouched.  New nodes are allocated
+ * in arena, which must be the arena holding stmt.
+ */
+
+void optimizeStatement(Statement *stmt, Arena &arena);
+
+/*
+ * Function: optimizeExp
+ * Usage: exp = optimizeExp(exp, arena);
+ * -------------------------------------
+ * Applies the folding and simplification rules of optimizeStatement
+ * to a single expression and returns the result.
+ */
+
+Expression *optimizeExp(Expression *exp, Arena &arena);
+
+#endif
@@ -4,8 +4,234 @@
  * Implements the parser.h interface.
  */
 
+#include <cctype>
 #include "parser.hpp"
+#include "keyword.hpp"
+#include "statement.hpp"
 
+/* Private function prototypes */
+
+static Statement *parseLet(Lexer &lexer, Arena &arena, Failure &failure);
+static Statement *parseIf(Lexer &lexer, Arena &arena, Failure &failure);
+static Statement *parseDim(Lexer &lexer, Arena &arena, Failure &failure);
+static bool readSubscripts(Lexer &lexer, Arena &arena, Failure &failure, Expression *subscripts[]);
+static bool isElement(Lexer &lexer, Token name);
+static Expression *readOperand(Lexer &lexer, Arena &arena, Failure &failure);
+static bool readTarget(Lexer &lexer, int &target, Failure &failure);
+static bool isNumberToken(std::string_view tok);
+static std::nullptr_t fail(Failure &failure, Status status, std::string_view token = std::string_view());
+
+/*
+ * Implementation notes: parseStatement
+ * ------------------------------------
+ * The keyword selects the statement.  Tokens that follow a complete
+ * INPUT, END or GOTO statement are ignored.  A name followed by an
+ * opening parenthesis is an array element wherever a variable may
+ * appear.  The text of a REM statement is taken from the line itself,
+ * starting one space after the keyword.
+ */
+
+Statement *parseStatement(Lexer &lexer, Arena &arena, Failure &failure) {
+    if (!lexer.hasMoreTokens()) return arena.make<RemStatement>("");
+    Token keywordToken = lexer.next();
+    switch (lookupKeyword(lexer.text(keywordToken))) {
+        case KEYWORD_REM: {
+            size_t after = keywordToken.offset + keywordToken.length;
+            std::string_view line = lexer.getInput();
+            if (after < line.size() && line[after] == ' ') after++;
+            return arena.make<RemStatement>(arena.copyString(line.substr(std::min(after, line.size()))));
+        }
+        case KEYWORD_LET:
+            return parseLet(lexer, arena, failure);
+        case KEYWORD_PRINT: {
+            Expression *exp = parseExp(lexer, arena, failure);
+            if (exp == nullptr) return nullptr;
+            return arena.make<PrintStatement>(exp);
+        }
+        case KEYWORD_INPUT: {
+            if (!lexer.hasMoreTokens()) return fail(failure, STATUS_SYNTAX_ERROR);
+            Token var = lexer.next();
+            std::string name(lexer.text(var));
+            if (!isElement(lexer, var)) return arena.make<InputStatement>(name);
+            Expression *subscripts[2];
+            if (!readSubscripts(lexer, arena, failure, subscripts)) return nullptr;
+            ArrayExp *element = arena.make<ArrayExp>(SymbolTable::intern(name), subscripts[0], subscripts[1]);
+            return arena.make<InputStatement>(element, isReservedKeyword(lookupKeyword(name)));
+        }
+        case KEYWORD_END:
+            return arena.make<EndStatement>();
+        case KEYWORD_GOTO: {
+            int target;
+            if (!readTarget(lexer, target, failure)) return nullptr;
+            return arena.make<GotoStatement>(target);
+        }
+        case KEYWORD_IF:
+            return parseIf(lexer, arena, failure);
+        case KEYWORD_DIM:
+            return parseDim(lexer, arena, failure);
+        default:
+            return fail(failure, STATUS_SYNTAX_ERROR);
+    }
+}
+
+static Statement *parseLet(Lexer &lexer, Arena &arena, Failure &failure) {
+    if (!lexer.hasMoreTokens()) return fail(failure, STATUS_SYNTAX_ERROR);
+    Token var = lexer.next();
+    std::string name(lexer.text(var));
+    Expression *subscripts[2];
+    bool element = isElement(lexer, var);
+    if (element && !readSubscripts(lexer, arena, failure, subscripts)) return nullptr;
+    if (lexer.text(lexer.next()) != "=") return fail(failure, STATUS_SYNTAX_ERROR);
+    Expression *exp = parseExp(lexer, arena, failure);
+    if (exp == nullptr) return nullptr;
+    if (!element) return arena.make<LetStatement>(name, exp);
+    ArrayExp *target = arena.make<ArrayExp>(SymbolTable::intern(name), subscripts[0], subscripts[1]);
+    return arena.make<LetStatement>(target, exp, isReservedKeyword(lookupKeyword(name)));
+}
+
+/*
+ * Implementation notes: parseDim
+ * ------------------------------
+ * The statement has the form DIM name(n) or DIM name(n, m), with the
+ * bounds written where the subscripts of an element would be, and
+ * declares a single array.
+ */
+
+static Statement *parseDim(Lexer &lexer, Arena &arena, Failure &failure) {
+    Token var = lexer.next();
+    if (!isElement(lexer, var)) return fail(failure, STATUS_SYNTAX_ERROR);
+    Expression *bounds[2];
+    if (!readSubscripts(lexer, arena, failure, bounds)) return nullptr;
+    if (lexer.hasMoreTokens()) return fail(failure, STATUS_EXTRA_TOKEN, lexer.text(lexer.peek()));
+    return arena.make<DimStatement>(SymbolTable::intern(std::string(lexer.text(var))), bounds[0], bounds[1]);
+}
+
+/*
+ * Implementation notes: readSubscripts
+ * ------------------------------------
+ * Reads the parenthesized list of one or two expressions that follows
+ * the name of an array, leaving the second entry of subscripts NULL
+ * if there is only one.
+ */
+
+static bool readSubscripts(Lexer &lexer, Arena &arena, Failure &failure, Expression *subscripts[]) {
+    lexer.next();
+    subscripts[0] = readE(lexer, arena, failure);
+    subscripts[1] = nullptr;
+    if (subscripts[0] == nullptr) return false;
+    if (lexer.text(lexer.peek()) == ",") {
+        lexer.next();
+        subscripts[1] = readE(lexer, arena, failure);
+        if (subscripts[1] == nullptr) return false;
+    }
+    if (lexer.text(lexer.next()) != ")") {
+        fail(failure, STATUS_UNBALANCED_PARENTHESES);
+        return false;
+    }
+    return true;
+}
+
+static bool isElement(Lexer &lexer, Token name) {
+    return name.kind == TOKEN_WORD && lexer.text(lexer.peek()) == "(";
+}
+
+/*
+ * Implementation notes: parseIf
+ * -----------------------------
+ * The statement has the form IF lhs op rhs THEN n, where op is the
+ * first <, >, =, <>, <= or >= before THEN; an = after op is an
+ * assignment within rhs.  The left operand is read with the lexer
+ * stopping at relational operators and THEN, the right operand with
+ * it stopping at THEN only.
+ *
+ * The original parser collected the tokens up to THEN and checked
+ * THEN, the target, the operator and the presence of both operands
+ * before it parsed either operand.  To report the same error for
+ * malformed statements, failures found while reading the operands are
+ * held back in lhsFailure and rhsFailure and reported only after the
+ * checks that used to come first.
+ */
+
+static Statement *parseIf(Lexer &lexer, Arena &arena, Failure &failure) {
+    Failure lhsFailure, rhsFailure;
+    lexer.setStops(STOP_RELATIONAL | STOP_THEN);
+    bool hasLHS = lexer.hasMoreTokens();
+    Expression *lhs = readOperand(lexer, arena, lhsFailure);
+    lexer.setStops(STOP_NONE);
+    std::string op(lexer.text(lexer.peek()));
+    bool hasOp = (op == "<" || op == ">" || op == "=");
+    bool hasRHS = false;
+    Expression *rhs = nullptr;
+    if (hasOp) {
+        lexer.next();
+        std::string_view second = lexer.text(lexer.peek());
+        if ((op == "<" && second == ">") || (op != "=" && second == "=")) {
+            op += second;
+            lexer.next();
+        }
+        lexer.setStops(STOP_THEN);
+        hasRHS = lexer.hasMoreTokens();
+        rhs = readOperand(lexer, arena, rhsFailure);
+        lexer.setStops(STOP_NONE);
+    }
+    if (lookupKeyword(lexer.text(lexer.next())) != KEYWORD_THEN) return fail(failure, STATUS_SYNTAX_ERROR);
+    int target;
+    if (!readTarget(lexer, target, failure)) return nullptr;
+    if (!hasOp || !hasLHS || !hasRHS) return fail(failure, STATUS_SYNTAX_ERROR);
+    if (lhs == nullptr) return fail(failure, lhsFailure.status, lhsFailure.token);
+    if (rhs == nullptr) return fail(failure, rhsFailure.status, rhsFailure.token);
+    return arena.make<IfStatement>(lhs, op, rhs, target);
+}
+
+/*
+ * Implementation notes: readOperand
+ * ---------------------------------
+ * Reads an expression that must extend to the point where the lexer
+ * stops.  If it is malformed, the reason is stored in failure, the
+ * rest of the operand is skipped and the result is NULL.
+ */
+
+static Expression *readOperand(Lexer &lexer, Arena &arena, Failure &failure) {
+    Expression *exp = readE(lexer, arena, failure);
+    if (exp != nullptr && lexer.hasMoreTokens()) exp = fail(failure, STATUS_SYNTAX_ERROR);
+    if (exp == nullptr) {
+        while (lexer.hasMoreTokens()) lexer.next();
+    }
+    return exp;
+}
+
+static bool readTarget(Lexer &lexer, int &target, Failure &failure) {
+    std::string_view text;
+    if (lexer.hasMoreTokens()) text = lexer.text(lexer.next());
+    if (!isNumberToken(text)) {
+        fail(failure, STATUS_SYNTAX_ERROR);
+        return false;
+    }
+    if (!tokenToInteger(text, target)) {
+        fail(failure, STATUS_ILLEGAL_INTEGER, text);
+        return false;
+    }
+    return true;
+}
+
+static bool isNumberToken(std::string_view tok) {
+    if (tok.empty()) return false;
+    for (char c : tok) if (!std::isdigit(static_cast<unsigned char>(c)) && !(c=='-'||c=='+')) return false;
+    return true;
+}
+
+/*
+ * Implementation notes: fail
+ * --------------------------
+ * Records the reason a parse failed and returns NULL, which every
+ * parsing function returns on failure.
+ */
+
+static std::nullptr_t fail(Failure &failure, Status status, std::string_view token) {
+    failure.status = status;
+    failure.token = token;
+    return nullptr;
+}
 
 /*
  * Implementation notes: parseExp
@@ -13,36 +239,39 @@
  * This code just reads an expression and then checks for extra tokens.
  */
 
-Expression *parseExp(TokenScanner &scanner) {
-    Expression *exp = readE(scanner);
-    if (scanner.hasMoreTokens()) {
-        error("parseExp: Found extra token: " + scanner.nextToken());
+Expression *parseExp(Lexer &lexer, Arena &arena, Failure &failure) {
+    Expression *exp = readE(lexer, arena, failure);
+    if (exp != nullptr && lexer.hasMoreTokens()) {
+        return fail(failure, STATUS_EXTRA_TOKEN, lexer.text(lexer.peek()));
     }
     return exp;
 }
 
 /*
  * Implementation notes: readE
- * Usage: exp = readE(scanner, prec);
- * ----------------------------------
+ * Usage: exp = readE(lexer, arena, failure, prec);
+ * ------------------------------------------------
  * This version of readE uses precedence to resolve the ambiguity in
  * the grammar.  At each recursive level, the parser reads operators and
  * subexpressions until it finds an operator whose precedence is greater
  * than the prevailing one.  When a higher-precedence operator is found,
  * readE calls itself recursively to read in that subexpression as a unit.
+ * The operator that ends the expression is only peeked at, so it is
+ * still available to the caller.
  */
 
-Expression *readE(TokenScanner &scanner, int prec) {
-    Expression *exp = readT(scanner);
-    std::string token;
+Expression *readE(Lexer &lexer, Arena &arena, Failure &failure, int prec) {
+    Expression *exp = readT(lexer, arena, failure);
+    if (exp == nullptr) return nullptr;
     while (true) {
-        token = scanner.nextToken();
+        std::string_view token = lexer.text(lexer.peek());
         int newPrec = precedence(token);
         if (newPrec <= prec) break;
-        Expression *rhs = readE(scanner, newPrec);
-        exp = new CompoundExp(token, exp, rhs);
+        lexer.next();
+        Expression *rhs = readE(lexer, arena, failure, newPrec);
+        if (rhs == nullptr) return nullptr;
+        exp = arena.make<CompoundExp>(toOperator(token), exp, rhs);
     }
-    scanner.saveToken(token);
     return exp;
 }
 
@@ -50,20 +279,32 @@ Expression *readE(TokenScanner &scanner, int prec) {
  * Implementation notes: readT
  * ---------------------------
  * This function scans a term, which is either an integer, an identifier,
- * or a parenthesized subexpression.
+ * an array element, or a parenthesized subexpression.
  */
 
-Expression *readT(TokenScanner &scanner) {
-    std::string token = scanner.nextToken();
-    TokenType type = scanner.getTokenType(token);
-    if (type == WORD) return new IdentifierExp(token);
-    if (type == NUMBER) return new ConstantExp(stringToInteger(token));
-    if (token == "-") return new CompoundExp(token, new ConstantExp(0), readE(scanner));
-    if (token != "(") error("Illegal term in expression");
-    Expression *exp = readE(scanner);
-    if (scanner.nextToken() != ")") {
-        error("Unbalanced parentheses in expression");
+Expression *readT(Lexer &lexer, Arena &arena, Failure &failure) {
+    Token token = lexer.next();
+    std::string_view text = lexer.text(token);
+    if (isElement(lexer, token)) {
+        Expression *subscripts[2];
+        if (!readSubscripts(lexer, arena, failure, subscripts)) return nullptr;
+        return arena.make<ArrayExp>(SymbolTable::intern(std::string(text)), subscripts[0], subscripts[1]);
+    }
+    if (token.kind == TOKEN_WORD) return arena.make<IdentifierExp>(std::string(text));
+    if (token.kind == TOKEN_NUMBER) {
+        int value;
+        if (!tokenToInteger(text, value)) return fail(failure, STATUS_ILLEGAL_INTEGER, text);
+        return arena.make<ConstantExp>(value);
+    }
+    if (text == "-") {
+        Expression *operand = readE(lexer, arena, failure);
+        if (operand == nullptr) return nullptr;
+        return arena.make<CompoundExp>(SUB_OP, arena.make<ConstantExp>(0), operand);
     }
+    if (text != "(") return fail(failure, STATUS_ILLEGAL_TERM);
+    Expression *exp = readE(lexer, arena, failure);
+    if (exp == nullptr) return nullptr;
+    if (lexer.text(lexer.next()) != ")") return fail(failure, STATUS_UNBALANCED_PARENTHESES);
     return exp;
 }
 
@@ -74,7 +315,7 @@ Expression *readT(TokenScanner &scanner) {
  * and returns the appropriate precedence value.
  */
 
-int precedence(std::string token) {
+int precedence(std::string_view token) {
     if (token == "=") return 1;
     if (token == "+" || token == "-") return 2;
     if (token == "*" || token == "/") return 3;
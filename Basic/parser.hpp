@@ -8,45 +8,65 @@
 #define _parser_h
 
 #include <string>
-#include <iostream>
+#include <string_view>
+#include "arena.hpp"
 #include "exp.hpp"
+#include "lexer.hpp"
+#include "status.hpp"
 
-#include "Utils/tokenScanner.hpp"
 #include "Utils/error.hpp"
 #include "Utils/strlib.hpp"
 
+class Statement;
+
+/*
+ * Function: parseStatement
+ * Usage: Statement *stmt = parseStatement(lexer, arena, failure);
+ * ---------------------------------------------------------------
+ * Parses a statement, starting with its keyword, from the remaining
+ * tokens of the lexer.  The tokens are read once, from left to right,
+ * and the statement and its expressions are allocated in arena.  If no
+ * tokens remain, the result is an empty REM statement.  For a malformed
+ * statement the result is NULL and failure holds the same error as the
+ * parser has always reported; a statement with several defects reports
+ * the one that the original parser checked first.  The same convention
+ * holds for the other functions of this interface.
+ */
+
+Statement *parseStatement(Lexer &lexer, Arena &arena, Failure &failure);
+
 
 /*
  * Function: parseExp
- * Usage: Expression *exp = parseExp(scanner);
- * -------------------------------------------
- * Parses an expression by reading tokens from the scanner, which must
- * be provided by the client.  The scanner should be set to ignore
- * whitespace and to scan numbers.
+ * Usage: Expression *exp = parseExp(lexer, arena, failure);
+ * ---------------------------------------------------------
+ * Parses an expression by reading tokens from the lexer, which must
+ * be provided by the client.  The nodes of the expression are
+ * allocated in arena.
  */
 
-Expression *parseExp(TokenScanner &scanner);
+Expression *parseExp(Lexer &lexer, Arena &arena, Failure &failure);
 
 /*
  * Function: readE
- * Usage: Expression *exp = readE(scanner, prec);
- * ----------------------------------------------
- * Returns the next expression from the scanner involving only operators
+ * Usage: Expression *exp = readE(lexer, arena, failure, prec);
+ * -------------------------------------------------------------
+ * Returns the next expression from the lexer involving only operators
  * whose precedence is at least prec.  The prec argument is optional and
  * defaults to 0, which means that the function reads the entire expression.
  */
 
-Expression *readE(TokenScanner &scanner, int prec = 0);
+Expression *readE(Lexer &lexer, Arena &arena, Failure &failure, int prec = 0);
 
 /*
  * Function: readT
- * Usage: Expression *exp = readT(scanner);
- * ----------------------------------------
+ * Usage: Expression *exp = readT(lexer, arena, failure);
+ * -------------------------------------------------------
  * Returns the next individual term, which is either a constant, an
  * identifier, or a parenthesized subexpression.
  */
 
-Expression *readT(TokenScanner &scanner);
+Expression *readT(Lexer &lexer, Arena &arena, Failure &failure);
 
 /*
  * Function: precedence
@@ -56,6 +76,6 @@ Expression *readT(TokenScanner &scanner);
  * is not an operator, precedence returns 0.
  */
 
-int precedence(std::string token);
+int precedence(std::string_view token);
 
 #endif
@@ -0,0 +1,215 @@
+/*
+ * File: profiler.cpp
+ * ------------------
+ * This file implements the per-line execution profiler.
+ */
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "profiler.hpp"
+#include "io.hpp"
+#include "Utils/error.hpp"
+
+/* Constants */
+
+static const long SAMPLE_INTERVAL_NS = 1000000;
+
+/*
+ * Implementation notes: sampling
+ * ------------------------------
+ * Sampling uses a timer on the CPU time of the thread that runs the
+ * program, which sends SIGPROF to that thread alone after each
+ * interval.  Sessions may run side by side on a pool of threads, so
+ * the published position and the array of sample counts are thread
+ * local, and each profile has a timer of its own.  The handler only
+ * increments the sample count of the instruction that the virtual
+ * machine published last, which is where a straight-line run of
+ * instructions starts.  stop shares each sample equally among the
+ * instructions of the run, which ends at the next jump of any kind,
+ * and adds the shares up by line.
+ *
+ * The handler is installed once and never removed.  A signal that is
+ * still pending when a profile stops finds no counts and is ignored,
+ * whereas restoring the default action would let it end the process.
+ */
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+static thread_local const Instruction *sampleBase = nullptr;
+static thread_local long long *volatile sampleCounts = nullptr;
+
+void Profile::takeSample(int signal) {
+    (void) signal;
+    long long *counts = sampleCounts;
+    const Instruction *at = position;
+    if (counts != nullptr && at != nullptr) counts[at - sampleBase]++;
+}
+
+void Profile::installSampler() {
+    static const bool installed = [] {
+        struct sigaction action = {};
+        action.sa_handler = takeSample;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        return sigaction(SIGPROF, &action, nullptr) == 0;
+    }();
+    (void) installed;
+}
+
+static long long clockNanos(clockid_t clock) {
+    timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+Profile::~Profile() {
+    if (running) stop();
+}
+
+/*
+ * Implementation notes: start, stop
+ * ---------------------------------
+ * Position nLines of the per-line arrays stands for the time outside
+ * the lines of the program, before the first line starts and after
+ * the run ends.  Cycles are converted to time by comparing the cycle
+ * counter with the monotonic clock over the whole run.  Samples are
+ * converted by sharing the CPU time of the thread during the run
+ * among them, since the timer may fire less often than requested.
+ * If no timer can be created, the run simply collects no samples.
+ */
+
+void Profile::start(const Bytecode &bytecode) {
+    int nLines = (int) bytecode.lineStarts.size() - 1;
+    lineStarts = bytecode.lineStarts;
+    counts.assign(nLines + 1, 0);
+    units.assign(nLines + 1, 0);
+    nanosPerUnit = 0;
+    running = true;
+    if (mode == PROFILE_EXACT) {
+        currentLine = nLines;
+        nanosStart = clockNanos(CLOCK_MONOTONIC);
+        runStart = lineStart = readClock();
+    } else {
+        int nCode = (int) bytecode.code.size();
+        samples.assign(nCode, 0);
+        runEnds.resize(nCode);
+        for (int i = nCode - 1; i >= 0; i--) {
+            Opcode op = bytecode.code[i].op;
+            bool ends = (op >= OP_JUMP && op <= OP_JUMP_GE) || op == OP_END || op == OP_FAIL
+                        || i == nCode - 1;
+            runEnds[i] = ends ? i : runEnds[i + 1];
+        }
+        position = nullptr;
+        sampleBase = bytecode.code.data();
+        sampleCounts = samples.data();
+        nanosStart = clockNanos(CLOCK_THREAD_CPUTIME_ID);
+        installSampler();
+        sigevent event = {};
+        event.sigev_notify = SIGEV_THREAD_ID;
+        event.sigev_signo = SIGPROF;
+        event.sigev_notify_thread_id = (pid_t) syscall(SYS_gettid);
+        if (timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &timer) == 0) {
+            itimerspec interval = {{0, SAMPLE_INTERVAL_NS}, {0, SAMPLE_INTERVAL_NS}};
+            timer_settime(timer, 0, &interval, nullptr);
+        } else {
+            sampleCounts = nullptr;
+        }
+    }
+}
+
+void Profile::stop() {
+    int outside = (int) counts.size() - 1;
+    long long total = 0, nanos = 0;
+    if (mode == PROFILE_EXACT) {
+        enterLine(outside);
+        counts[outside]--;
+        total = lineStart - runStart;
+        nanos = clockNanos(CLOCK_MONOTONIC) - nanosStart;
+    } else {
+        if (sampleCounts != nullptr) timer_delete(timer);
+        sampleCounts = nullptr;
+        position = nullptr;
+        for (int i = 0; i < (int) samples.size(); i++) {
+            if (samples[i] == 0) continue;
+            int line = (int) (std::upper_bound(lineStarts.begin(), lineStarts.end(), i) - lineStarts.begin()) - 1;
+            line = std::max(line, 0);
+            for (int j = i; j <= runEnds[i]; j++) {
+                while (line < outside && lineStarts[line + 1] <= j) line++;
+                units[line] += samples[i];
+            }
+            total += samples[i] * (runEnds[i] - i + 1);
+        }
+        nanos = clockNanos(CLOCK_THREAD_CPUTIME_ID) - nanosStart;
+    }
+    if (total > 0) nanosPerUnit = (double) nanos / total;
+    running = false;
+}
+
+/*
+ * Implementation notes: report
+ * ----------------------------
+ * Lines are ordered by time, then by execution count, then by line
+ * number, so that the report of a deterministic run is stable apart
+ * from the times themselves.  The total includes only the time spent
+ * in lines of the program.  Sampled runs have no counts, so they list
+ * the lines that were sampled at least once.
+ */
+
+void Profile::report(Program &program) {
+    int nLines = (int) counts.size() - 1;
+    std::vector<int> order;
+    long long totalCount = 0;
+    double totalTime = 0;
+    for (int i = 0; i < nLines; i++) {
+        totalCount += counts[i];
+        totalTime += lineTime(i);
+        if (counts[i] > 0 || units[i] > 0) order.push_back(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+        if (lineTime(a) != lineTime(b)) return lineTime(a) > lineTime(b);
+        return counts[a] > counts[b];
+    });
+    char buffer[96];
+    if (mode == PROFILE_SAMPLE) {
+        long long nSamples = 0;
+        for (long long n : samples) nSamples += n;
+        std::snprintf(buffer, sizeof buffer, "PROFILE (%lld samples of CPU time)", nSamples);
+        writeLine(buffer);
+    }
+    writeLine("  LINE        COUNT    TIME (ms)       %  SOURCE");
+    for (int i : order) {
+        double share = (totalTime == 0) ? 0.0 : 100.0 * lineTime(i) / totalTime;
+        int lineNumber = program.getLineNumberAt(i);
+        std::snprintf(buffer, sizeof buffer, "%6d %12s %12.3f %7.1f  ",
+                      lineNumber, countText(i).c_str(), lineTime(i) / 1e6, share);
+        writeString(buffer);
+        writeLine(program.getSourceLineAt(i));
+    }
+    std::snprintf(buffer, sizeof buffer, " TOTAL %12s %12.3f %7.1f",
+                  (mode == PROFILE_EXACT) ? std::to_string(totalCount).c_str() : "-",
+                  totalTime / 1e6, totalTime == 0 ? 0.0 : 100.0);
+    writeLine(buffer);
+}
+
+std::string Profile::countText(int index) const {
+    if (mode == PROFILE_SAMPLE) return "-";
+    return std::to_string(counts[index]);
+}
+
+void Profile::dump(Program &program, const std::string &filename) {
+    FILE *out = std::fopen(filename.c_str(), "w");
+    if (out == nullptr) error("CANNOT WRITE " + filename);
+    std::fprintf(out, "line\tcount\tnanoseconds\n");
+    int nLines = (int) counts.size() - 1;
+    for (int i = 0; i < nLines; i++) {
+        std::fprintf(out, "%d\t%s\t%.0f\n", program.getLineNumberAt(i),
+                     countText(i).c_str(), lineTime(i));
+    }
+    bool failed = std::ferror(out) != 0;
+    if (std::fclose(out) != 0 || failed) error("CANNOT WRITE " + filename);
+}
@@ -0,0 +1,173 @@
+/*
+ * File: profiler.h
+ * ----------------
+ * This interface exports the Profile class, which records where the
+ * virtual machine spends its time while it runs a program.
+ */
+
+#ifndef _profiler_h
+#define _profiler_h
+
+#include <ctime>
+#include <string>
+#include <vector>
+#include "compiler.hpp"
+#include "program.hpp"
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+/*
+ * Type: ProfileMode
+ * -----------------
+ * Determines how a run is measured.
+ *
+ *   PROFILE_EXACT    Count every line as it starts and read the cycle
+ *                    counter to charge the elapsed time to the line
+ *                    that just finished.  The program is compiled with
+ *                    an OP_LINE instruction at the start of each line.
+ *   PROFILE_SAMPLE   Look at the running stretch of straight-line
+ *                    code every millisecond of the thread's CPU time
+ *                    and share that time among the lines in proportion
+ *                    to the instructions they have in the sampled
+ *                    stretches.  Lines are not counted, and the
+ *                    program runs at full speed.
+ */
+
+enum ProfileMode {
+    PROFILE_EXACT, PROFILE_SAMPLE
+};
+
+/*
+ * Class: Profile
+ * --------------
+ * Holds the per-line measurements of one profiled run.  Lines are
+ * identified by their position in the program's line index.
+ */
+
+class Profile {
+
+public:
+
+    explicit Profile(ProfileMode mode) : mode(mode) {}
+
+    ~Profile();
+
+    Profile(const Profile &) = delete;
+
+    Profile &operator=(const Profile &) = delete;
+
+/*
+ * Method: getMode
+ * Usage: ProfileMode mode = profile.getMode();
+ * --------------------------------------------
+ * Returns the mode in which the run is measured.
+ */
+
+    ProfileMode getMode() const { return mode; }
+
+/*
+ * Method: start
+ * Usage: profile.start(bytecode);
+ * -------------------------------
+ * Clears the measurements and starts measuring a run of bytecode.
+ */
+
+    void start(const Bytecode &bytecode);
+
+/*
+ * Method: stop
+ * Usage: profile.stop();
+ * ----------------------
+ * Stops measuring and converts the measurements into times.  Must be
+ * called however the run ends.
+ */
+
+    void stop();
+
+/*
+ * Method: enterLine
+ * Usage: profile.enterLine(index);
+ * --------------------------------
+ * Records that the line at position index has started.  The virtual
+ * machine calls this for every OP_LINE instruction, so it is inline.
+ */
+
+    void enterLine(int index) {
+        counts[index]++;
+        long long t = readClock();
+        units[currentLine] += t - lineStart;
+        lineStart = t;
+        currentLine = index;
+    }
+
+/*
+ * Variable: position
+ * ------------------
+ * In sampling mode, the virtual machine stores here the address of
+ * the instruction at which it starts, of every instruction to which
+ * it jumps and of the one after every conditional jump.  Execution
+ * continues in a straight line from there to the next jump.  Each
+ * thread has its own position, so sessions running side by side are
+ * sampled independently.
+ */
+
+    static inline thread_local const Instruction *volatile position = nullptr;
+
+/*
+ * Method: report
+ * Usage: profile.report(program);
+ * -------------------------------
+ * Prints the lines that ran, hottest first, with their execution
+ * counts, their time and share of the total, and their source text.
+ * Counts are shown as - in sampling mode.
+ */
+
+    void report(Program &program);
+
+/*
+ * Method: dump
+ * Usage: profile.dump(program, filename);
+ * ---------------------------------------
+ * Writes the measurements to filename as tab-separated values, one
+ * row per program line in line number order, so that the profiles of
+ * two runs can be compared with ordinary text tools.  If the file
+ * cannot be written, this method raises an error.
+ */
+
+    void dump(Program &program, const std::string &filename);
+
+private:
+
+    ProfileMode mode;
+    std::vector<long long> counts;      /* Times each line started      */
+    std::vector<long long> units;       /* Cycles or samples per line   */
+    std::vector<long long> samples;     /* Samples per instruction      */
+    std::vector<int> runEnds;           /* Last instruction of the run  */
+    std::vector<int> lineStarts;        /* From the profiled bytecode   */
+    double nanosPerUnit = 0;            /* Converts units to time       */
+    int currentLine = 0;                /* Line being timed             */
+    long long lineStart = 0;            /* Cycle counter when it began  */
+    long long runStart = 0;             /* Cycle counter at start       */
+    long long nanosStart = 0;           /* Clock at start               */
+    timer_t timer = {};                 /* Sampling timer of the thread */
+    bool running = false;
+
+    double lineTime(int index) const { return units[index] * nanosPerUnit; }
+    std::string countText(int index) const;
+    static void takeSample(int signal);
+    static void installSampler();
+
+    static long long readClock() {
+#if defined(__x86_64__)
+        return (long long) __rdtsc();
+#else
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#endif
+    }
+
+};
+
+#endif
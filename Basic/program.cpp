@@ -1,16 +1,18 @@
 /*
  * File: program.cpp
  * -----------------
- * This file is a stub implementation of the program.h interface
- * in which none of the methods do anything beyond returning a
- * value of the correct type.  Your job is to fill in the bodies
- * of each of these methods with an implementation that satisfies
- * the performance guarantees specified in the assignment.
+ * This file implements the program.h interface on a chunked array
+ * of lines kept in line-number order.
  */
 
+#include <algorithm>
+#include <iterator>
 #include "program.hpp"
+#include "optimizer.hpp"
 
+/* Constants */
 
+static const int CHUNK_LINES = 256;
 
 Program::Program() = default;
 
@@ -19,70 +21,229 @@ Program::~Program() {
 }
 
 void Program::clear() {
-    for (auto &kv : parsedStmts) {
-        delete kv.second;
-    }
-    parsedStmts.clear();
-    sourceLines.clear();
+    chunks.clear();
+    lineCount = 0;
+    edited();
     nextLineRequest = -2;
 }
 
-void Program::addSourceLine(int lineNumber, const std::string &line) {
-    // Replace or insert source line text
-    sourceLines[lineNumber] = line;
-    // If there was a parsed statement before, delete it (will be reset by caller)
-    auto it = parsedStmts.find(lineNumber);
-    if (it != parsedStmts.end()) {
-        delete it->second;
-        parsedStmts.erase(it);
+/*
+ * Implementation notes: addSourceLine
+ * -----------------------------------
+ * A new line goes into the chunk that holds the first larger line, or
+ * at the end of the last chunk when it is the largest, so a program
+ * entered in ascending order only ever appends.  A chunk that grows
+ * beyond CHUNK_LINES is split in half.
+ */
+
+void Program::addSourceLine(int lineNumber, std::string_view line) {
+    Cursor pos = find(lineNumber);
+    if (pos.chunk < (int) chunks.size() && chunks[pos.chunk][pos.offset].lineNumber == lineNumber) {
+        Line &existing = chunks[pos.chunk][pos.offset];
+        existing.source = line;
+        // Release the old parsed statement (will be reset by caller)
+        existing.stmt = nullptr;
+        existing.arena = Arena();
+        return;
     }
+    if (pos.chunk == (int) chunks.size()) {
+        if (chunks.empty() || (int) chunks.back().size() >= CHUNK_LINES) chunks.emplace_back();
+        pos.chunk = (int) chunks.size() - 1;
+        pos.offset = (int) chunks[pos.chunk].size();
+    }
+    std::vector<Line> &chunk = chunks[pos.chunk];
+    Line entry;
+    entry.lineNumber = lineNumber;
+    entry.source = line;
+    chunk.insert(chunk.begin() + pos.offset, std::move(entry));
+    if ((int) chunk.size() > CHUNK_LINES) {
+        std::vector<Line> upper(std::make_move_iterator(chunk.begin() + CHUNK_LINES / 2),
+                                std::make_move_iterator(chunk.end()));
+        chunk.erase(chunk.begin() + CHUNK_LINES / 2, chunk.end());
+        chunks.insert(chunks.begin() + pos.chunk + 1, std::move(upper));
+    }
+    lineCount++;
+    edited();
 }
 
+/*
+ * Implementation notes: removeSourceLine
+ * --------------------------------------
+ * A chunk that becomes empty is dropped.  Chunks that are merely small
+ * are left alone, since the next insertion may fill them again.
+ */
+
 void Program::removeSourceLine(int lineNumber) {
-    sourceLines.erase(lineNumber);
-    auto it = parsedStmts.find(lineNumber);
-    if (it != parsedStmts.end()) {
-        delete it->second;
-        parsedStmts.erase(it);
-    }
+    Cursor pos = find(lineNumber);
+    if (pos.chunk == (int) chunks.size() || chunks[pos.chunk][pos.offset].lineNumber != lineNumber) return;
+    std::vector<Line> &chunk = chunks[pos.chunk];
+    chunk.erase(chunk.begin() + pos.offset);
+    if (chunk.empty()) chunks.erase(chunks.begin() + pos.chunk);
+    lineCount--;
+    edited();
 }
 
 std::string Program::getSourceLine(int lineNumber) {
-    auto it = sourceLines.find(lineNumber);
-    if (it == sourceLines.end()) return "";
-    return it->second;
+    Line *line = findLine(lineNumber);
+    if (line == nullptr) return "";
+    return line->source;
 }
 
-void Program::setParsedStatement(int lineNumber, Statement *stmt) {
-    if (sourceLines.find(lineNumber) == sourceLines.end()) {
-        // No such line; free provided stmt and raise error
-        delete stmt;
-        error("LINE NUMBER ERROR");
-    }
-    auto it = parsedStmts.find(lineNumber);
-    if (it != parsedStmts.end()) {
-        delete it->second;
-        it->second = stmt;
-    } else {
-        parsedStmts.emplace(lineNumber, stmt);
+Status Program::setParsedStatement(int lineNumber, Statement *stmt, Arena arena, bool optimized) {
+    Line *line = findLine(lineNumber);
+    if (line == nullptr) {
+        // No such line; the arena holding stmt is freed on return
+        return STATUS_LINE_NUMBER_ERROR;
     }
+    if (stmt != nullptr && !optimized) optimizeStatement(stmt, arena);
+    line->stmt = stmt;
+    line->arena = std::move(arena);
+    return STATUS_OK;
+}
+
+void Program::appendLine(int lineNumber, std::string_view line, Statement *stmt, Arena arena) {
+    if (chunks.empty() || (int) chunks.back().size() >= CHUNK_LINES) chunks.emplace_back();
+    if (chunks.back().empty()) chunks.back().reserve(CHUNK_LINES);
+    Line &entry = chunks.back().emplace_back();
+    entry.lineNumber = lineNumber;
+    entry.stmt = stmt;
+    entry.source = line;
+    entry.arena = std::move(arena);
+    lineCount++;
+    edited();
 }
 
 Statement *Program::getParsedStatement(int lineNumber) {
-    auto it = parsedStmts.find(lineNumber);
-    if (it == parsedStmts.end()) return nullptr;
-    return it->second;
+    Line *line = findLine(lineNumber);
+    if (line == nullptr) return nullptr;
+    return line->stmt;
 }
 
 int Program::getFirstLineNumber() {
-    if (sourceLines.empty()) return -1;
-    return sourceLines.begin()->first;
+    if (lineCount == 0) return -1;
+    return lineAt(0).lineNumber;
 }
 
+/*
+ * Implementation notes: getNextLineNumber
+ * ---------------------------------------
+ * When lineNumber is the line under the cursor, which it is whenever
+ * the lines are visited in order, the answer is the next entry and no
+ * search is needed.
+ */
+
 int Program::getNextLineNumber(int lineNumber) {
-    auto it = sourceLines.upper_bound(lineNumber);
-    if (it == sourceLines.end()) return -1;
-    return it->first;
+    int index;
+    if (cursor.index >= 0 && chunks[cursor.chunk][cursor.offset].lineNumber == lineNumber) {
+        index = cursor.index + 1;
+    } else {
+        index = getLineIndex(lineNumber);
+        if (index < lineCount && lineAt(index).lineNumber == lineNumber) index++;
+    }
+    if (index >= lineCount) return -1;
+    return lineAt(index).lineNumber;
+}
+
+int Program::getLineCount() {
+    return lineCount;
+}
+
+int Program::getLineIndex(int lineNumber) {
+    Cursor pos = find(lineNumber);
+    if (pos.chunk == (int) chunks.size()) return lineCount;
+    if (!startsValid) buildStarts();
+    return chunkStarts[pos.chunk] + pos.offset;
+}
+
+int Program::getLineNumberAt(int index) {
+    return lineAt(index).lineNumber;
+}
+
+Statement *Program::getStatementAt(int index) {
+    return lineAt(index).stmt;
+}
+
+const std::string &Program::getSourceLineAt(int index) {
+    return lineAt(index).source;
+}
+
+/*
+ * Implementation notes: find
+ * --------------------------
+ * Returns the position of the first line whose number is at least
+ * lineNumber, found by a binary search for the first chunk whose last
+ * line is large enough followed by one within that chunk.  If there
+ * is no such line, the chunk of the result is chunks.size().
+ */
+
+Program::Cursor Program::find(int lineNumber) {
+    Cursor pos;
+    auto chunk = std::lower_bound(chunks.begin(), chunks.end(), lineNumber,
+                                  [](const std::vector<Line> &c, int n) { return c.back().lineNumber < n; });
+    pos.chunk = (int) (chunk - chunks.begin());
+    if (chunk == chunks.end()) return pos;
+    auto line = std::lower_bound(chunk->begin(), chunk->end(), lineNumber,
+                                 [](const Line &l, int n) { return l.lineNumber < n; });
+    pos.offset = (int) (line - chunk->begin());
+    return pos;
+}
+
+Program::Line *Program::findLine(int lineNumber) {
+    Cursor pos = find(lineNumber);
+    if (pos.chunk == (int) chunks.size()) return nullptr;
+    Line &line = chunks[pos.chunk][pos.offset];
+    return line.lineNumber == lineNumber ? &line : nullptr;
+}
+
+/*
+ * Implementation notes: lineAt
+ * ----------------------------
+ * Moves the cursor to the line with the given index.  Stepping to the
+ * next index, as every caller that walks the program does, advances
+ * the cursor within its chunk or to the start of the next one; any
+ * other index is located by a binary search over chunkStarts.
+ */
+
+Program::Line &Program::lineAt(int index) {
+    if (index != cursor.index) {
+        if (index == cursor.index + 1 && cursor.index >= 0) {
+            if (++cursor.offset == (int) chunks[cursor.chunk].size()) {
+                cursor.chunk++;
+                cursor.offset = 0;
+            }
+        } else {
+            if (!startsValid) buildStarts();
+            auto start = std::upper_bound(chunkStarts.begin(), chunkStarts.end() - 1, index) - 1;
+            cursor.chunk = (int) (start - chunkStarts.begin());
+            cursor.offset = index - *start;
+        }
+        cursor.index = index;
+    }
+    return chunks[cursor.chunk][cursor.offset];
+}
+
+void Program::buildStarts() {
+    chunkStarts.clear();
+    chunkStarts.reserve(chunks.size() + 1);
+    int start = 0;
+    for (const std::vector<Line> &chunk : chunks) {
+        chunkStarts.push_back(start);
+        start += (int) chunk.size();
+    }
+    chunkStarts.push_back(start);
+    startsValid = true;
+}
+
+/*
+ * Implementation notes: edited
+ * ----------------------------
+ * Called after every change to the set of lines, since any of them
+ * may shift the positions that chunkStarts and the cursor refer to.
+ */
+
+void Program::edited() {
+    startsValid = false;
+    cursor = Cursor();
 }
 
 void Program::requestNextLine(int lineNumber) { nextLineRequest = lineNumber; }
@@ -9,9 +9,9 @@
 #define _program_h
 
 #include <string>
+#include <string_view>
 #include <vector>
-#include <set>
-#include <unordered_map>
+#include "arena.hpp"
 #include "statement.hpp"
 
 
@@ -27,7 +27,16 @@ class Statement;
  *    line number) that was entered by the user.
  *
  * 2. The parsed representation of that statement, which is a
- *    pointer to a Statement.
+ *    pointer to a Statement, together with the Arena that holds
+ *    the statement and its expressions.  Replacing or removing the
+ *    line releases that arena as a whole.
+ *
+ * Both components live in a single entry per line.  The entries are
+ * kept in line-number order in a sequence of short sorted arrays, so
+ * that lookups take a binary search over the arrays and one within an
+ * array, edits move at most one array's worth of entries, and the
+ * successor of a line is normally the next entry in memory.  Only the
+ * number of lines matters, not how widely their numbers are spread.
  */
 
 class Program {
@@ -72,7 +81,7 @@ public:
  * program in the correct sequence.
  */
 
-    void addSourceLine(int lineNumber, const std::string& line);
+    void addSourceLine(int lineNumber, std::string_view line);
 
 /*
  * Method: removeSourceLine
@@ -98,15 +107,33 @@ public:
 
 /*
  * Method: setParsedStatement
- * Usage: program.setParsedStatement(lineNumber, stmt);
- * ----------------------------------------------------
+ * Usage: Status status = program.setParsedStatement(lineNumber, stmt, std::move(arena));
+ *        Status status = program.setParsedStatement(lineNumber, stmt, std::move(arena), true);
+ * ------------------------------------------------------------------------------------------
  * Adds the parsed representation of the statement to the statement
- * at the specified line number.  If no such line exists, this
- * method raises an error.  If a previous parsed representation
- * exists, the memory for that statement is reclaimed.
+ * at the specified line number, taking ownership of the arena in
+ * which it was allocated.  The statement is first simplified by
+ * optimizeStatement, unless optimized is true to say that this has
+ * already been done.  If no such line exists, this method
+ * returns STATUS_LINE_NUMBER_ERROR and frees the arena.  If a previous
+ * parsed representation exists, the memory for that statement is
+ * reclaimed.
+ */
+
+    Status setParsedStatement(int lineNumber, Statement *stmt, Arena arena, bool optimized = false);
+
+/*
+ * Method: appendLine
+ * Usage: program.appendLine(lineNumber, line, stmt, std::move(arena));
+ * --------------------------------------------------------------------
+ * Adds a line together with its parsed representation, which may be
+ * NULL, in constant time.  The line number must be larger than that of
+ * every line in the program, and the statement is stored as it is,
+ * without being passed to optimizeStatement.  This is the fast path
+ * for restoring a program that was stored before.
  */
 
-    void setParsedStatement(int lineNumber, Statement *stmt);
+    void appendLine(int lineNumber, std::string_view line, Statement *stmt, Arena arena);
 
 /*
  * Method: getParsedStatement
@@ -140,8 +167,47 @@ public:
 
     int getNextLineNumber(int lineNumber);
 
-    //more func to add
-    //todo
+/*
+ * Method: getLineCount
+ * Usage: int n = program.getLineCount();
+ * --------------------------------------
+ * Returns the number of lines in the program.  Lines are also
+ * addressed by their position in line-number order, from 0 to
+ * getLineCount() - 1; stepping to the next line is then simply an
+ * increment of that index.
+ */
+
+    int getLineCount();
+
+/*
+ * Method: getLineIndex
+ * Usage: int index = program.getLineIndex(lineNumber);
+ * ----------------------------------------------------
+ * Returns the index of the first line whose number is at least
+ * lineNumber, which is the line itself when it exists.  If every
+ * line is smaller, this method returns getLineCount().
+ */
+
+    int getLineIndex(int lineNumber);
+
+/*
+ * Methods: getLineNumberAt, getStatementAt, getSourceLineAt
+ * Usage: int lineNumber = program.getLineNumberAt(index);
+ *        Statement *stmt = program.getStatementAt(index);
+ *        const std::string &line = program.getSourceLineAt(index);
+ * ----------------------------------------------------------------
+ * Return the line number, the parsed statement (or NULL) and the
+ * source text of the line with the specified index, which must be in
+ * range.  Visiting the lines in index order takes constant time per
+ * line.  The reference returned by getSourceLineAt remains valid only
+ * until the program is next changed.
+ */
+
+    int getLineNumberAt(int index);
+
+    Statement *getStatementAt(int index);
+
+    const std::string &getSourceLineAt(int index);
 
     // Execution flow control helpers
     void requestNextLine(int lineNumber);
@@ -154,11 +220,38 @@ public:
 
 private:
 
-    // Fill this in with whatever types and instance variables you need
-    // Source lines mapped by line number (preserve original text)
-    std::map<int, std::string> sourceLines;
-    // Parsed statements mapped by line number
-    std::map<int, Statement *> parsedStmts;
+    // One line of the program: its source text and parsed statement
+    struct Line {
+        int lineNumber;
+        Statement *stmt = nullptr;
+        std::string source;
+        Arena arena;
+    };
+
+    // The lines in order, split into nonempty chunks of at most
+    // CHUNK_LINES lines each
+    std::vector<std::vector<Line>> chunks;
+    int lineCount = 0;
+
+    // Index of the first line of each chunk, followed by lineCount;
+    // rebuilt on demand after an edit
+    std::vector<int> chunkStarts;
+    bool startsValid = false;
+
+    // The line most recently visited by position or by number, from
+    // which the next line is found without a search
+    struct Cursor {
+        int chunk = 0;
+        int offset = 0;
+        int index = -1;
+    };
+    Cursor cursor;
+
+    Cursor find(int lineNumber);
+    Line *findLine(int lineNumber);
+    Line &lineAt(int index);
+    void buildStarts();
+    void edited();
 
     // Next-line request from a statement execution. Semantics:
     // -2: no request (advance to next sequential line)
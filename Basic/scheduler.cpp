@@ -0,0 +1,122 @@
+/*
+ * File: scheduler.cpp
+ * -------------------
+ * This file implements the work-stealing thread pool.
+ */
+
+#include "scheduler.hpp"
+
+/*
+ * Implementation notes: worker identity
+ * -------------------------------------
+ * Each worker thread records its pool and index, so that submit can
+ * tell a task submitted by one of its own workers from a task that
+ * comes from outside.
+ */
+
+static thread_local WorkStealingPool *currentPool = nullptr;
+static thread_local int currentWorker = -1;
+
+WorkStealingPool::WorkStealingPool(int nThreads) {
+    if (nThreads <= 0) nThreads = (int) std::thread::hardware_concurrency();
+    if (nThreads <= 0) nThreads = 1;
+    for (int i = 0; i < nThreads; i++) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    for (int i = 0; i < nThreads; i++) {
+        threads.emplace_back([this, i] { workerLoop(i); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    wait();
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wakeup.notify_all();
+    for (std::thread &thread : threads) thread.join();
+}
+
+void WorkStealingPool::submit(std::function<void()> task) {
+    int target;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (currentPool == this) {
+            target = currentWorker;
+        } else {
+            target = nextWorker;
+            nextWorker = (nextWorker + 1) % (int) workers.size();
+        }
+        pending++;
+    }
+    {
+        std::lock_guard<std::mutex> guard(workers[target]->lock);
+        workers[target]->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        queued++;
+    }
+    wakeup.notify_one();
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock<std::mutex> guard(lock);
+    finished.wait(guard, [this] { return pending == 0; });
+}
+
+/*
+ * Implementation notes: takeTask
+ * ------------------------------
+ * A worker first looks at the back of its own queue, then visits the
+ * other workers in order, starting with its right-hand neighbor, and
+ * takes the task at the front of the first queue that has one.  The
+ * queued count only lets idle workers sleep.  It is raised after the
+ * task is in its queue, so a worker it wakes finds the task, and it
+ * may briefly drop below zero when a task is taken before that.
+ */
+
+bool WorkStealingPool::takeTask(int self, std::function<void()> &task) {
+    int n = (int) workers.size();
+    {
+        Worker &own = *workers[self];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (int k = 1; k < n; k++) {
+        Worker &victim = *workers[(self + k) % n];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::workerLoop(int self) {
+    currentPool = this;
+    currentWorker = self;
+    while (true) {
+        std::function<void()> task;
+        if (takeTask(self, task)) {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                queued--;
+            }
+            task();
+            std::lock_guard<std::mutex> guard(lock);
+            if (--pending == 0) finished.notify_all();
+            continue;
+        }
+        std::unique_lock<std::mutex> guard(lock);
+        wakeup.wait(guard, [this] { return stopping || queued > 0; });
+        if (stopping && queued == 0) return;
+    }
+}
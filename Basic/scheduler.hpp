@@ -0,0 +1,107 @@
+/*
+ * File: scheduler.h
+ * -----------------
+ * This interface exports a pool of worker threads that share their
+ * work by stealing tasks from each other.
+ */
+
+#ifndef _scheduler_h
+#define _scheduler_h
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Class: WorkStealingPool
+ * -----------------------
+ * Runs tasks on a fixed set of worker threads.  Each worker owns a
+ * queue of tasks.  A task submitted by a worker goes to the back of
+ * that worker's own queue, and a worker takes its next task from the
+ * back of its own queue, so related work stays on one core.  A worker
+ * whose queue is empty steals the oldest task of another worker.
+ * Tasks submitted from outside the pool are dealt out in turn.
+ */
+
+class WorkStealingPool {
+
+public:
+
+/*
+ * Constructor: WorkStealingPool
+ * Usage: WorkStealingPool pool(nThreads);
+ * ---------------------------------------
+ * Starts nThreads worker threads, or one per core if nThreads is not
+ * positive.
+ */
+
+    explicit WorkStealingPool(int nThreads = 0);
+
+/*
+ * Destructor: ~WorkStealingPool
+ * -----------------------------
+ * Waits for all tasks to finish and stops the workers.
+ */
+
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+/*
+ * Method: submit
+ * Usage: pool.submit(task);
+ * -------------------------
+ * Schedules task to run on one of the workers.  Tasks may submit
+ * further tasks.  A task must not let an exception escape.
+ */
+
+    void submit(std::function<void()> task);
+
+/*
+ * Method: wait
+ * Usage: pool.wait();
+ * -------------------
+ * Returns once every task submitted so far, and every task those
+ * submitted in turn, has finished.
+ */
+
+    void wait();
+
+/*
+ * Method: size
+ * Usage: int n = pool.size();
+ * ---------------------------
+ * Returns the number of worker threads.
+ */
+
+    int size() const { return (int) threads.size(); }
+
+private:
+
+    struct Worker {
+        std::mutex lock;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::mutex lock;                    /* Guards the fields below      */
+    std::condition_variable wakeup;     /* Signals new tasks or stop    */
+    std::condition_variable finished;   /* Signals pending == 0         */
+    long long pending = 0;              /* Submitted but not finished   */
+    long long queued = 0;               /* Submitted but not started    */
+    int nextWorker = 0;
+    bool stopping = false;
+
+    void workerLoop(int self);
+    bool takeTask(int self, std::function<void()> &task);
+
+};
+
+#endif
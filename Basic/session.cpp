@@ -0,0 +1,289 @@
+/*
+ * File: session.cpp
+ * -----------------
+ * This file implements interpreter sessions and runs them in parallel.
+ */
+
+#include <cstdio>
+#include "session.hpp"
+#include "cache.hpp"
+#include "compiler.hpp"
+#include "image.hpp"
+#include "keyword.hpp"
+#include "parser.hpp"
+#include "transpiler.hpp"
+#include "verifier.hpp"
+#include "vm.hpp"
+#include "Utils/error.hpp"
+#include "Utils/strlib.hpp"
+
+/* Constants */
+
+static const int SLICE_LINES = 256;
+
+/* Private function prototypes */
+
+static void schedule(Session *session, WorkStealingPool &pool);
+
+Session::Session(const SessionOptions &options, Channel *channel)
+    : options(options), channel(channel) {
+    /* Empty */
+}
+
+void Session::run() {
+    while (runSlice(SLICE_LINES)) {
+        /* Empty */
+    }
+}
+
+/*
+ * Implementation notes: runSlice
+ * ------------------------------
+ * The session's channel is selected for the calling thread only while
+ * the slice runs, since the next slice may well run on another thread.
+ * Errors are reported on the session's own output.  The first slice
+ * begins by loading the image named in the options, if any.
+ */
+
+bool Session::runSlice(int maxLines) {
+    Channel *previous = setChannel(channel);
+    if (!started) {
+        started = true;
+        try {
+            if (!options.imageFile.empty()) loadImage(program, state, options.imageFile);
+        } catch (ErrorException &ex) {
+            writeError(ex.getMessage());
+        }
+    }
+    for (int i = 0; i < maxLines && !finished; i++) {
+        try {
+            std::string_view input;
+            if (!readLine(input)) {
+                finished = true;
+                break;
+            }
+            if (input.empty())
+                continue;
+            if (processLine(input) == STATUS_QUIT) {
+                finished = true;
+                break;
+            }
+        } catch (ErrorException &ex) {
+            writeError(ex.getMessage());
+        }
+    }
+    setChannel(previous);
+    return !finished;
+}
+
+Status Session::processLine(std::string_view line) {
+    Failure failure = interpretLine(line);
+    if (failure.status != STATUS_OK && failure.status != STATUS_QUIT) {
+        writeError(failureMessage(failure));
+    }
+    return failure.status;
+}
+
+/*
+ * Implementation notes: interpretLine
+ * -----------------------------------
+ * Does the work of processLine and returns the error, if any, which
+ * processLine then reports.  The token of a failure is a view of line.
+ */
+
+Failure Session::interpretLine(std::string_view line) {
+    Failure failure;
+    Lexer lexer(line);
+    if (!lexer.hasMoreTokens()) return failure;
+    Token first = lexer.peek();
+
+    if (first.kind == TOKEN_NUMBER) {
+        lexer.next();
+        int lineNumber;
+        if (!tokenToInteger(lexer.text(first), lineNumber)) {
+            return {STATUS_ILLEGAL_INTEGER, lexer.text(first)};
+        }
+        // a line number with nothing after it deletes the line
+        if (!lexer.hasMoreTokens()) {
+            program.removeSourceLine(lineNumber);
+            return failure;
+        }
+        program.addSourceLine(lineNumber, line);
+        Arena arena;
+        Statement *stmt = CompileCache::parseLine(lexer, arena, failure);
+        Status status = program.setParsedStatement(lineNumber, stmt, std::move(arena), true);
+        if (failure.status == STATUS_OK) failure.status = status;
+        return failure;
+    }
+
+    // Immediate mode commands
+    switch (lookupKeyword(lexer.text(first))) {
+        case KEYWORD_REM:
+            // immediate comment: no-op
+            return failure;
+        case KEYWORD_LET: case KEYWORD_PRINT: case KEYWORD_INPUT: case KEYWORD_END:
+        case KEYWORD_GOTO: case KEYWORD_IF: case KEYWORD_DIM: {
+            Arena arena;
+            Statement *stmt = parseStatement(lexer, arena, failure);
+            if (stmt != nullptr) failure.status = checkStatement(stmt);
+            if (failure.status == STATUS_OK) failure.status = stmt->execute(state, program);
+            return failure;
+        }
+        case KEYWORD_RUN:
+            failure.status = runProgram();
+            return failure;
+        case KEYWORD_PROFILE:
+            failure.status = profileProgram(lexer);
+            return failure;
+        case KEYWORD_SAVE: {
+            std::string filename = readFilename(lexer, first);
+            if (filename.empty()) return {STATUS_SYNTAX_ERROR, {}};
+            saveImage(program, state, filename);
+            return failure;
+        }
+        case KEYWORD_LOAD: {
+            std::string filename = readFilename(lexer, first);
+            if (filename.empty()) return {STATUS_SYNTAX_ERROR, {}};
+            loadImage(program, state, filename);
+            return failure;
+        }
+        case KEYWORD_LIST: {
+            int nLines = program.getLineCount();
+            for (int i = 0; i < nLines; i++) {
+                writeLine(program.getSourceLineAt(i));
+            }
+            return failure;
+        }
+        case KEYWORD_CACHE:
+            CompileCache::report();
+            return failure;
+        case KEYWORD_VERIFY:
+            reportProblems();
+            return failure;
+        case KEYWORD_CLEAR:
+            program.clear();
+            state.Clear();
+            return failure;
+        case KEYWORD_QUIT:
+            return {STATUS_QUIT, {}};
+        case KEYWORD_HELP:
+            // optional; ignore or print simple help
+            return failure;
+        default:
+            return {STATUS_SYNTAX_ERROR, {}};
+    }
+}
+
+/*
+ * Implementation notes: runProgram
+ * --------------------------------
+ * The stored program is compiled to bytecode, or found compiled in the
+ * cache, and executed by the virtual machine, which returns the runtime
+ * error that stopped the program, if any.  If profile is not nullptr,
+ * the run is measured in it.  With the cppFile option, the program is
+ * translated to C++ instead, starting from the current variable values,
+ * and the translation replaces the contents of the file.  Keeping it
+ * out of the session's output means that errors and immediate PRINTs
+ * cannot end up in the middle of it, and that the file holds a single
+ * translation unit however often RUN is entered.  With the verify
+ * option, a program in which the verifier finds problems is not run at
+ * all; the problems are reported instead.
+ */
+
+Status Session::runProgram(Profile *profile) {
+    if (!options.cppFile.empty()) {
+        std::string translation = translateToCpp(program, state);
+        FILE *out = std::fopen(options.cppFile.c_str(), "w");
+        if (out == nullptr) error("CANNOT WRITE " + options.cppFile);
+        std::fwrite(translation.data(), 1, translation.size(), out);
+        bool failed = std::ferror(out) != 0;
+        if (std::fclose(out) != 0 || failed) error("CANNOT WRITE " + options.cppFile);
+        return STATUS_OK;
+    }
+    if (options.verify && reportProblems() > 0) return STATUS_OK;
+    std::shared_ptr<const Bytecode> bytecode =
+        CompileCache::compile(program, profile != nullptr && profile->getMode() == PROFILE_EXACT);
+    VM vm;
+    vm.setNativeEnabled(options.nativeEnabled);
+    vm.setProfile(profile);
+    vm.setStepLimit(options.stepLimit);
+    vm.setTimeLimit(options.timeLimit);
+    return vm.run(*bytecode, state);
+}
+
+/*
+ * Implementation notes: profileProgram
+ * ------------------------------------
+ * Implements the PROFILE command, which runs the program like RUN
+ * and then reports where the time went.  PROFILE SAMPLE samples the
+ * running line instead of timing every line, which costs much less on
+ * programs whose lines are short.  A runtime error is reported before
+ * the profile, which covers the part of the program that ran.
+ */
+
+Status Session::profileProgram(Lexer &lexer) {
+    lexer.next();
+    ProfileMode mode = PROFILE_EXACT;
+    if (lexer.hasMoreTokens()) {
+        Token token = lexer.next();
+        if (lookupKeyword(lexer.text(token)) != KEYWORD_SAMPLE || lexer.hasMoreTokens()) {
+            return STATUS_SYNTAX_ERROR;
+        }
+        mode = PROFILE_SAMPLE;
+    }
+    Profile profile(mode);
+    Status status = runProgram(&profile);
+    if (status != STATUS_OK) writeError(statusMessage(status));
+    profile.report(program);
+    if (!options.profileFile.empty()) profile.dump(program, options.profileFile);
+    return STATUS_OK;
+}
+
+/*
+ * Implementation notes: reportProblems
+ * ------------------------------------
+ * Implements the VERIFY command, which prints one line for each
+ * problem the verifier finds, naming the program line it is on, and
+ * returns the number of problems.
+ */
+
+int Session::reportProblems() {
+    std::vector<Diagnostic> problems = verifyProgram(program);
+    for (const Diagnostic &problem : problems) {
+        writeLine("LINE " + std::to_string(problem.lineNumber) + ": " + statusMessage(problem.status));
+    }
+    return (int) problems.size();
+}
+
+/*
+ * Implementation notes: readFilename
+ * ----------------------------------
+ * The file name of SAVE and LOAD is the rest of the line after the
+ * keyword, without surrounding spaces, so that it need not be a
+ * single token.  It is empty if the command names no file.
+ */
+
+std::string Session::readFilename(Lexer &lexer, Token keyword) {
+    return trim(std::string(lexer.getInput().substr(keyword.offset + keyword.length)));
+}
+
+/*
+ * Implementation notes: runSessions
+ * ---------------------------------
+ * Each session is a chain of tasks, one per slice, in which every
+ * task submits the next.  A session therefore never runs on two
+ * workers at once, and because a worker prefers the tasks it submitted
+ * itself, a session tends to stay on one core until an idle worker
+ * steals it.
+ */
+
+void runSessions(const std::vector<Session *> &sessions, WorkStealingPool &pool) {
+    for (Session *session : sessions) schedule(session, pool);
+    pool.wait();
+}
+
+static void schedule(Session *session, WorkStealingPool &pool) {
+    pool.submit([session, &pool] {
+        if (session->runSlice(SLICE_LINES)) schedule(session, pool);
+    });
+}
@@ -0,0 +1,138 @@
+/*
+ * File: session.h
+ * ---------------
+ * This interface exports the Session class, which bundles a stored
+ * program, its variables and its input and output, together with the
+ * function that runs many sessions at once on a thread pool.
+ */
+
+#ifndef _session_h
+#define _session_h
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "evalstate.hpp"
+#include "io.hpp"
+#include "lexer.hpp"
+#include "profiler.hpp"
+#include "program.hpp"
+#include "scheduler.hpp"
+#include "status.hpp"
+
+/*
+ * Type: SessionOptions
+ * --------------------
+ * The settings, normally taken from the command line, that control
+ * how a session runs its program.
+ */
+
+struct SessionOptions {
+    bool nativeEnabled = false;     /* Allow the native code tier      */
+    std::string cppFile;            /* RUN writes C++ here, if set     */
+    std::string profileFile;        /* Where PROFILE dumps, if set     */
+    long long stepLimit = -1;       /* Instructions per run, if >= 0   */
+    long long timeLimit = -1;       /* Milliseconds per run, if >= 0   */
+    std::string imageFile;          /* Image loaded at start, if set   */
+    bool verify = false;            /* RUN verifies the program first  */
+};
+
+/*
+ * Class: Session
+ * --------------
+ * One user of the interpreter.  A session reads commands and program
+ * lines from its channel, or from standard input if it has none, and
+ * writes everything it prints to the same place.  Sessions share
+ * nothing but the symbol table, so different sessions may run on
+ * different threads at the same time.
+ */
+
+class Session {
+
+public:
+
+/*
+ * Constructor: Session
+ * Usage: Session session(options);
+ *        Session session(options, &channel);
+ * -----------------------------------------
+ * Creates a session with an empty program and no variables.  The
+ * channel must outlive the session.
+ */
+
+    explicit Session(const SessionOptions &options, Channel *channel = nullptr);
+
+    Session(const Session &) = delete;
+
+    Session &operator=(const Session &) = delete;
+
+/*
+ * Method: run
+ * Usage: session.run();
+ * ---------------------
+ * Processes input lines until the input ends or QUIT is entered.
+ */
+
+    void run();
+
+/*
+ * Method: runSlice
+ * Usage: if (session.runSlice(maxLines)) ...
+ * ------------------------------------------
+ * Processes at most maxLines input lines and returns true if the
+ * session may have more work to do.
+ */
+
+    bool runSlice(int maxLines);
+
+/*
+ * Method: processLine
+ * Usage: Status status = session.processLine(line);
+ * -------------------------------------------------
+ * Processes a single line entered by the user, which is either a
+ * program line, beginning with a line number, or a command such as
+ * LIST or RUN.  Errors are written to the session's output and
+ * returned; QUIT returns STATUS_QUIT.  Only a file that SAVE, LOAD or
+ * the C++ translation of RUN cannot use is reported by calling error.
+ */
+
+    Status processLine(std::string_view line);
+
+/*
+ * Method: isFinished
+ * Usage: if (session.isFinished()) ...
+ * ------------------------------------
+ * Returns true once the input has ended or QUIT has been entered.
+ */
+
+    bool isFinished() const { return finished; }
+
+private:
+
+    SessionOptions options;
+    Channel *channel;
+    Program program;
+    EvalState state;
+    bool started = false;
+    bool finished = false;
+
+    Failure interpretLine(std::string_view line);
+    Status runProgram(Profile *profile = nullptr);
+    Status profileProgram(Lexer &lexer);
+    int reportProblems();
+    std::string readFilename(Lexer &lexer, Token keyword);
+
+};
+
+/*
+ * Function: runSessions
+ * Usage: runSessions(sessions, pool);
+ * -----------------------------------
+ * Runs every session to completion on the workers of pool and returns
+ * when all of them have finished.  Sessions are run a slice of input
+ * lines at a time, so a long session does not hold up the others.
+ */
+
+void runSessions(const std::vector<Session *> &sessions, WorkStealingPool &pool);
+
+#endif
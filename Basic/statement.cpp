@@ -8,7 +8,7 @@
  */
 
 #include "statement.hpp"
-#include <iostream>
+#include "io.hpp"
 #include <cstdint>
 
 
@@ -20,31 +20,36 @@ Statement::Statement() = default;
 
 Statement::~Statement() = default;
 
-static bool isReservedKeyword(const std::string &name) {
-    std::string u = toUpperCase(name);
-    return u == "REM" || u == "LET" || u == "PRINT" || u == "INPUT" || u == "END" ||
-           u == "GOTO" || u == "IF" || u == "THEN" || u == "RUN" || u == "LIST" ||
-           u == "CLEAR" || u == "QUIT" || u == "HELP";
-}
-
-void RemStatement::execute(EvalState &state, Program &program) {
+Status RemStatement::execute(EvalState &state, Program &program) {
     (void) state; (void) program; // no-op
+    return STATUS_OK;
 }
 
-void LetStatement::execute(EvalState &state, Program &program) {
+Status LetStatement::execute(EvalState &state, Program &program) {
     (void) program;
-    if (isReservedKeyword(name)) error("SYNTAX ERROR");
-    int v = exp->eval(state);
-    state.setValue(name, v);
+    int v, index = 0;
+    Status status = (element != nullptr) ? element->locate(state, index) : STATUS_OK;
+    if (status == STATUS_OK) status = exp->eval(state, v);
+    if (status != STATUS_OK) return status;
+    if (element != nullptr) {
+        state.setElement(slot, index, v);
+    } else {
+        state.setValue(slot, v);
+    }
+    return STATUS_OK;
 }
 
-void PrintStatement::execute(EvalState &state, Program &program) {
+Status PrintStatement::execute(EvalState &state, Program &program) {
     (void) program;
-    int v = exp->eval(state);
-    std::cout << v << std::endl;
+    int v;
+    Status status = exp->eval(state, v);
+    if (status != STATUS_OK) return status;
+    writeInteger(v);
+    endLine();
+    return STATUS_OK;
 }
 
-static bool parseInteger(const std::string &s, int &out) {
+static bool parseInteger(std::string_view s, int &out) {
     if (s.empty()) return false;
     size_t i = 0; bool neg = false;
     if (s[0] == '+' || s[0] == '-') { neg = (s[0] == '-'); i = 1; }
@@ -61,52 +66,77 @@ static bool parseInteger(const std::string &s, int &out) {
     return true;
 }
 
-void InputStatement::execute(EvalState &state, Program &program) {
+Status InputStatement::execute(EvalState &state, Program &program) {
     (void) program;
-    if (isReservedKeyword(name)) error("SYNTAX ERROR");
+    int v, index = 0;
+    Status status = (element != nullptr) ? element->locate(state, index) : STATUS_OK;
+    if (status == STATUS_OK) status = readInputValue(v);
+    if (status != STATUS_OK) return status;
+    if (element != nullptr) {
+        state.setElement(slot, index, v);
+    } else {
+        state.setValue(slot, v);
+    }
+    return STATUS_OK;
+}
+
+Status readInputValue(int &value) {
     while (true) {
-        std::cout << " ? ";
-        std::cout.flush();
-        std::string line;
-        if (!std::getline(std::cin, line)) {
-            error("INVALID NUMBER");
+        writeString(" ? ");
+        flushBeforeInput();
+        std::string_view line;
+        if (!readLine(line)) {
+            return STATUS_INVALID_NUMBER;
         }
         // trim
         // Use simple trimming of spaces and tabs
         size_t l = 0, r = line.size();
         while (l < r && (line[l] == ' ' || line[l] == '\t')) ++l;
         while (r > l && (line[r-1] == ' ' || line[r-1] == '\t')) --r;
-        std::string t = line.substr(l, r - l);
-        int v = 0;
-        if (parseInteger(t, v)) {
-            state.setValue(name, v);
-            break;
+        std::string_view t = line.substr(l, r - l);
+        if (parseInteger(t, value)) {
+            return STATUS_OK;
         } else {
-            std::cout << "INVALID NUMBER" << std::endl;
+            writeLine("INVALID NUMBER");
         }
     }
 }
 
-void EndStatement::execute(EvalState &state, Program &program) {
+Status EndStatement::execute(EvalState &state, Program &program) {
     (void) state;
     program.requestEnd();
+    return STATUS_OK;
 }
 
-void GotoStatement::execute(EvalState &state, Program &program) {
+Status GotoStatement::execute(EvalState &state, Program &program) {
     (void) state;
     program.requestNextLine(target);
+    return STATUS_OK;
 }
 
-void IfStatement::execute(EvalState &state, Program &program) {
-    int lv = lhs->eval(state);
-    int rv = rhs->eval(state);
+Status IfStatement::execute(EvalState &state, Program &program) {
+    int lv, rv;
+    Status status = lhs->eval(state, lv);
+    if (status == STATUS_OK) status = rhs->eval(state, rv);
+    if (status != STATUS_OK) return status;
     bool cond = false;
-    if (op == "=") cond = (lv == rv);
-    else if (op == "<") cond = (lv < rv);
-    else if (op == ">") cond = (lv > rv);
-    else if (op == "<=") cond = (lv <= rv);
-    else if (op == ">=") cond = (lv >= rv);
-    else if (op == "<>") cond = (lv != rv);
-    else error("SYNTAX ERROR");
+    switch (op) {
+        case EQ_OP: cond = (lv == rv); break;
+        case LT_OP: cond = (lv < rv); break;
+        case GT_OP: cond = (lv > rv); break;
+        case LE_OP: cond = (lv <= rv); break;
+        case GE_OP: cond = (lv >= rv); break;
+        default: cond = (lv != rv); break;
+    }
     if (cond) program.requestNextLine(target);
+    return STATUS_OK;
+}
+
+Status DimStatement::execute(EvalState &state, Program &program) {
+    (void) program;
+    int rows, columns = 0;
+    Status status = bounds[0]->eval(state, rows);
+    if (status == STATUS_OK && bounds[1] != nullptr) status = bounds[1]->eval(state, columns);
+    if (status != STATUS_OK) return status;
+    return (bounds[1] == nullptr) ? state.dimension(slot, rows) : state.dimension(slot, rows, columns);
 }
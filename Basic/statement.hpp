@@ -13,9 +13,11 @@
 #define _statement_h
 
 #include <string>
+#include <string_view>
 #include <sstream>
 #include "evalstate.hpp"
 #include "exp.hpp"
+#include "keyword.hpp"
 #include "Utils/tokenScanner.hpp"
 #include "program.hpp"
 #include "parser.hpp"
@@ -24,6 +26,19 @@
 
 class Program;
 
+/*
+ * Type: StatementType
+ * -------------------
+ * This enumerated type is used to differentiate the statement forms
+ * so that clients such as the compiler can inspect a parsed statement
+ * without executing it, in the same way that ExpressionType is used
+ * for expressions.
+ */
+
+enum StatementType {
+    REM_STMT, LET_STMT, PRINT_STMT, INPUT_STMT, END_STMT, GOTO_STMT, IF_STMT, DIM_STMT
+};
+
 /*
  * Class: Statement
  * ----------------
@@ -49,56 +64,85 @@ public:
 
 /*
  * Destructor: ~Statement
- * Usage: delete stmt;
- * -------------------
- * The destructor deallocates the storage for this expression.
- * It must be declared virtual to ensure that the correct subclass
- * destructor is called when deleting a statement.
+ * ----------------------
+ * Like expressions, statements are allocated in the Arena of their
+ * line together with their expressions and are never deleted, so
+ * subclasses must not own heap storage.
  */
 
     virtual ~Statement();
 
 /*
  * Method: execute
- * Usage: stmt->execute(state);
- * ----------------------------
+ * Usage: Status status = stmt->execute(state, program);
+ * -----------------------------------------------------
  * This method executes a BASIC statement.  Each of the subclasses
  * defines its own execute method that implements the necessary
  * operations.  As was true for the expression evaluator, this
  * method takes an EvalState object for looking up variables or
- * controlling the operation of the interpreter.
+ * controlling the operation of the interpreter, and returns the
+ * runtime error that stopped it, or STATUS_OK.  The errors that
+ * checkStatement in verifier.h finds are not checked again, so a
+ * statement must pass that check before it is executed.
  */
 
-    virtual void execute(EvalState &state, Program &program) = 0;
+    virtual Status execute(EvalState &state, Program &program) = 0;
+
+/*
+ * Method: getType
+ * Usage: StatementType type = stmt->getType();
+ * --------------------------------------------
+ * Returns the type of the statement, which identifies the subclass
+ * and therefore which of the subclass accessors may be applied.
+ */
+
+    virtual StatementType getType() = 0;
 
 };
 
 // REM statement (no-op)
 class RemStatement : public Statement {
 public:
-    explicit RemStatement(const std::string &comment) : comment(comment) {}
-    void execute(EvalState &state, Program &program) override;
+    explicit RemStatement(std::string_view comment) : comment(comment) {}
+    Status execute(EvalState &state, Program &program) override;
+    StatementType getType() override { return REM_STMT; }
+    std::string_view getComment() const { return comment; }
 private:
-    std::string comment;
+    std::string_view comment;
 };
 
 // LET statement
 class LetStatement : public Statement {
 public:
-    LetStatement(const std::string &name, Expression *exp) : name(name), exp(exp) {}
-    ~LetStatement() override { delete exp; }
-    void execute(EvalState &state, Program &program) override;
+    LetStatement(const std::string &name, Expression *exp)
+        : slot(SymbolTable::intern(name)), reserved(isReservedKeyword(lookupKeyword(name))), exp(exp) {}
+    LetStatement(int slot, Expression *exp, bool reserved) : slot(slot), reserved(reserved), exp(exp) {}
+    LetStatement(ArrayExp *element, Expression *exp, bool reserved)
+        : slot(element->getSlot()), reserved(reserved), exp(exp), element(element) {}
+    Status execute(EvalState &state, Program &program) override;
+    StatementType getType() override { return LET_STMT; }
+    const std::string &getName() const { return SymbolTable::getName(slot); }
+    int getSlot() const { return slot; }
+    bool isReserved() const { return reserved; }
+    Expression *getExp() const { return exp; }
+    ArrayExp *getElement() const { return element; }
+    void setExp(Expression *exp) { this->exp = exp; }
+    void setElement(ArrayExp *element) { this->element = element; }
 private:
-    std::string name;
+    int slot;
+    bool reserved;                      /* The name is a keyword        */
     Expression *exp;
+    ArrayExp *element = nullptr;        /* The target, if an element    */
 };
 
 // PRINT statement
 class PrintStatement : public Statement {
 public:
     explicit PrintStatement(Expression *exp) : exp(exp) {}
-    ~PrintStatement() override { delete exp; }
-    void execute(EvalState &state, Program &program) override;
+    Status execute(EvalState &state, Program &program) override;
+    StatementType getType() override { return PRINT_STMT; }
+    Expression *getExp() const { return exp; }
+    void setExp(Expression *exp) { this->exp = exp; }
 private:
     Expression *exp;
 };
@@ -106,24 +150,39 @@ private:
 // INPUT statement
 class InputStatement : public Statement {
 public:
-    explicit InputStatement(const std::string &name) : name(name) {}
-    void execute(EvalState &state, Program &program) override;
+    explicit InputStatement(const std::string &name)
+        : slot(SymbolTable::intern(name)), reserved(isReservedKeyword(lookupKeyword(name))) {}
+    InputStatement(int slot, bool reserved) : slot(slot), reserved(reserved) {}
+    InputStatement(ArrayExp *element, bool reserved)
+        : slot(element->getSlot()), reserved(reserved), element(element) {}
+    Status execute(EvalState &state, Program &program) override;
+    StatementType getType() override { return INPUT_STMT; }
+    const std::string &getName() const { return SymbolTable::getName(slot); }
+    int getSlot() const { return slot; }
+    bool isReserved() const { return reserved; }
+    ArrayExp *getElement() const { return element; }
+    void setElement(ArrayExp *element) { this->element = element; }
 private:
-    std::string name;
+    int slot;
+    bool reserved;                      /* The name is a keyword        */
+    ArrayExp *element = nullptr;        /* The target, if an element    */
 };
 
 // END statement
 class EndStatement : public Statement {
 public:
     EndStatement() = default;
-    void execute(EvalState &state, Program &program) override;
+    Status execute(EvalState &state, Program &program) override;
+    StatementType getType() override { return END_STMT; }
 };
 
 // GOTO statement
 class GotoStatement : public Statement {
 public:
     explicit GotoStatement(int target) : target(target) {}
-    void execute(EvalState &state, Program &program) override;
+    Status execute(EvalState &state, Program &program) override;
+    StatementType getType() override { return GOTO_STMT; }
+    int getTarget() const { return target; }
 private:
     int target;
 };
@@ -131,27 +190,63 @@ private:
 // IF ... THEN ... statement
 class IfStatement : public Statement {
 public:
-    IfStatement(Expression *lhs, std::string op, Expression *rhs, int target)
-            : lhs(lhs), op(std::move(op)), rhs(rhs), target(target) {}
-    ~IfStatement() override { delete lhs; delete rhs; }
-    void execute(EvalState &state, Program &program) override;
+    IfStatement(Expression *lhs, const std::string &op, Expression *rhs, int target)
+            : lhs(lhs), op(toRelationalOperator(op)), rhs(rhs), target(target) {}
+    IfStatement(Expression *lhs, Operator op, Expression *rhs, int target)
+            : lhs(lhs), op(op), rhs(rhs), target(target) {}
+    Status execute(EvalState &state, Program &program) override;
+    StatementType getType() override { return IF_STMT; }
+    Expression *getLHS() const { return lhs; }
+    std::string getOp() const { return operatorName(op); }
+    Operator getOperator() const { return op; }
+    Expression *getRHS() const { return rhs; }
+    int getTarget() const { return target; }
+    void setLHS(Expression *lhs) { this->lhs = lhs; }
+    void setRHS(Expression *rhs) { this->rhs = rhs; }
 private:
     Expression *lhs;
-    std::string op;
+    Operator op;
     Expression *rhs;
     int target;
 };
 
+// DIM statement
+class DimStatement : public Statement {
+public:
+    DimStatement(int slot, Expression *rowBound, Expression *columnBound = nullptr)
+        : slot(slot), bounds{rowBound, columnBound} {}
+    Status execute(EvalState &state, Program &program) override;
+    StatementType getType() override { return DIM_STMT; }
+    const std::string &getName() const { return SymbolTable::getName(slot); }
+    int getSlot() const { return slot; }
+    int getRank() const { return (bounds[1] == nullptr) ? 1 : 2; }
+    Expression *getBound(int k) const { return bounds[k]; }
+    void setBound(int k, Expression *bound) { bounds[k] = bound; }
+private:
+    int slot;
+    Expression *bounds[2];              /* Row bound, then column bound */
+};
+
+/*
+ * Function: readInputValue
+ * Usage: Status status = readInputValue(value);
+ * ---------------------------------------------
+ * Prompts with " ? " and reads lines from standard input until one
+ * holds a legal integer, which is stored in value, reporting INVALID
+ * NUMBER for each rejected line.  Returns STATUS_INVALID_NUMBER if the
+ * input is exhausted.
+ */
+
+Status readInputValue(int &value);
 
 /*
  * The remainder of this file must consists of subclass
  * definitions for the individual statement forms.  Each of
  * those subclasses must define a constructor that parses a
  * statement from a scanner and a method called execute,
- * which executes that statement.  If the private data for
- * a subclass includes data allocated on the heap (such as
- * an Expression object), the class implementation must also
- * specify its own destructor method to free that memory.
+ * which executes that statement.  Private data such as an
+ * Expression object is allocated in the same Arena as the
+ * statement, so no subclass needs a destructor of its own.
  */
 
 #endif
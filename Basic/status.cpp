@@ -0,0 +1,49 @@
+/*
+ * File: status.cpp
+ * ----------------
+ * This file implements the messages of the status codes.
+ */
+
+#include "status.hpp"
+
+/*
+ * Implementation notes: statusMessage
+ * -----------------------------------
+ * The messages are exactly those that the interpreter has always
+ * printed, including the prefixes of the messages that were raised
+ * by the library functions it used to call.
+ */
+
+const char *statusMessage(Status status) {
+    switch (status) {
+        case STATUS_OK: return "";
+        case STATUS_QUIT: return "";
+        case STATUS_SYNTAX_ERROR: return "SYNTAX ERROR";
+        case STATUS_ILLEGAL_ASSIGNMENT: return "Illegal variable in assignment";
+        case STATUS_VARIABLE_NOT_DEFINED: return "VARIABLE NOT DEFINED";
+        case STATUS_DIVIDE_BY_ZERO: return "DIVIDE BY ZERO";
+        case STATUS_INVALID_NUMBER: return "INVALID NUMBER";
+        case STATUS_ILLEGAL_TERM: return "Illegal term in expression";
+        case STATUS_UNBALANCED_PARENTHESES: return "Unbalanced parentheses in expression";
+        case STATUS_EXTRA_TOKEN: return "parseExp: Found extra token: ";
+        case STATUS_ILLEGAL_INTEGER: return "stringToInteger: Illegal integer format (";
+        case STATUS_STEP_LIMIT: return "STEP LIMIT EXCEEDED";
+        case STATUS_TIME_LIMIT: return "TIME LIMIT EXCEEDED";
+        case STATUS_LINE_NUMBER_ERROR: return "LINE NUMBER ERROR";
+        case STATUS_SUBSCRIPT_OUT_OF_RANGE: return "SUBSCRIPT OUT OF RANGE";
+        case STATUS_INVALID_DIMENSION: return "INVALID DIMENSION";
+        case STATUS_NATIVE_MEMORY: return "Cannot allocate memory for native code";
+    }
+    return "SYNTAX ERROR";
+}
+
+std::string failureMessage(const Failure &failure) {
+    std::string message = statusMessage(failure.status);
+    if (failure.status == STATUS_EXTRA_TOKEN) {
+        message.append(failure.token);
+    } else if (failure.status == STATUS_ILLEGAL_INTEGER) {
+        message.append(failure.token);
+        message += ')';
+    }
+    return message;
+}
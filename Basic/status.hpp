@@ -0,0 +1,76 @@
+/*
+ * File: status.h
+ * --------------
+ * This interface exports the status codes with which the parser, the
+ * evaluator and the virtual machine report errors to their callers.
+ * Errors travel back as return values instead of exceptions, and each
+ * code has a fixed message, so that a program or an input stream full
+ * of errors costs no more to process than one without them.  Only the
+ * session turns a status into the text that the user sees.
+ */
+
+#ifndef _status_h
+#define _status_h
+
+#include <string>
+#include <string_view>
+
+/*
+ * Type: Status
+ * ------------
+ * The outcome of parsing or executing a line.  STATUS_QUIT is not an
+ * error: it asks the session to stop.
+ */
+
+enum Status {
+    STATUS_OK,
+    STATUS_QUIT,
+    STATUS_SYNTAX_ERROR,
+    STATUS_ILLEGAL_ASSIGNMENT,
+    STATUS_VARIABLE_NOT_DEFINED,
+    STATUS_DIVIDE_BY_ZERO,
+    STATUS_INVALID_NUMBER,
+    STATUS_ILLEGAL_TERM,
+    STATUS_UNBALANCED_PARENTHESES,
+    STATUS_EXTRA_TOKEN,
+    STATUS_ILLEGAL_INTEGER,
+    STATUS_STEP_LIMIT,
+    STATUS_TIME_LIMIT,
+    STATUS_LINE_NUMBER_ERROR,
+    STATUS_SUBSCRIPT_OUT_OF_RANGE,
+    STATUS_INVALID_DIMENSION,
+    STATUS_NATIVE_MEMORY
+};
+
+/*
+ * Function: statusMessage
+ * Usage: const char *message = statusMessage(status);
+ * ---------------------------------------------------
+ * Returns the message reported for status.  For the two codes whose
+ * message quotes a token, this is the message without the token.
+ */
+
+const char *statusMessage(Status status);
+
+/*
+ * Type: Failure
+ * -------------
+ * A status together with the token its message quotes, which is a
+ * view of the input line and is empty for most codes.
+ */
+
+struct Failure {
+    Status status = STATUS_OK;
+    std::string_view token;
+};
+
+/*
+ * Function: failureMessage
+ * Usage: std::string message = failureMessage(failure);
+ * -----------------------------------------------------
+ * Returns the complete message for failure, including its token.
+ */
+
+std::string failureMessage(const Failure &failure);
+
+#endif
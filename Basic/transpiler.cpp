@@ -0,0 +1,468 @@
+/*
+ * File: transpiler.cpp
+ * --------------------
+ * This file implements the translation of BASIC programs into C++.
+ */
+
+#include <cctype>
+#include <climits>
+#include <set>
+#include <unordered_map>
+#include "transpiler.hpp"
+#include "compiler.hpp"
+#include "statement.hpp"
+#include "verifier.hpp"
+
+/*
+ * Constant: PRELUDE
+ * -----------------
+ * The support code at the top of every translation.  fail prints an
+ * error message and ends the run; the arithmetic functions wrap around
+ * and divide exactly as the interpreter does; readInput is a copy of
+ * the interpreter's INPUT handling.  dim and at create and index
+ * arrays under the same limits as EvalState, and elementCount starts
+ * out with the elements of the arrays that already exist in state.
+ */
+
+static_assert(EvalState::MAX_ELEMENTS == 16777216, "PRELUDE copies the limit on array elements");
+
+static const char *const PRELUDE = R"(#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+static void fail(const char *message) {
+    std::printf("%s\n", message);
+    std::exit(0);
+}
+
+static inline int add(int a, int b) { return (int) ((unsigned) a + (unsigned) b); }
+static inline int sub(int a, int b) { return (int) ((unsigned) a - (unsigned) b); }
+static inline int mul(int a, int b) { return (int) ((unsigned) a * (unsigned) b); }
+static inline int neg(int a) { return (int) (0u - (unsigned) a); }
+
+static inline int divide(int a, int b) {
+    if (b == 0) fail("DIVIDE BY ZERO");
+    return (b == -1) ? neg(a) : a / b;
+}
+
+struct Array {
+    std::vector<int> elements;
+    int length = 0, rows = 0, columns = 0;
+};
+
+static long long elementCount = 0;
+
+static void allocate(Array &array, long long size) {
+    long long total = elementCount - (long long) array.elements.size() + size;
+    if (total > 16777216) fail("INVALID DIMENSION");
+    std::vector<int> elements;
+    try {
+        elements.assign(size, 0);
+    } catch (const std::bad_alloc &) {
+        fail("INVALID DIMENSION");
+    }
+    array = Array();
+    array.elements.swap(elements);
+    elementCount = total;
+}
+
+static void dim(Array &array, int bound) {
+    if (bound < 0) fail("INVALID DIMENSION");
+    allocate(array, bound + 1LL);
+    array.length = bound + 1;
+}
+
+static void dim(Array &array, int rowBound, int columnBound) {
+    if (rowBound < 0 || columnBound < 0) fail("INVALID DIMENSION");
+    allocate(array, (rowBound + 1LL) * (columnBound + 1LL));
+    array.rows = rowBound + 1;
+    array.columns = columnBound + 1;
+}
+
+static inline int at(const Array &array, int row) {
+    if ((unsigned) row >= (unsigned) array.length) fail("SUBSCRIPT OUT OF RANGE");
+    return row;
+}
+
+static inline int at(const Array &array, int row, int column) {
+    if ((unsigned) row >= (unsigned) array.rows || (unsigned) column >= (unsigned) array.columns) {
+        fail("SUBSCRIPT OUT OF RANGE");
+    }
+    return row * array.columns + column;
+}
+
+static bool parseInteger(const std::string &s, int &out) {
+    if (s.empty()) return false;
+    size_t i = 0; bool negative = false;
+    if (s[0] == '+' || s[0] == '-') { negative = (s[0] == '-'); i = 1; }
+    if (i >= s.size()) return false;
+    long long val = 0;
+    for (; i < s.size(); ++i) {
+        if (s[i] < '0' || s[i] > '9') return false;
+        val = val * 10 + (s[i] - '0');
+        if (val > 2147483648LL) return false;
+    }
+    long long signedVal = negative ? -val : val;
+    if (signedVal < -2147483648LL || signedVal > 2147483647LL) return false;
+    out = (int) signedVal;
+    return true;
+}
+
+static int readInput() {
+    while (true) {
+        std::fputs(" ? ", stdout);
+        std::fflush(stdout);
+        std::string line;
+        int ch;
+        while ((ch = std::getchar()) != EOF && ch != '\n') line += (char) ch;
+        if (ch == EOF && line.empty()) fail("INVALID NUMBER");
+        size_t l = 0, r = line.size();
+        while (l < r && (line[l] == ' ' || line[l] == '\t')) ++l;
+        while (r > l && (line[r-1] == ' ' || line[r-1] == '\t')) --r;
+        int v = 0;
+        if (parseInteger(line.substr(l, r - l), v)) return v;
+        std::puts("INVALID NUMBER");
+    }
+}
+
+)";
+
+/*
+ * Class: CppEmitter
+ * -----------------
+ * Generates the body of main for one program.  Expressions are
+ * flattened into a sequence of temporaries in the interpreter's order
+ * of evaluation, because C++ leaves the order in which operands are
+ * evaluated unspecified.  Within a statement, a subexpression shared
+ * by the optimizer is computed once.
+ */
+
+class CppEmitter {
+
+public:
+
+    CppEmitter(Program &program, EvalState &state) : program(program), state(state) {}
+
+    std::string emit();
+
+private:
+
+    Program &program;
+    EvalState &state;
+    std::string code;
+    std::set<int> slots;
+    std::set<int> arraySlots;
+    std::set<int> targets;
+    std::unordered_map<Expression *, std::string> computed;
+    int nTemps = 0;
+
+    void findTargets();
+    std::string label(int lineNumber);
+    void emitStatement(Statement *stmt);
+    std::string emitExp(Expression *exp);
+    std::string emitElement(ArrayExp *element);
+    std::string newTemp(const std::string &value);
+    std::string variable(int slot);
+    std::string array(int slot);
+    std::string arrayDeclaration(int slot);
+    void line(const std::string &text) { code += "    " + text + "\n"; }
+
+};
+
+static std::string literal(int value) {
+    if (value == INT_MIN) return "(-2147483647 - 1)";
+    if (value < 0) return "(" + std::to_string(value) + ")";
+    return std::to_string(value);
+}
+
+/*
+ * Implementation notes: comment
+ * -----------------------------
+ * Variables are named after their slots, because a BASIC name may
+ * contain characters that C++ does not allow; the original name is
+ * kept in a comment when it is safe to do so.
+ */
+
+static std::string comment(const std::string &name) {
+    for (char ch : name) {
+        if (!isalnum((unsigned char) ch) && ch != '_') return "";
+    }
+    return "  /* " + name + " */";
+}
+
+static std::string quote(const char *message) {
+    return std::string("\"") + message + "\"";
+}
+
+/*
+ * Implementation notes: emit
+ * --------------------------
+ * The body is generated first so that the set of variables is known
+ * when their declarations are written.  Each line is a block of its
+ * own, so that no goto jumps past the initialization of a temporary.
+ */
+
+std::string CppEmitter::emit() {
+    findTargets();
+    int nLines = program.getLineCount();
+    for (int i = 0; i < nLines; i++) {
+        int lineNumber = program.getLineNumberAt(i);
+        if (targets.count(i)) code += "L" + std::to_string(lineNumber) + ":\n";
+        Statement *stmt = program.getStatementAt(i);
+        if (stmt == nullptr) continue;
+        code += "    {\n";
+        computed.clear();
+        emitStatement(stmt);
+        code += "    }\n";
+    }
+    if (targets.count(nLines)) code += "done:\n";
+
+    std::string out = PRELUDE;
+    out += "int main() {\n";
+    for (int slot : slots) {
+        bool defined = state.isDefined(slot);
+        std::string var = std::to_string(slot);
+        out += "    int v" + var + " = " + literal(defined ? state.getValue(slot) : 0) + ";";
+        out += " bool d" + var + " = " + (defined ? "true" : "false") + ";";
+        out += comment(SymbolTable::getName(slot)) + "\n";
+    }
+    for (int slot : arraySlots) {
+        out += arrayDeclaration(slot);
+    }
+    if (state.getElementCount() > 0) out += "    elementCount = " + std::to_string(state.getElementCount()) + ";\n";
+    out += code;
+    out += "    return 0;\n}\n";
+    return out;
+}
+
+void CppEmitter::findTargets() {
+    int nLines = program.getLineCount();
+    for (int i = 0; i < nLines; i++) {
+        Statement *stmt = program.getStatementAt(i);
+        if (stmt == nullptr) continue;
+        if (stmt->getType() == GOTO_STMT) {
+            targets.insert(program.getLineIndex(((GotoStatement *) stmt)->getTarget()));
+        } else if (stmt->getType() == IF_STMT) {
+            targets.insert(program.getLineIndex(((IfStatement *) stmt)->getTarget()));
+        }
+    }
+}
+
+/*
+ * Implementation notes: label
+ * ---------------------------
+ * A jump to a missing line continues at the next line after it, or
+ * ends the program if there is none, just as it does in the virtual
+ * machine.
+ */
+
+std::string CppEmitter::label(int lineNumber) {
+    int index = program.getLineIndex(lineNumber);
+    if (index == program.getLineCount()) return "done";
+    return "L" + std::to_string(program.getLineNumberAt(index));
+}
+
+void CppEmitter::emitStatement(Statement *stmt) {
+    Status fault = checkStatement(stmt);
+    switch (stmt->getType()) {
+        case REM_STMT:
+            break;
+        case LET_STMT: {
+            auto *let = (LetStatement *) stmt;
+            if (fault != STATUS_OK) {
+                line("fail(" + quote(statusMessage(fault)) + ");");
+                break;
+            }
+            if (let->getElement() != nullptr) {
+                std::string index = emitElement(let->getElement());
+                std::string value = emitExp(let->getExp());
+                line("a" + array(let->getSlot()) + ".elements[" + index + "] = " + value + ";");
+                break;
+            }
+            std::string value = emitExp(let->getExp());
+            std::string var = variable(let->getSlot());
+            line("v" + var + " = " + value + "; d" + var + " = true;");
+            break;
+        }
+        case PRINT_STMT:
+            line("std::printf(\"%d\\n\", " + emitExp(((PrintStatement *) stmt)->getExp()) + ");");
+            break;
+        case INPUT_STMT: {
+            auto *input = (InputStatement *) stmt;
+            if (fault != STATUS_OK) {
+                line("fail(" + quote(statusMessage(fault)) + ");");
+                break;
+            }
+            if (input->getElement() != nullptr) {
+                std::string index = emitElement(input->getElement());
+                line("a" + array(input->getSlot()) + ".elements[" + index + "] = readInput();");
+                break;
+            }
+            std::string var = variable(input->getSlot());
+            line("v" + var + " = readInput(); d" + var + " = true;");
+            break;
+        }
+        case END_STMT:
+            line("return 0;");
+            break;
+        case GOTO_STMT:
+            line("goto " + label(((GotoStatement *) stmt)->getTarget()) + ";");
+            break;
+        case IF_STMT: {
+            auto *ifStmt = (IfStatement *) stmt;
+            std::string lhs = emitExp(ifStmt->getLHS());
+            std::string rhs = emitExp(ifStmt->getRHS());
+            if (fault != STATUS_OK) {
+                line("fail(" + quote(statusMessage(fault)) + ");");
+                return;
+            }
+            const char *op;
+            switch (ifStmt->getOperator()) {
+                case EQ_OP: op = "=="; break;
+                case LT_OP: op = "<"; break;
+                case GT_OP: op = ">"; break;
+                case LE_OP: op = "<="; break;
+                case GE_OP: op = ">="; break;
+                default: op = "!="; break;
+            }
+            line("if (" + lhs + " " + op + " " + rhs + ") goto " + label(ifStmt->getTarget()) + ";");
+            break;
+        }
+        case DIM_STMT: {
+            auto *dim = (DimStatement *) stmt;
+            std::string bounds = emitExp(dim->getBound(0));
+            if (dim->getBound(1) != nullptr) bounds += ", " + emitExp(dim->getBound(1));
+            line("dim(a" + array(dim->getSlot()) + ", " + bounds + ");");
+            break;
+        }
+    }
+}
+
+/*
+ * Implementation notes: emitExp
+ * -----------------------------
+ * Returns a C++ expression without side effects that denotes the value
+ * of exp, after emitting the statements that compute it.  Variables are
+ * copied into temporaries when they are read, since a later assignment
+ * in the same expression must not change a value already read, and
+ * array elements are copied for the same reason.  An
+ * assignment that always fails yields a dummy value; the code after it
+ * is never reached.
+ */
+
+std::string CppEmitter::emitExp(Expression *exp) {
+    switch (exp->getType()) {
+        case CONSTANT:
+            return literal(((ConstantExp *) exp)->getValue());
+        case IDENTIFIER: {
+            std::string var = variable(((IdentifierExp *) exp)->getSlot());
+            line("if (!d" + var + ") fail(\"VARIABLE NOT DEFINED\");");
+            return newTemp("v" + var);
+        }
+        case ARRAY: {
+            auto *element = (ArrayExp *) exp;
+            std::string index = emitElement(element);
+            return newTemp("a" + array(element->getSlot()) + ".elements[" + index + "]");
+        }
+        case COMPOUND:
+            break;
+    }
+    auto it = computed.find(exp);
+    if (it != computed.end()) return it->second;
+    auto *compound = (CompoundExp *) exp;
+    Expression *lhs = compound->getLHS();
+    Operator op = compound->getOperator();
+    std::string result;
+    if (op == ASSIGN_OP && lhs->getType() == ARRAY) {
+        std::string index = emitElement((ArrayExp *) lhs);
+        result = emitExp(compound->getRHS());
+        line("a" + array(((ArrayExp *) lhs)->getSlot()) + ".elements[" + index + "] = " + result + ";");
+    } else if (op == ASSIGN_OP) {
+        if (lhs->getType() != IDENTIFIER) {
+            line("fail(" + quote(statusMessage(STATUS_ILLEGAL_ASSIGNMENT)) + ");");
+            return "0";
+        }
+        if (((IdentifierExp *) lhs)->getKeyword() == KEYWORD_LET) {
+            line("fail(" + quote(statusMessage(STATUS_SYNTAX_ERROR)) + ");");
+            return "0";
+        }
+        result = emitExp(compound->getRHS());
+        std::string var = variable(((IdentifierExp *) lhs)->getSlot());
+        line("v" + var + " = " + result + "; d" + var + " = true;");
+    } else if (op == SUB_OP && lhs->getType() == CONSTANT && ((ConstantExp *) lhs)->getValue() == 0) {
+        result = newTemp("neg(" + emitExp(compound->getRHS()) + ")");
+    } else {
+        std::string a = emitExp(lhs);
+        std::string b = emitExp(compound->getRHS());
+        const char *fn;
+        switch (op) {
+            case ADD_OP: fn = "add"; break;
+            case SUB_OP: fn = "sub"; break;
+            case MUL_OP: fn = "mul"; break;
+            default: fn = "divide"; break;
+        }
+        result = newTemp(std::string(fn) + "(" + a + ", " + b + ")");
+    }
+    computed[exp] = result;
+    return result;
+}
+
+/*
+ * Implementation notes: emitElement
+ * ---------------------------------
+ * Returns a temporary that holds the position of an element within
+ * its array, after both subscripts have been evaluated and checked.
+ */
+
+std::string CppEmitter::emitElement(ArrayExp *element) {
+    std::string subscripts = emitExp(element->getSubscript(0));
+    if (element->getRank() == 2) subscripts += ", " + emitExp(element->getSubscript(1));
+    return newTemp("at(a" + array(element->getSlot()) + ", " + subscripts + ")");
+}
+
+std::string CppEmitter::newTemp(const std::string &value) {
+    std::string name = "t" + std::to_string(++nTemps);
+    line("int " + name + " = " + value + ";");
+    return name;
+}
+
+std::string CppEmitter::variable(int slot) {
+    slots.insert(slot);
+    return std::to_string(slot);
+}
+
+std::string CppEmitter::array(int slot) {
+    arraySlots.insert(slot);
+    return std::to_string(slot);
+}
+
+/*
+ * Implementation notes: arrayDeclaration
+ * --------------------------------------
+ * An array that already exists in state starts out with its current
+ * shape and elements, sixteen to a line.
+ */
+
+std::string CppEmitter::arrayDeclaration(int slot) {
+    std::string name = "a" + std::to_string(slot);
+    const Array &current = state.getArray(slot);
+    std::string note = comment(SymbolTable::getName(slot)) + "\n";
+    if (current.elements == nullptr) return "    Array " + name + ";" + note;
+    int count = (current.length > 0) ? current.length : current.rows * current.columns;
+    std::string out = "    Array " + name + " = {{";
+    for (int i = 0; i < count; i++) {
+        if (i % 16 == 0) out += "\n        ";
+        out += literal(current.elements[i]);
+        if (i + 1 < count) out += ", ";
+    }
+    out += "}, " + std::to_string(current.length) + ", " + std::to_string(current.rows) + ", ";
+    out += std::to_string(current.columns) + "};" + note;
+    return out;
+}
+
+std::string translateToCpp(Program &program, EvalState &state) {
+    CppEmitter emitter(program, state);
+    return emitter.emit();
+}
@@ -0,0 +1,33 @@
+/*
+ * File: transpiler.h
+ * ------------------
+ * This interface exports the translation of a stored BASIC program
+ * into a self-contained C++ program.
+ */
+
+#ifndef _transpiler_h
+#define _transpiler_h
+
+#include <string>
+#include "evalstate.hpp"
+#include "program.hpp"
+
+/*
+ * Function: translateToCpp
+ * Usage: std::string source = translateToCpp(program, state);
+ * -----------------------------------------------------------
+ * Returns a C++ translation unit whose main function behaves exactly
+ * like a RUN of the program in the interpreter: it prints the same
+ * output, reads INPUT values from standard input with the same prompts
+ * and checks, and stops with the same error messages.  Lines become
+ * labels, GOTO and IF become goto statements and every variable
+ * becomes a local variable with a flag that records whether it has
+ * been defined.  Every array becomes a vector whose subscripts are
+ * checked on each access.  Variables and arrays that exist in state
+ * start out with their current values.  The output needs only the
+ * standard library.
+ */
+
+std::string translateToCpp(Program &program, EvalState &state);
+
+#endif
@@ -0,0 +1,75 @@
+/*
+ * File: verifier.cpp
+ * ------------------
+ * This file implements the verifier.h interface.
+ */
+
+#include "verifier.hpp"
+
+/* Private function prototypes */
+
+static bool isRelational(Operator op);
+static bool hasLine(Program &program, int lineNumber);
+
+/*
+ * Implementation notes: checkStatement
+ * ------------------------------------
+ * Whether a variable name is reserved is decided when the statement
+ * is built, so the check reads a flag and never looks at the name.
+ */
+
+Status checkStatement(Statement *stmt) {
+    switch (stmt->getType()) {
+        case LET_STMT:
+            return ((LetStatement *) stmt)->isReserved() ? STATUS_SYNTAX_ERROR : STATUS_OK;
+        case INPUT_STMT:
+            return ((InputStatement *) stmt)->isReserved() ? STATUS_SYNTAX_ERROR : STATUS_OK;
+        case IF_STMT:
+            return isRelational(((IfStatement *) stmt)->getOperator()) ? STATUS_OK : STATUS_SYNTAX_ERROR;
+        default:
+            return STATUS_OK;
+    }
+}
+
+/*
+ * Implementation notes: verifyProgram
+ * -----------------------------------
+ * The lines are visited in order through the program's line index,
+ * and each jump target is looked up through the same index, so the
+ * whole program is checked in O(N log N) time.
+ */
+
+std::vector<Diagnostic> verifyProgram(Program &program) {
+    std::vector<Diagnostic> problems;
+    int nLines = program.getLineCount();
+    for (int i = 0; i < nLines; i++) {
+        int lineNumber = program.getLineNumberAt(i);
+        Statement *stmt = program.getStatementAt(i);
+        if (stmt == nullptr) {
+            problems.push_back({lineNumber, STATUS_SYNTAX_ERROR});
+            continue;
+        }
+        Status fault = checkStatement(stmt);
+        if (fault != STATUS_OK) {
+            problems.push_back({lineNumber, fault});
+            continue;
+        }
+        int target;
+        switch (stmt->getType()) {
+            case GOTO_STMT: target = ((GotoStatement *) stmt)->getTarget(); break;
+            case IF_STMT: target = ((IfStatement *) stmt)->getTarget(); break;
+            default: continue;
+        }
+        if (!hasLine(program, target)) problems.push_back({lineNumber, STATUS_LINE_NUMBER_ERROR});
+    }
+    return problems;
+}
+
+static bool isRelational(Operator op) {
+    return op == EQ_OP || op == NE_OP || op == LT_OP || op == GT_OP || op == LE_OP || op == GE_OP;
+}
+
+static bool hasLine(Program &program, int lineNumber) {
+    int index = program.getLineIndex(lineNumber);
+    return index < program.getLineCount() && program.getLineNumberAt(index) == lineNumber;
+}
@@ -0,0 +1,57 @@
+/*
+ * File: verifier.h
+ * ----------------
+ * This interface exports the static checks of stored programs: the
+ * errors that a statement is bound to raise whatever the values of
+ * the variables, and the jumps to lines that do not exist.
+ */
+
+#ifndef _verifier_h
+#define _verifier_h
+
+#include <vector>
+#include "program.hpp"
+#include "statement.hpp"
+#include "status.hpp"
+
+/*
+ * Function: checkStatement
+ * Usage: Status fault = checkStatement(stmt);
+ * -------------------------------------------
+ * Returns the error that stmt raises on every execution, or STATUS_OK.
+ * A LET or INPUT statement whose variable is a reserved word raises
+ * STATUS_SYNTAX_ERROR before doing anything else, and an IF statement
+ * whose operator is not relational raises it once both operands have
+ * been evaluated.  Statement::execute assumes the check has been made,
+ * so callers must not execute a statement for which it fails.
+ */
+
+Status checkStatement(Statement *stmt);
+
+/*
+ * Type: Diagnostic
+ * ----------------
+ * A problem found in a stored program, and the line it is on.
+ */
+
+struct Diagnostic {
+    int lineNumber;
+    Status status;
+};
+
+/*
+ * Function: verifyProgram
+ * Usage: std::vector<Diagnostic> problems = verifyProgram(program);
+ * -----------------------------------------------------------------
+ * Checks every line of the program without running it and returns
+ * the problems in line order.  A line that did not parse is reported
+ * as STATUS_SYNTAX_ERROR, a statement for which checkStatement fails
+ * with that error, and a GOTO or IF statement whose target is not a
+ * line of the program as STATUS_LINE_NUMBER_ERROR.  RUN skips the
+ * first kind of line and continues after a missing target, so none of
+ * these stop a program unless it reaches a failing statement.
+ */
+
+std::vector<Diagnostic> verifyProgram(Program &program);
+
+#endif
@@ -0,0 +1,311 @@
+/*
+ * File: vm.cpp
+ * ------------
+ * This file implements the bytecode virtual machine.
+ */
+
+#include <climits>
+#include <ctime>
+#include <mutex>
+#include "vm.hpp"
+#include "io.hpp"
+#include "statement.hpp"
+
+static long long clockMillis() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+/*
+ * Implementation notes: stopRun
+ * -----------------------------
+ * A run stopped by one of its limits may well have been producing
+ * output all along, so everything it printed is written out before
+ * the error is reported.
+ */
+
+static Status stopRun(Status status) {
+    flushOutput();
+    return status;
+}
+
+Status VM::run(const Bytecode &bytecode, EvalState &state) {
+    stack.assign(bytecode.maxStack + 1, 0);
+    temps.assign(bytecode.tempCount + 1, 0);
+    state.bind(bytecode.slots);
+    if (profile == nullptr) return execute<false>(bytecode, state);
+    profile->start(bytecode);
+    Status status;
+    if (profile->getMode() == PROFILE_SAMPLE) {
+        status = execute<true>(bytecode, state);
+        Profile::position = nullptr;
+    } else {
+        status = execute<false>(bytecode, state);
+    }
+    profile->stop();
+    return status;
+}
+
+/*
+ * Implementation notes: execute
+ * -----------------------------
+ * The dispatch loop keeps the instruction and stack pointers in local
+ * variables.  Arithmetic is carried out on unsigned values so that
+ * overflow wraps around in the same way on every path instead of
+ * being undefined behavior.  Division by -1 is a negation for the
+ * same reason, since INT_MIN / -1 would otherwise trap.
+ *
+ * Every taken jump to an earlier instruction closes a loop and counts
+ * against the hotness budget.  When the budget runs out, the rest of
+ * the run continues in native code from the jump target, which starts
+ * a line and therefore finds the operand stack empty.  If no native
+ * code can be had, the run simply stays in the loop.  Without the
+ * native tier, the same countdown schedules the checks of the time
+ * limit.
+ *
+ * Steps are charged a block at a time: each taken jump subtracts the
+ * instructions executed since the previous jump target, and only jumps
+ * that close a loop check the balance.  Any run that does not end must
+ * keep closing loops, so the limit is enforced without touching the
+ * instructions that do not jump.
+ *
+ * The sampled version of the loop publishes, for the profiler's timer
+ * signal, the instruction at which it starts, each jump target and
+ * the instruction after each conditional jump, so that what runs is
+ * always a straight line from the published instruction.  Publishing
+ * every instruction slowed some programs by as much as a quarter.  The
+ * other version is unaffected by profiling apart from the OP_LINE
+ * instructions that only appear in code compiled for exact profiling.
+ *
+ * The array instructions are carried out by executeArrayOp.  Any of
+ * them written out in the loop changed how registers were assigned to
+ * the scalar instructions, and slowed programs without arrays by as
+ * much as a third.  runNative is kept out of line for the same reason.
+ *
+ * Both versions are aligned to a cache line in vm.hpp.  The speed of
+ * the dispatch loop otherwise depends on where the linker happens to
+ * place it, and shifted by as much as a fifth from one build to the
+ * next as unrelated code changed size.
+ */
+
+#define JUMP(target) \
+    do { \
+        steps -= ip - block; \
+        if ((target) < ip - code) { \
+            if (steps < 0) return stopRun(STATUS_STEP_LIMIT); \
+            if (--countdown == 0) { \
+                if (native) { \
+                    Status result; \
+                    if (runNative(bytecode, state, (target), result)) return result; \
+                    native = false; \
+                } \
+                if (clockMillis() >= deadline) return stopRun(STATUS_TIME_LIMIT); \
+                countdown = TIME_POLL; \
+            } \
+        } \
+        ip = block = code + (target); \
+        if (SAMPLED) Profile::position = ip; \
+    } while (false)
+
+#define BRANCH(condition, target) \
+    do { \
+        if (condition) { \
+            JUMP(target); \
+        } else if (SAMPLED) { \
+            Profile::position = ip; \
+        } \
+    } while (false)
+
+template <bool SAMPLED>
+Status VM::execute(const Bytecode &bytecode, EvalState &state) {
+    const Instruction *code = bytecode.code.data();
+    const Instruction *ip = code;
+    const Instruction *block = code;
+    int *sp = stack.data();
+    int *tmp = temps.data();
+    bool native = nativeEnabled && profile == nullptr && stepLimit < 0 && timeLimit < 0
+                  && NativeCode::isSupported();
+    long long countdown = native ? HOT_LOOP : (timeLimit >= 0) ? TIME_POLL : -1;
+    long long steps = (stepLimit >= 0) ? stepLimit : LLONG_MAX;
+    long long deadline = (timeLimit >= 0) ? clockMillis() + timeLimit : LLONG_MAX;
+    int *vars = state.values.data();
+    char *def = state.defined.data();
+    if (SAMPLED) Profile::position = ip;
+    while (true) {
+        const Instruction &in = *ip++;
+        switch (in.op) {
+            case OP_PUSH:
+                *sp++ = in.operand;
+                break;
+            case OP_LOAD:
+                if (!def[in.operand]) return STATUS_VARIABLE_NOT_DEFINED;
+                *sp++ = vars[in.operand];
+                break;
+            case OP_LOAD_SAFE:
+                *sp++ = vars[in.operand];
+                break;
+            case OP_STORE:
+                vars[in.operand] = *--sp;
+                def[in.operand] = 1;
+                break;
+            case OP_SET:
+                vars[in.operand] = sp[-1];
+                def[in.operand] = 1;
+                break;
+            case OP_ADD:
+                --sp;
+                sp[-1] = (int) ((unsigned) sp[-1] + (unsigned) sp[0]);
+                break;
+            case OP_SUB:
+                --sp;
+                sp[-1] = (int) ((unsigned) sp[-1] - (unsigned) sp[0]);
+                break;
+            case OP_MUL:
+                --sp;
+                sp[-1] = (int) ((unsigned) sp[-1] * (unsigned) sp[0]);
+                break;
+            case OP_DIV:
+                --sp;
+                if (sp[0] == 0) return STATUS_DIVIDE_BY_ZERO;
+                sp[-1] = (sp[0] == -1) ? (int) (0u - (unsigned) sp[-1]) : sp[-1] / sp[0];
+                break;
+            case OP_NEG:
+                sp[-1] = (int) (0u - (unsigned) sp[-1]);
+                break;
+            case OP_SAVE:
+                tmp[in.operand] = sp[-1];
+                break;
+            case OP_RECALL:
+                *sp++ = tmp[in.operand];
+                break;
+            case OP_JUMP:
+                JUMP(in.operand);
+                break;
+            case OP_JUMP_EQ:
+                sp -= 2;
+                BRANCH(sp[0] == sp[1], in.operand);
+                break;
+            case OP_JUMP_NE:
+                sp -= 2;
+                BRANCH(sp[0] != sp[1], in.operand);
+                break;
+            case OP_JUMP_LT:
+                sp -= 2;
+                BRANCH(sp[0] < sp[1], in.operand);
+                break;
+            case OP_JUMP_GT:
+                sp -= 2;
+                BRANCH(sp[0] > sp[1], in.operand);
+                break;
+            case OP_JUMP_LE:
+                sp -= 2;
+                BRANCH(sp[0] <= sp[1], in.operand);
+                break;
+            case OP_JUMP_GE:
+                sp -= 2;
+                BRANCH(sp[0] >= sp[1], in.operand);
+                break;
+            case OP_PRINT:
+                writeInteger(*--sp);
+                endLine();
+                break;
+            case OP_INPUT: {
+                Status status = readInputValue(vars[in.operand]);
+                if (status != STATUS_OK) return status;
+                def[in.operand] = 1;
+                break;
+            }
+            case OP_DIM: case OP_DIM2: case OP_INDEX: case OP_INDEX2: case OP_INDEX2_SAFE:
+            case OP_LOAD_ELEM: case OP_STORE_ELEM: case OP_SET_ELEM: case OP_INPUT_ELEM: {
+                Status status = executeArrayOp(in, sp, state);
+                if (status != STATUS_OK) return status;
+                sp -= ARRAY_POPS[in.op - OP_DIM];
+                break;
+            }
+            case OP_END:
+                return STATUS_OK;
+            case OP_FAIL:
+                return (Status) in.operand;
+            case OP_LINE:
+                profile->enterLine(in.operand);
+                break;
+        }
+    }
+}
+
+#undef JUMP
+
+/*
+ * Implementation notes: executeArrayOp
+ * ------------------------------------
+ * The operands are the entries just below sp.  Results are written
+ * where the operands started, and the caller pops the number of
+ * entries given in ARRAY_POPS.  All slots of the program are reserved
+ * before it starts, so DIM replaces the elements of an array without
+ * ever moving the Array records themselves.
+ */
+
+const int VM::ARRAY_POPS[] = {1, 2, 0, 1, 1, 0, 2, 1, 1};
+static_assert(OP_INPUT_ELEM - OP_DIM == 8, "ARRAY_POPS follows the order of the array opcodes");
+
+Status VM::executeArrayOp(const Instruction &in, int *sp, EvalState &state) {
+    Array &array = state.arrays[in.operand];
+    switch (in.op) {
+        case OP_DIM:
+            return state.dimensionAt(in.operand, sp[-1]);
+        case OP_DIM2:
+            return state.dimensionAt(in.operand, sp[-2], sp[-1]);
+        case OP_INDEX:
+            if ((unsigned) sp[-1] >= (unsigned) array.length) return STATUS_SUBSCRIPT_OUT_OF_RANGE;
+            return STATUS_OK;
+        case OP_INDEX2:
+            if ((unsigned) sp[-2] >= (unsigned) array.rows) return STATUS_SUBSCRIPT_OUT_OF_RANGE;
+            if ((unsigned) sp[-1] >= (unsigned) array.columns) return STATUS_SUBSCRIPT_OUT_OF_RANGE;
+            sp[-2] = sp[-2] * array.columns + sp[-1];
+            return STATUS_OK;
+        case OP_INDEX2_SAFE:
+            sp[-2] = sp[-2] * array.columns + sp[-1];
+            return STATUS_OK;
+        case OP_LOAD_ELEM:
+            sp[-1] = array.elements[sp[-1]];
+            return STATUS_OK;
+        case OP_STORE_ELEM:
+            array.elements[sp[-2]] = sp[-1];
+            return STATUS_OK;
+        case OP_SET_ELEM:
+            array.elements[sp[-2]] = sp[-1];
+            sp[-2] = sp[-1];
+            return STATUS_OK;
+        default:
+            return readInputValue(array.elements[sp[-1]]);
+    }
+}
+
+/*
+ * Implementation notes: runNative
+ * -------------------------------
+ * The translation is made once for each Bytecode and shared by every
+ * run of it, on any thread, so the lock is held only while it is made
+ * or looked up.  The native tier is optional: if the translation fails,
+ * for example because executable memory is refused, runNative returns
+ * false and the caller carries on in the virtual machine.
+ */
+
+static std::mutex nativeLock;
+
+bool VM::runNative(const Bytecode &bytecode, EvalState &state, int entry, Status &status) {
+    std::shared_ptr<const NativeCode> code;
+    {
+        std::lock_guard<std::mutex> guard(nativeLock);
+        if (!bytecode.nativeTried) {
+            bytecode.nativeTried = true;
+            auto compiled = std::make_shared<NativeCode>();
+            if (compiled->compile(bytecode) == STATUS_OK) bytecode.native = std::move(compiled);
+        }
+        code = bytecode.native;
+    }
+    if (code == nullptr) return false;
+    status = code->run(entry, state, temps.data(), stack.data());
+    return true;
+}
@@ -0,0 +1,117 @@
+/*
+ * File: vm.h
+ * ----------
+ * This interface exports the virtual machine that executes the
+ * bytecode produced by the compiler in compiler.h.  It replaces the
+ * statement-by-statement interpretation of a stored program when the
+ * RUN command is issued.
+ */
+
+#ifndef _vm_h
+#define _vm_h
+
+#include <vector>
+#include "compiler.hpp"
+#include "evalstate.hpp"
+#include "jit.hpp"
+#include "profiler.hpp"
+
+/*
+ * Class: VM
+ * ---------
+ * This class runs compiled BASIC programs.  The machine reads and
+ * writes the slot arrays of the EvalState directly, so variables
+ * assigned by the program remain visible after it stops, whether
+ * normally or because of an error.
+ */
+
+class VM {
+
+public:
+
+/*
+ * Method: run
+ * Usage: Status status = vm.run(bytecode, state);
+ * -----------------------------------------------
+ * Executes the bytecode from its first instruction until it reaches
+ * OP_END or a runtime error, which is returned.
+ */
+
+    Status run(const Bytecode &bytecode, EvalState &state);
+
+/*
+ * Method: setNativeEnabled
+ * Usage: vm.setNativeEnabled(flag);
+ * ---------------------------------
+ * Enables or disables the native code tier.  When it is enabled and
+ * the platform supports it, the machine translates the program into
+ * machine code as soon as one of its loops has gone round HOT_LOOP
+ * times, and continues the run in that code.  The translation is kept
+ * with the bytecode for later runs.  If it cannot be made, the run
+ * continues in the virtual machine.  Runs with a step or time limit
+ * stay in the virtual machine, which enforces the limits.
+ */
+
+    void setNativeEnabled(bool flag) { nativeEnabled = flag; }
+
+    static const int HOT_LOOP = 1000;
+
+/*
+ * Method: setProfile
+ * Usage: vm.setProfile(&profile);
+ * -------------------------------
+ * Measures the next runs in profile, or stops profiling if profile
+ * is nullptr.  In exact mode, the bytecode must have been compiled
+ * with line markers.  Profiled runs never switch to native code, so
+ * that every line is measured.
+ */
+
+    void setProfile(Profile *profile) { this->profile = profile; }
+
+/*
+ * Method: setStepLimit
+ * Usage: vm.setStepLimit(steps);
+ * ------------------------------
+ * Limits each run to the given number of bytecode instructions, or
+ * removes the limit if steps is negative.  A run that goes over the
+ * limit stops with STATUS_STEP_LIMIT.  The limit is only
+ * checked when a loop closes, so a run may execute up to one pass of
+ * straight-line code beyond it.
+ */
+
+    void setStepLimit(long long steps) { stepLimit = steps; }
+
+/*
+ * Method: setTimeLimit
+ * Usage: vm.setTimeLimit(milliseconds);
+ * -------------------------------------
+ * Limits the wall-clock time of each run, or removes the limit if
+ * milliseconds is negative.  A run that goes over the limit stops with
+ * STATUS_TIME_LIMIT.  The clock is read once every TIME_POLL loop
+ * iterations, and time spent waiting for INPUT counts.
+ */
+
+    void setTimeLimit(long long milliseconds) { timeLimit = milliseconds; }
+
+    static const int TIME_POLL = 4096;
+
+private:
+
+    std::vector<int> stack;
+    std::vector<int> temps;
+    bool nativeEnabled = false;
+    Profile *profile = nullptr;
+    long long stepLimit = -1;
+    long long timeLimit = -1;
+
+    template <bool SAMPLED>
+    __attribute__((aligned(64))) Status execute(const Bytecode &bytecode, EvalState &state);
+    __attribute__((noinline)) bool runNative(const Bytecode &bytecode, EvalState &state, int entry,
+                                             Status &status);
+    __attribute__((noinline)) static Status executeArrayOp(const Instruction &in, int *sp, EvalState &state);
+
+    static const int ARRAY_POPS[];
+
+};
+
+#endif
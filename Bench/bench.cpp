@@ -0,0 +1,368 @@
+/*
+ * File: bench.cpp
+ * ---------------
+ * This file implements basic_bench, the benchmark suite of the BASIC
+ * interpreter.  It runs a fixed set of generated workloads through
+ * interpreter sessions in this process and reports their throughput,
+ * the latency of single commands and the peak memory use.  Every
+ * workload is generated from a seed, so two builds given the same
+ * options measure exactly the same programs.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "generator.hpp"
+#include "io.hpp"
+#include "session.hpp"
+#include "Utils/error.hpp"
+
+/*
+ * Type: BenchOptions
+ * ------------------
+ * The settings taken from the command line.
+ */
+
+struct BenchOptions {
+    double scale = 1;                   /* Multiplies all iteration counts */
+    int lines = 100000;                 /* Size of the large program       */
+    int repeat = 5;                     /* Timed runs per RUN workload     */
+    unsigned seed = 1;                  /* Seed of every generator         */
+    SessionOptions session;             /* How sessions run programs       */
+    std::vector<std::string> only;      /* Workloads to run, or all        */
+};
+
+/*
+ * Class: SinkChannel
+ * ------------------
+ * A channel that counts the characters the interpreter prints and
+ * otherwise discards them, so that output costs the same in every
+ * workload and never grows the memory footprint.
+ */
+
+class SinkChannel : public Channel {
+
+public:
+
+    void write(std::string_view data) override { written += data.size(); }
+
+    bool readLine(std::string_view &) override { return false; }
+
+    size_t written = 0;
+
+};
+
+/* Function prototypes */
+
+static bool parseOptions(int argc, char *argv[], BenchOptions &options);
+static bool isSelected(const BenchOptions &options, const std::string &name);
+static bool runInChild(const char *programName, const std::function<void()> &workload);
+static void benchRun(const BenchOptions &options, const std::string &name, const GeneratedProgram &program);
+static void benchProgram(const BenchOptions &options);
+static void benchRepl(const BenchOptions &options);
+static void loadProgram(Session &session, const std::string &text, std::vector<double> *latencies = nullptr);
+static double timeSeconds(const std::function<void()> &fn);
+static void reportRate(const std::string &name, const std::string &what, double seconds, double count,
+                       const char *unit);
+static void reportLatency(const std::string &name, const std::string &what, std::vector<double> &latencies);
+static void reportMemory(const std::string &name);
+
+/* Main program */
+
+int main(int argc, char *argv[]) {
+    BenchOptions options;
+    if (!parseOptions(argc, argv, options)) return 1;
+    int iterations = std::max(1, (int) (1000000 * options.scale));
+    std::vector<std::pair<std::string, std::function<void()>>> workloads = {
+        {"loop", [&] { benchRun(options, "loop", generateLoop(10 * iterations)); }},
+        {"nested", [&] { benchRun(options, "nested", generateNestedLoop(iterations, 64, options.seed)); }},
+        {"variables", [&] {
+            benchRun(options, "variables", generateVariableLoop(iterations / 4, 4096, options.seed));
+        }},
+        {"sieve", [&] { benchRun(options, "sieve", generateSieve(iterations)); }},
+        {"program", [&] { benchProgram(options); }},
+        {"repl", [&] { benchRepl(options); }},
+    };
+    std::printf("%-10s %-14s %12s %16s\n", "workload", "measure", "time", "rate");
+    for (const auto &workload : workloads) {
+        if (isSelected(options, workload.first) && !runInChild(argv[0], workload.second)) return 1;
+    }
+    return 0;
+}
+
+/*
+ * Function: parseOptions
+ * Usage: if (!parseOptions(argc, argv, options)) return 1;
+ * --------------------------------------------------------
+ * Processes the command line and returns false after printing a
+ * message if it is not valid.  The option --scale=F multiplies the
+ * iteration counts of the loops, --lines=N sets the size of the large
+ * program, --repeat=N the number of timed runs of each loop and
+ * --seed=N the seed of the generators.  The option --jit enables the
+ * native tier of the interpreter.  Any other arguments name the
+ * workloads to run, which are loop, nested, variables, sieve, program
+ * and repl; without them all workloads run.
+ */
+
+static bool parseOptions(int argc, char *argv[], BenchOptions &options) {
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (strncmp(arg, "--scale=", 8) == 0 && atof(arg + 8) > 0) {
+            options.scale = atof(arg + 8);
+        } else if (strncmp(arg, "--lines=", 8) == 0 && atoi(arg + 8) > 0) {
+            options.lines = atoi(arg + 8);
+        } else if (strncmp(arg, "--repeat=", 9) == 0 && atoi(arg + 9) > 0) {
+            options.repeat = atoi(arg + 9);
+        } else if (strncmp(arg, "--seed=", 7) == 0 && arg[7] != '\0') {
+            options.seed = (unsigned) strtoul(arg + 7, nullptr, 10);
+        } else if (strcmp(arg, "--jit") == 0) {
+            options.session.nativeEnabled = true;
+        } else if (arg[0] != '-') {
+            options.only.push_back(arg);
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--scale=F] [--lines=N] [--repeat=N] [--seed=N] [--jit]"
+                      << " [loop|nested|variables|sieve|program|repl...]" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool isSelected(const BenchOptions &options, const std::string &name) {
+    return options.only.empty() || std::find(options.only.begin(), options.only.end(), name) != options.only.end();
+}
+
+/*
+ * Implementation notes: runInChild
+ * --------------------------------
+ * Every workload runs in a child process, so that it starts from the
+ * same empty interpreter state and its peak memory use is its own.
+ * The child prints its results itself; standard output is flushed on
+ * both sides of the fork so that no buffered line is printed twice.
+ * Returns false if the workload failed.
+ */
+
+static bool runInChild(const char *programName, const std::function<void()> &workload) {
+    std::fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        std::perror(programName);
+        return false;
+    }
+    if (pid == 0) {
+        SinkChannel sink;
+        setChannel(&sink);
+        int code = 0;
+        try {
+            workload();
+        } catch (ErrorException &ex) {
+            std::fflush(stdout);
+            std::cerr << programName << ": workload failed: " << ex.getMessage() << std::endl;
+            code = 1;
+        }
+        setChannel(nullptr);
+        std::fflush(stdout);
+        _exit(code);
+    }
+    int status;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) return false;
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/*
+ * Implementation notes: benchRun
+ * ------------------------------
+ * Each run uses a fresh session, so every run starts with no variables.
+ * Only RUN itself is timed.  The median run determines the reported
+ * throughput, and the fastest run is shown beside it.
+ */
+
+static void benchRun(const BenchOptions &options, const std::string &name, const GeneratedProgram &program) {
+    std::vector<double> times;
+    for (int i = 0; i < options.repeat; i++) {
+        Session session(options.session);
+        loadProgram(session, program.text);
+        times.push_back(timeSeconds([&] { session.processLine("RUN"); }));
+    }
+    std::sort(times.begin(), times.end());
+    reportRate(name, "RUN median", times[times.size() / 2], (double) program.statements, "stmt/s");
+    reportRate(name, "RUN best", times[0], (double) program.statements, "stmt/s");
+    reportMemory(name);
+}
+
+/*
+ * Implementation notes: benchProgram
+ * ----------------------------------
+ * Measures the commands that work on the program as a whole on one
+ * large random program: entering it line by line, LIST, RUN, editing
+ * it in place and CLEAR.  The edits replace every tenth line by the
+ * same line of a second random program and delete every hundredth
+ * line.  The latency of every line entered or edited is recorded.
+ */
+
+static void benchProgram(const BenchOptions &options) {
+    ProgramShape shape;
+    shape.lines = options.lines;
+    shape.variables = 64;
+    shape.depth = 3;
+    shape.seed = options.seed;
+    GeneratedProgram program = generateProgram(shape);
+    Session session(options.session);
+    std::vector<double> latencies;
+    double seconds = timeSeconds([&] { loadProgram(session, program.text, &latencies); });
+    reportRate("program", "enter", seconds, shape.lines, "line/s");
+    reportLatency("program", "enter line", latencies);
+    seconds = timeSeconds([&] { session.processLine("LIST"); });
+    reportRate("program", "LIST", seconds, shape.lines, "line/s");
+    seconds = timeSeconds([&] { session.processLine("RUN"); });
+    reportRate("program", "RUN", seconds, shape.lines, "line/s");
+
+    shape.seed = options.seed + 1;
+    GeneratedProgram edits = generateProgram(shape);
+    std::string editText;
+    size_t start = 0;
+    for (int i = 0; start < edits.text.size(); i++) {
+        size_t end = edits.text.find('\n', start);
+        std::string_view line(edits.text.data() + start, end - start);
+        if (i % 10 == 3) {
+            editText.append(line);
+            editText += '\n';
+        } else if (i % 100 == 7) {
+            editText.append(line.substr(0, line.find(' ')));
+            editText += '\n';
+        }
+        start = end + 1;
+    }
+    latencies.clear();
+    seconds = timeSeconds([&] { loadProgram(session, editText, &latencies); });
+    reportRate("program", "edit", seconds, (double) latencies.size(), "line/s");
+    reportLatency("program", "edit line", latencies);
+    seconds = timeSeconds([&] { session.processLine("CLEAR"); });
+    reportRate("program", "CLEAR", seconds, shape.lines, "line/s");
+    reportMemory("program");
+}
+
+/*
+ * Implementation notes: benchRepl
+ * -------------------------------
+ * The commands are the LET, PRINT and REM statements of a random
+ * program, entered without their line numbers, which makes a long
+ * interactive session in which every variable is assigned before it
+ * is read.
+ */
+
+static void benchRepl(const BenchOptions &options) {
+    ProgramShape shape;
+    shape.lines = std::max(1, (int) (100000 * options.scale));
+    shape.variables = 64;
+    shape.depth = 3;
+    shape.seed = options.seed;
+    GeneratedProgram program = generateProgram(shape);
+    std::vector<std::string> commands;
+    size_t start = 0;
+    while (start < program.text.size()) {
+        size_t end = program.text.find('\n', start);
+        std::string command = program.text.substr(start, end - start);
+        command.erase(0, command.find(' ') + 1);
+        if (command.compare(0, 3, "LET") == 0 || command.compare(0, 5, "PRINT") == 0
+            || command.compare(0, 3, "REM") == 0) {
+            commands.push_back(command);
+        }
+        start = end + 1;
+    }
+    Session session(options.session);
+    std::vector<double> latencies;
+    double seconds = timeSeconds([&] {
+        for (const std::string &command : commands) {
+            latencies.push_back(timeSeconds([&] { session.processLine(command); }));
+        }
+    });
+    reportRate("repl", "commands", seconds, (double) commands.size(), "cmd/s");
+    reportLatency("repl", "command", latencies);
+    reportMemory("repl");
+}
+
+/*
+ * Function: loadProgram
+ * Usage: loadProgram(session, text);
+ *        loadProgram(session, text, &latencies);
+ * ----------------------------------------------
+ * Enters every line of text into the session.  If latencies is not
+ * nullptr, the time taken by each line is appended to it.  A line the
+ * session rejects fails the workload.
+ */
+
+static void loadProgram(Session &session, const std::string &text, std::vector<double> *latencies) {
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = text.find('\n', start);
+        if (end == std::string::npos) end = text.size();
+        std::string_view line(text.data() + start, end - start);
+        Status status;
+        if (latencies == nullptr) {
+            status = session.processLine(line);
+        } else {
+            latencies->push_back(timeSeconds([&] { status = session.processLine(line); }));
+        }
+        if (status != STATUS_OK) error(std::string(statusMessage(status)) + ": " + std::string(line));
+        start = end + 1;
+    }
+}
+
+static double timeSeconds(const std::function<void()> &fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void reportRate(const std::string &name, const std::string &what, double seconds, double count,
+                       const char *unit) {
+    double rate = seconds > 0 ? count / seconds : 0;
+    std::printf("%-10s %-14s %9.3f ms %12.3f M %s\n", name.c_str(), what.c_str(), seconds * 1e3, rate / 1e6, unit);
+}
+
+/*
+ * Implementation notes: reportLatency
+ * -----------------------------------
+ * Percentiles are taken by the nearest-rank method on the sorted
+ * latencies.
+ */
+
+static void reportLatency(const std::string &name, const std::string &what, std::vector<double> &latencies) {
+    if (latencies.empty()) return;
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) {
+        size_t rank = (size_t) (p / 100 * (double) latencies.size());
+        return latencies[std::min(rank, latencies.size() - 1)] * 1e6;
+    };
+    std::printf("%-10s %-14s p50 %.2f us  p90 %.2f us  p99 %.2f us  max %.2f us\n", name.c_str(), what.c_str(),
+                percentile(50), percentile(90), percentile(99), latencies.back() * 1e6);
+}
+
+/*
+ * Implementation notes: reportMemory
+ * ----------------------------------
+ * The peak resident set size belongs to the whole process.  Since
+ * every workload runs in a process of its own, it is the peak of that
+ * workload alone, together with the small footprint of the benchmark
+ * itself.
+ */
+
+static void reportMemory(const std::string &name) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    std::printf("%-10s %-14s %9.1f MB\n", name.c_str(), "peak RSS", usage.ru_maxrss / 1024.0);
+}
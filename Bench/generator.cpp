@@ -0,0 +1,251 @@
+/*
+ * File: generator.cpp
+ * -------------------
+ * This file implements the generators of synthetic BASIC programs.
+ */
+
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "generator.hpp"
+
+/* Constants */
+
+static const int LINE_STEP = 10;
+static const int MAX_CONSTANT = 99;
+static const int BODY_STATEMENTS = 16;
+
+/* Private function prototypes */
+
+static void addLine(std::string &text, int lineNumber, const std::string &statement);
+static std::string variableName(int index);
+static std::string randomTerm(std::mt19937 &random, int variables);
+static std::string randomExpression(std::mt19937 &random, int operators, int variables);
+static std::string randomOperator(std::mt19937 &random);
+static int randomInt(std::mt19937 &random, int low, int high);
+
+/*
+ * Implementation notes: generateLoop
+ * ----------------------------------
+ * The loop counts i up to iterations, so RUN executes the initial LET
+ * and then one LET and one IF per iteration.
+ */
+
+GeneratedProgram generateLoop(int iterations) {
+    GeneratedProgram program;
+    addLine(program.text, 10, "LET i = 0");
+    addLine(program.text, 20, "LET i = i + 1");
+    addLine(program.text, 30, "IF i < " + std::to_string(iterations) + " THEN 20");
+    program.statements = 1 + 2LL * std::max(iterations, 1);
+    return program;
+}
+
+/*
+ * Implementation notes: generateNestedLoop
+ * ----------------------------------------
+ * The expression is a chain of additions and subtractions in which
+ * every level adds one operand, either the loop counter or a small
+ * constant, on a randomly chosen side.  Its value is therefore at
+ * most depth + 1 times the iteration count in size.
+ */
+
+GeneratedProgram generateNestedLoop(int iterations, int depth, unsigned seed) {
+    std::mt19937 random(seed);
+    std::string exp = "i";
+    for (int level = 0; level < depth; level++) {
+        std::string leaf = randomInt(random, 0, 2) == 0 ? "i" : std::to_string(randomInt(random, 1, 9));
+        if (randomInt(random, 0, 1) == 0) {
+            exp = "(" + exp + randomOperator(random) + leaf + ")";
+        } else {
+            exp = "(" + leaf + randomOperator(random) + exp + ")";
+        }
+    }
+    GeneratedProgram program;
+    addLine(program.text, 10, "LET i = 0");
+    addLine(program.text, 20, "LET x = " + exp);
+    addLine(program.text, 30, "LET i = i + 1");
+    addLine(program.text, 40, "IF i < " + std::to_string(iterations) + " THEN 20");
+    program.statements = 1 + 3LL * std::max(iterations, 1);
+    return program;
+}
+
+/*
+ * Implementation notes: generateVariableLoop
+ * ------------------------------------------
+ * Every assignment in the body averages two variables, so no value
+ * ever grows beyond the largest initial one.
+ */
+
+GeneratedProgram generateVariableLoop(int iterations, int variables, unsigned seed) {
+    std::mt19937 random(seed);
+    variables = std::max(variables, 1);
+    GeneratedProgram program;
+    int lineNumber = 0;
+    for (int i = 0; i < variables; i++) {
+        lineNumber += LINE_STEP;
+        addLine(program.text, lineNumber, "LET " + variableName(i) + " = " + std::to_string(i % 100));
+    }
+    lineNumber += LINE_STEP;
+    addLine(program.text, lineNumber, "LET i = 0");
+    int bodyStart = lineNumber + LINE_STEP;
+    for (int i = 0; i < BODY_STATEMENTS; i++) {
+        lineNumber += LINE_STEP;
+        std::string lhs = variableName(randomInt(random, 0, variables - 1));
+        std::string a = variableName(randomInt(random, 0, variables - 1));
+        std::string b = variableName(randomInt(random, 0, variables - 1));
+        addLine(program.text, lineNumber, "LET " + lhs + " = (" + a + randomOperator(random) + b + ") / 2");
+    }
+    lineNumber += LINE_STEP;
+    addLine(program.text, lineNumber, "LET i = i + 1");
+    lineNumber += LINE_STEP;
+    addLine(program.text, lineNumber,
+            "IF i < " + std::to_string(iterations) + " THEN " + std::to_string(bodyStart));
+    program.statements = variables + 1 + (BODY_STATEMENTS + 2LL) * std::max(iterations, 1);
+    return program;
+}
+
+/*
+ * Implementation notes: generateSieve
+ * -----------------------------------
+ * The multiples of each prime are crossed out starting from twice the
+ * prime, so every subscript is bounded by the tests on i and j and the
+ * compiler can remove the bounds checks.  The number of statements is
+ * found by running the same sieve here.
+ */
+
+GeneratedProgram generateSieve(int limit) {
+    GeneratedProgram program;
+    limit = std::max(limit, 2);
+    addLine(program.text, 10, "LET n = " + std::to_string(limit));
+    addLine(program.text, 20, "DIM f(n)");
+    addLine(program.text, 30, "LET c = 0");
+    addLine(program.text, 40, "LET i = 2");
+    addLine(program.text, 50, "IF i > n THEN 150");
+    addLine(program.text, 60, "IF f(i) = 1 THEN 130");
+    addLine(program.text, 70, "LET c = c + 1");
+    addLine(program.text, 80, "LET j = i + i");
+    addLine(program.text, 90, "IF j > n THEN 130");
+    addLine(program.text, 100, "LET f(j) = 1");
+    addLine(program.text, 110, "LET j = j + i");
+    addLine(program.text, 120, "GOTO 90");
+    addLine(program.text, 130, "LET i = i + 1");
+    addLine(program.text, 140, "GOTO 50");
+    addLine(program.text, 150, "PRINT c");
+    std::vector<char> crossed(limit + 1, 0);
+    long long statements = 4 + 2;
+    for (int i = 2; i <= limit; i++) {
+        statements += 4;
+        if (crossed[i]) continue;
+        statements += 3;
+        for (int j = i + i; j <= limit; j += i) {
+            crossed[j] = 1;
+            statements += 4;
+        }
+    }
+    program.statements = statements;
+    return program;
+}
+
+/*
+ * Implementation notes: generateProgram
+ * -------------------------------------
+ * The first lines give every variable a value between 0 and 99, and
+ * every later assignment divides a sum of depth + 1 terms by more than
+ * depth + 1, so all values stay in that range and no expression can
+ * overflow.  IF and GOTO only jump forward to an existing line, and
+ * the last line is an END.  The random choices for one statement are
+ * made in separate statements, since the order in which the operands
+ * of + are evaluated is unspecified.
+ */
+
+GeneratedProgram generateProgram(const ProgramShape &shape) {
+    std::mt19937 random(shape.seed);
+    int lines = std::max(shape.lines, 1);
+    int variables = std::max(1, std::min(shape.variables, lines - 1));
+    int depth = std::max(shape.depth, 0);
+    int lastLine = lines * LINE_STEP;
+    GeneratedProgram program;
+    for (int index = 0; index < lines; index++) {
+        int lineNumber = (index + 1) * LINE_STEP;
+        std::string statement;
+        if (lineNumber == lastLine) {
+            statement = "END";
+        } else if (index < variables) {
+            statement = "LET " + variableName(index) + " = " + std::to_string(randomInt(random, 0, MAX_CONSTANT));
+        } else {
+            int target = std::min(lastLine, lineNumber + LINE_STEP * randomInt(random, 1, 8));
+            int kind = randomInt(random, 0, 19);
+            if (kind < 8) {
+                std::string lhs = variableName(randomInt(random, 0, variables - 1));
+                std::string exp = randomExpression(random, depth, variables);
+                int divisor = depth + randomInt(random, 2, 5);
+                statement = "LET " + lhs + " = (" + exp + ") / " + std::to_string(divisor);
+            } else if (kind < 12) {
+                statement = "PRINT " + randomExpression(random, depth, variables);
+            } else if (kind < 14) {
+                statement = "REM line " + std::to_string(lineNumber);
+            } else if (kind < 19) {
+                static const char *const RELATIONS[] = {"<", ">", "="};
+                std::string lhs = randomTerm(random, variables);
+                const char *relation = RELATIONS[randomInt(random, 0, 2)];
+                std::string rhs = randomTerm(random, variables);
+                statement = "IF " + lhs + " " + relation + " " + rhs + " THEN " + std::to_string(target);
+            } else {
+                statement = "GOTO " + std::to_string(target);
+            }
+        }
+        addLine(program.text, lineNumber, statement);
+    }
+    return program;
+}
+
+static void addLine(std::string &text, int lineNumber, const std::string &statement) {
+    text += std::to_string(lineNumber);
+    text += ' ';
+    text += statement;
+    text += '\n';
+}
+
+static std::string variableName(int index) {
+    return "v" + std::to_string(index);
+}
+
+static std::string randomTerm(std::mt19937 &random, int variables) {
+    if (randomInt(random, 0, 3) == 0) return std::to_string(randomInt(random, 0, MAX_CONSTANT));
+    return variableName(randomInt(random, 0, variables - 1));
+}
+
+/*
+ * Implementation notes: randomExpression
+ * --------------------------------------
+ * The operators are split at random between the two operands, which
+ * are parenthesized, so the expressions come in every shape from
+ * chains to balanced trees.
+ */
+
+static std::string randomExpression(std::mt19937 &random, int operators, int variables) {
+    if (operators == 0) return randomTerm(random, variables);
+    int left = randomInt(random, 0, operators - 1);
+    std::string lhs = randomExpression(random, left, variables);
+    std::string rhs = randomExpression(random, operators - 1 - left, variables);
+    if (left > 0) lhs = "(" + lhs + ")";
+    if (operators - 1 - left > 0) rhs = "(" + rhs + ")";
+    return lhs + randomOperator(random) + rhs;
+}
+
+static std::string randomOperator(std::mt19937 &random) {
+    return randomInt(random, 0, 1) == 0 ? " + " : " - ";
+}
+
+/*
+ * Implementation notes: randomInt
+ * -------------------------------
+ * The output of std::mt19937 is fixed by the standard, but that of the
+ * standard distributions is not, so the range is reduced by hand to
+ * keep the programs the same with every library.  The slight bias is
+ * of no concern here.
+ */
+
+static int randomInt(std::mt19937 &random, int low, int high) {
+    return low + (int) (random() % (unsigned) (high - low + 1));
+}
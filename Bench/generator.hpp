@@ -0,0 +1,94 @@
+/*
+ * File: generator.h
+ * -----------------
+ * This interface exports the generators of the synthetic BASIC
+ * programs used by the benchmark suite.  Every generator is
+ * deterministic: the same arguments always produce the same program,
+ * so that measurements taken on different builds can be compared.
+ */
+
+#ifndef _generator_h
+#define _generator_h
+
+#include <string>
+
+/*
+ * Type: GeneratedProgram
+ * ----------------------
+ * The text of a generated program, one numbered line per text line,
+ * together with the number of statements that RUN executes on it, or
+ * -1 if that number is not known in advance.
+ */
+
+struct GeneratedProgram {
+    std::string text;
+    long long statements = -1;
+};
+
+/*
+ * Type: ProgramShape
+ * ------------------
+ * The parameters of a random program built by generateProgram.
+ */
+
+struct ProgramShape {
+    int lines = 1000;           /* Number of program lines             */
+    int variables = 26;         /* Number of distinct variables        */
+    int depth = 2;              /* Operators per expression            */
+    unsigned seed = 1;          /* Seed of the random number generator */
+};
+
+/*
+ * Function: generateLoop
+ * Usage: GeneratedProgram loop = generateLoop(iterations);
+ * --------------------------------------------------------
+ * Returns a counting loop of one LET and one IF per iteration, which
+ * measures the cost of dispatch and of taken jumps.
+ */
+
+GeneratedProgram generateLoop(int iterations);
+
+/*
+ * Function: generateNestedLoop
+ * Usage: GeneratedProgram loop = generateNestedLoop(iterations, depth, seed);
+ * ---------------------------------------------------------------------------
+ * Returns a loop whose body assigns an expression nested depth levels
+ * deep, so that the time goes into expression evaluation.
+ */
+
+GeneratedProgram generateNestedLoop(int iterations, int depth, unsigned seed);
+
+/*
+ * Function: generateVariableLoop
+ * Usage: GeneratedProgram loop = generateVariableLoop(iterations, variables, seed);
+ * ---------------------------------------------------------------------------------
+ * Returns a loop whose body of 16 statements reads and writes randomly
+ * chosen variables out of the given number, which measures the cost
+ * of variable access when the program uses many names.
+ */
+
+GeneratedProgram generateVariableLoop(int iterations, int variables, unsigned seed);
+
+/*
+ * Function: generateSieve
+ * Usage: GeneratedProgram sieve = generateSieve(limit);
+ * -----------------------------------------------------
+ * Returns a sieve of Eratosthenes over an array of limit + 1 elements
+ * that prints the number of primes up to limit, which measures the
+ * cost of array access.
+ */
+
+GeneratedProgram generateSieve(int limit);
+
+/*
+ * Function: generateProgram
+ * Usage: GeneratedProgram program = generateProgram(shape);
+ * ---------------------------------------------------------
+ * Returns a random program of the given shape that uses every kind of
+ * statement.  Jumps only lead forward and every value stays small, so
+ * the program always runs to the end without an error.
+ */
+
+GeneratedProgram generateProgram(const ProgramShape &shape);
+
+#endif
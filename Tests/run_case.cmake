@@ -0,0 +1,21 @@
+# File: run_case.cmake
+# --------------------
+# Runs the interpreter on CASE.in, passing the options in ARGS, and
+# fails unless what it prints is exactly CASE.out.
+#
+# Usage: cmake -DINTERPRETER=<code> -DCASE=<path without extension>
+#              [-DARGS=<options>] -P run_case.cmake
+
+separate_arguments(options UNIX_COMMAND "${ARGS}")
+execute_process(COMMAND ${INTERPRETER} ${options}
+                INPUT_FILE ${CASE}.in
+                OUTPUT_VARIABLE actual
+                ERROR_VARIABLE actual
+                RESULT_VARIABLE result)
+file(READ ${CASE}.out expected)
+if (NOT result EQUAL 0)
+    message(FATAL_ERROR "interpreter exited with ${result}; output:\n${actual}")
+endif ()
+if (NOT actual STREQUAL expected)
+    message(FATAL_ERROR "expected:\n${expected}\nactual:\n${actual}")
+endif ()
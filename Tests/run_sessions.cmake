@@ -0,0 +1,27 @@
+# File: run_sessions.cmake
+# ------------------------
+# Runs the interpreter, with the options in ARGS, on the files CASE.1.in,
+# CASE.2.in and so on, each of which becomes a session of its own, and
+# fails unless what it prints is CASE.out.  The measurements in PROFILE
+# reports vary from run to run, so every time and share is replaced by
+# # and every sample count other than zero by N before comparing.
+#
+# Usage: cmake -DINTERPRETER=<code> -DCASE=<path without extension>
+#              [-DARGS=<options>] -P run_sessions.cmake
+
+separate_arguments(options UNIX_COMMAND "${ARGS}")
+file(GLOB inputs ${CASE}.*.in)
+list(SORT inputs)
+execute_process(COMMAND ${INTERPRETER} ${options} ${inputs}
+                OUTPUT_VARIABLE actual
+                ERROR_VARIABLE actual
+                RESULT_VARIABLE result)
+file(READ ${CASE}.out expected)
+if (NOT result EQUAL 0)
+    message(FATAL_ERROR "interpreter exited with ${result}; output:\n${actual}")
+endif ()
+string(REGEX REPLACE " +[0-9]+\\.[0-9]+" " #" actual "${actual}")
+string(REGEX REPLACE "\\([1-9][0-9]* samples" "(N samples" actual "${actual}")
+if (NOT actual STREQUAL expected)
+    message(FATAL_ERROR "expected:\n${expected}\nactual:\n${actual}")
+endif ()
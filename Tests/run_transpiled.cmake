@@ -0,0 +1,40 @@
+# File: run_transpiled.cmake
+# --------------------------
+# Translates CASE.in to C++ with --emit-cpp, compiles the translation
+# with COMPILER, and fails unless the program prints exactly CASE.out.
+# What the interpreter itself prints, such as errors in stored lines,
+# is not part of the translation and is ignored.
+# The translation is built without optimization so that the compiler
+# cannot fold the arithmetic being tested away.
+#
+# Usage: cmake -DINTERPRETER=<code> -DCOMPILER=<c++> -DCASE=<path>
+#              -DWORK=<scratch directory> -P run_transpiled.cmake
+
+file(MAKE_DIRECTORY ${WORK})
+get_filename_component(name ${CASE} NAME)
+file(REMOVE ${WORK}/${name}.cpp)
+execute_process(COMMAND ${INTERPRETER} --emit-cpp=${WORK}/${name}.cpp
+                INPUT_FILE ${CASE}.in
+                OUTPUT_QUIET
+                ERROR_QUIET
+                RESULT_VARIABLE result)
+if (NOT result EQUAL 0)
+    message(FATAL_ERROR "translation exited with ${result}")
+endif ()
+execute_process(COMMAND ${COMPILER} -std=c++17 -O0 -o ${WORK}/${name} ${WORK}/${name}.cpp
+                ERROR_VARIABLE diagnostics
+                RESULT_VARIABLE result)
+if (NOT result EQUAL 0)
+    message(FATAL_ERROR "compiling the translation failed:\n${diagnostics}")
+endif ()
+execute_process(COMMAND ${WORK}/${name}
+                OUTPUT_VARIABLE actual
+                ERROR_VARIABLE actual
+                RESULT_VARIABLE result)
+file(READ ${CASE}.out expected)
+if (NOT result EQUAL 0)
+    message(FATAL_ERROR "translated program exited with ${result}; output:\n${actual}")
+endif ()
+if (NOT actual STREQUAL expected)
+    message(FATAL_ERROR "expected:\n${expected}\nactual:\n${actual}")
+endif ()
@@ -1,9 +1,27 @@
 #include <iostream>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
 #include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 using namespace std;
 
+extern char **environ;
+
 const string traceFolder = "Test/";
 const string defaultStudentBasic = "./testcode";
 const string defaultStanderBasic = "./Basic-Demo-64bit";
@@ -35,18 +53,26 @@ const string traces[traceCount] = {
 string studentBasic = "";
 string standerBasic = "";
 string traceFile = "";
-int runTraces = traceCount, currentTrace = 0;
+int runTraces = traceCount, currentTrace = 0, jobs = 0;
 bool silent = false, firstFail = false, hideError = false, useColor = true;
 
 int correct = 0, wrong = 0, total = 0;
 
+struct TraceResult {
+    int error = 0;
+    bool done = false;
+    string input, expected, actual;
+};
+
 void usage(const char *progname) {
     cout
-            << progname << " [-h] [-e <your_exec>] [-s <stander_exec>] [-t <trace_file>] [-f] [-m] [-q]" << endl
+            << progname << " [-h] [-e <your_exec>] [-s <stander_exec>] [-t <trace_file>] [-j <jobs>] [-f] [-m] [-q]"
+            << endl
             << "    -h  Show this message and quit" << endl
             << "    -e  Specify your executable file, default value: " << defaultStudentBasic << endl
             << "    -s  Specify demo executable file, default value: " << defaultStanderBasic << endl
             << "    -t  Run specified trace file" << endl
+            << "    -j  Run this many traces at once, default value: number of cores" << endl
             << "    -f  Stop at first failed test" << endl
             << "    -m  Hide error message" << endl
             << "    -q  Show final score only, cannot use with -t or -f, include -m" << endl;
@@ -61,7 +87,7 @@ string color(string ce) {
 void parseArguments(int argc, char **argv) {
     int c;
     opterr = 0;
-    while ((c = getopt(argc, argv, "e:s:t:fmqch")) != -1) {
+    while ((c = getopt(argc, argv, "e:s:t:j:fmqch")) != -1) {
         switch (c) {
             case 'e':
                 if (studentBasic.size()) usage(argv[0]);
@@ -75,6 +101,11 @@ void parseArguments(int argc, char **argv) {
                 if (traceFile.size()) usage(argv[0]);
                 traceFile = optarg;
                 break;
+            case 'j':
+                if (jobs) usage(argv[0]);
+                jobs = atoi(optarg);
+                if (jobs <= 0) usage(argv[0]);
+                break;
             case 'f':
                 if (firstFail) usage(argv[0]);
                 firstFail = true;
@@ -99,34 +130,123 @@ void parseArguments(int argc, char **argv) {
     if (silent) hideError = true;
     if (studentBasic.size() == 0) studentBasic = defaultStudentBasic;
     if (standerBasic.size() == 0) standerBasic = defaultStanderBasic;
+    if (jobs == 0) jobs = max(1, (int) thread::hardware_concurrency());
 }
 
-void clearTempFiles() {
-    int r = system("rm test_ans test_out -f");
-    (void) r;
+bool readFile(const string &path, string &contents) {
+    ifstream in(path, ios::binary);
+    if (!in) return false;
+    ostringstream buffer;
+    buffer << in.rdbuf();
+    contents = buffer.str();
+    return true;
 }
 
-int testTrace(const char *trace) {
-    clearTempFiles();
-    if (system((string() + "cat " + trace + " | timeout 1 " + standerBasic + " > test_ans 2> /dev/null").c_str()) !=
-        0)
-        return 1;
-    if (system((string() + "cat " + trace + " | timeout 1 " + studentBasic + " > test_out 2> /dev/null").c_str()) !=
-        0)
-        return 2;
-    if (system("diff test_ans test_out > /dev/null 2> /dev/null")) return 4;
-    if (system(
-            (string() + "cat " + trace + " | timeout 5 valgrind --error-exitcode=2 --leak-check=full " + studentBasic +
-             " > /dev/null 2> /dev/null").c_str()) != 0)
+/*
+ * Runs args[0] with input as its standard input and returns true if it exits
+ * with status 0 within timeoutMs milliseconds.  Standard output is collected
+ * in *output, or discarded if output is nullptr; standard error is discarded.
+ * The program is started with posix_spawn and fed through pipes, so no shell
+ * and no temporary file is involved.  All descriptors are close-on-exec, so
+ * programs started by other threads at the same time do not inherit them.
+ */
+bool runProgram(const vector<string> &args, const string &input, int timeoutMs, string *output) {
+    int in[2], out[2] = {-1, -1};
+    if (pipe2(in, O_CLOEXEC) != 0) return false;
+    if (output && pipe2(out, O_CLOEXEC) != 0) {
+        close(in[0]);
+        close(in[1]);
+        return false;
+    }
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, in[0], STDIN_FILENO);
+    if (output) posix_spawn_file_actions_adddup2(&actions, out[1], STDOUT_FILENO);
+    else posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+    vector<char *> argv;
+    for (const string &arg : args) argv.push_back(const_cast<char *>(arg.c_str()));
+    argv.push_back(nullptr);
+    pid_t pid;
+    int spawned = posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(in[0]);
+    if (output) close(out[1]);
+    if (spawned != 0) {
+        close(in[1]);
+        if (output) close(out[0]);
+        return false;
+    }
+
+    auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs);
+    fcntl(in[1], F_SETFL, O_NONBLOCK);
+    size_t written = 0;
+    int inFd = in[1], outFd = output ? out[0] : -1;
+    if (input.empty()) {
+        close(inFd);
+        inFd = -1;
+    }
+    bool timedOut = false;
+    char buffer[65536];
+    while (inFd >= 0 || outFd >= 0) {
+        int left = (int) chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count();
+        if (left <= 0) {
+            timedOut = true;
+            break;
+        }
+        pollfd fds[2];
+        int n = 0;
+        if (inFd >= 0) fds[n++] = {inFd, POLLOUT, 0};
+        if (outFd >= 0) fds[n++] = {outFd, POLLIN, 0};
+        if (poll(fds, n, left) < 0 && errno != EINTR) break;
+        for (int i = 0; i < n; i++) {
+            if (!fds[i].revents) continue;
+            if (fds[i].fd == inFd) {
+                ssize_t k = write(inFd, input.data() + written, input.size() - written);
+                if (k > 0) written += k;
+                if ((k < 0 && errno != EAGAIN && errno != EINTR) || written == input.size()) {
+                    close(inFd);
+                    inFd = -1;
+                }
+            } else {
+                ssize_t k = read(outFd, buffer, sizeof buffer);
+                if (k > 0) output->append(buffer, k);
+                else if (k == 0 || (errno != EAGAIN && errno != EINTR)) {
+                    close(outFd);
+                    outFd = -1;
+                }
+            }
+        }
+    }
+    if (inFd >= 0) close(inFd);
+    if (outFd >= 0) close(outFd);
+
+    int status = 0;
+    while (true) {
+        if (!timedOut && chrono::steady_clock::now() >= deadline) timedOut = true;
+        if (timedOut) kill(pid, SIGKILL);
+        pid_t done = waitpid(pid, &status, timedOut ? 0 : WNOHANG);
+        if (done == pid) break;
+        if (done < 0 && errno != EINTR) return false;
+        if (done == 0) this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    return !timedOut && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+int testTrace(const string &trace, TraceResult &result) {
+    if (!readFile(trace, result.input)) return 1;
+    if (!runProgram({standerBasic}, result.input, 1000, &result.expected)) return 1;
+    if (!runProgram({studentBasic}, result.input, 1000, &result.actual)) return 2;
+    if (result.expected != result.actual) return 4;
+    if (!runProgram({"valgrind", "--error-exitcode=2", "--leak-check=full", studentBasic},
+                    result.input, 5000, nullptr))
         return 3;
-    clearTempFiles();
     return 0;
 }
 
-void runTest(const string currentTrace) {
+void report(const string &currentTrace, const TraceResult &result) {
     if (!silent) cout << "Trace \"" << currentTrace << "\" ... ";
-    cout.flush();
-    int error = testTrace(currentTrace.c_str());
+    int error = result.error;
     total++;
     if (!error) {
         if (!silent) cout << color("\x1b[32;1m") << "Pass" << color("\x1b[0m") << endl;
@@ -137,9 +257,7 @@ void runTest(const string currentTrace) {
             cout << color("\x1b[31;1m") << "Fail" << color("\x1b[0m") << endl;
             if (!hideError) {
                 cout << "Trace file: " << endl << color("\x1b[35m");
-                cout.flush();
-                int r0 = system((string() + "cat " + currentTrace).c_str());
-                (void) r0;
+                cout << result.input;
                 cout << color("\x1b[0m") << endl;
                 if (error == 1)
                     cout << color("\x1b[31m") << "Error occurred while running demo program" << color("\x1b[0m")
@@ -150,23 +268,64 @@ void runTest(const string currentTrace) {
                 if (error == 3) cout << color("\x1b[31m") << "Memory leak" << color("\x1b[0m") << endl;
                 if (error == 4) {
                     cout << "Demo output: " << endl << color("\x1b[36m");
-                    cout.flush();
-                    int r1 = system("cat test_ans");
-                    (void) r1;
+                    cout << result.expected;
                     cout << color("\x1b[0m") << endl;
                     cout << "Your output: " << endl << color("\x1b[33m");
-                    cout.flush();
-                    int r2 = system("cat test_out");
-                    (void) r2;
+                    cout << result.actual;
                     cout << color("\x1b[0m") << endl;
                 }
             }
         }
-        clearTempFiles();
         if (firstFail) throw exception();
     }
 }
 
+/*
+ * Runs the traces on `jobs` worker threads, which take the traces in order,
+ * and reports each result in order as soon as it and all earlier ones are in.
+ * With -f no new trace is started after a failure.
+ */
+void runTests(const vector<string> &paths) {
+    int count = (int) paths.size();
+    vector<TraceResult> results(count);
+    atomic<int> next(0);
+    atomic<bool> stop(false);
+    mutex lock;
+    condition_variable ready;
+    vector<thread> workers;
+    for (int w = 0; w < min(jobs, count); w++) {
+        workers.emplace_back([&] {
+            while (!stop) {
+                int i = next++;
+                if (i >= count) break;
+                TraceResult result;
+                result.error = testTrace(paths[i], result);
+                if (result.error && firstFail) stop = true;
+                lock_guard<mutex> guard(lock);
+                results[i] = move(result);
+                results[i].done = true;
+                ready.notify_all();
+            }
+            lock_guard<mutex> guard(lock);
+            ready.notify_all();
+        });
+    }
+    try {
+        for (int i = 0; i < count; i++) {
+            unique_lock<mutex> guard(lock);
+            ready.wait(guard, [&] { return results[i].done || (stop && i >= next); });
+            if (!results[i].done) break;
+            guard.unlock();
+            report(paths[i], results[i]);
+        }
+    } catch (...) {
+        stop = true;
+        for (thread &worker : workers) worker.join();
+        throw;
+    }
+    for (thread &worker : workers) worker.join();
+}
+
 void showScore() {
     int score = correct / 5 * 5;
     if (!silent)
@@ -177,20 +336,23 @@ void showScore() {
 
 int main(int argc, char **argv) {
     parseArguments(argc, argv);
+    signal(SIGPIPE, SIG_IGN);
     try {
         cout << "Compiling code ..." << endl;
         /**************************************************************
          if you modify the structure of the files, you should modify the file paths here.
          **************************************************************/
-        system("g++ -std=c++17 -o testcode Basic/Basic.cpp Basic/evalstate.cpp Basic/exp.cpp Basic/parser.cpp Basic/program.cpp Basic/statement.cpp Basic/Utils/error.cpp Basic/Utils/tokenScanner.cpp Basic/Utils/strlib.cpp");
-        system("chmod a+rwx Basic-Demo-64bit");
-        if (traceFile.size()) runTest(traceFile);
+        system("g++ -std=c++17 -O2 -pthread -o testcode Basic/arena.cpp Basic/Basic.cpp Basic/cache.cpp Basic/compiler.cpp Basic/dataflow.cpp Basic/evalstate.cpp Basic/exp.cpp Basic/image.cpp Basic/io.cpp Basic/jit.cpp Basic/keyword.cpp Basic/lexer.cpp Basic/optimizer.cpp Basic/parser.cpp Basic/profiler.cpp Basic/program.cpp Basic/scheduler.cpp Basic/session.cpp Basic/statement.cpp Basic/status.cpp Basic/transpiler.cpp Basic/verifier.cpp Basic/vm.cpp Basic/Utils/error.cpp Basic/Utils/tokenScanner.cpp Basic/Utils/strlib.cpp");
+        chmod("Basic-Demo-64bit", 0777);
+        vector<string> paths;
+        if (traceFile.size()) paths.push_back(traceFile);
         else {
             int i = 0;
-            for (; i < traceCount; i++) runTest(traceFolder + traces[i]);
+            for (; i < traceCount; i++) paths.push_back(traceFolder + traces[i]);
         }
+        runTests(paths);
     } catch (...) {}
-    system("rm testcode -f");
+    unlink("testcode");
     showScore();
     return 0;
 }